@@ -18,7 +18,7 @@
 
 #import "Tracker.h"
 
+// Ascension Flock of Birds, through the "flock" backend.
 @interface Flock : Tracker {
-  void* flock;
 }
 @end
@@ -18,6 +18,8 @@
 
 #import <Cocoa/Cocoa.h>
 
+#include "iset_watch.h"
+
 @interface FoBController : NSObject {
   IBOutlet NSButton* chooseSetListButton;
   IBOutlet NSComboBox* deviceField;
@@ -49,6 +51,7 @@
 
   BOOL stopRunning;
   NSString* setListDirectory;
+  iset_watch_t isetWatch; // Lists of sets of the processing thread
 }
 
 - (IBAction) guiAction: (id) sender;
@@ -17,9 +17,8 @@
    USA */
 
 #import "Tracker.h"
-#import "liberty_hl.h"
 
+// Polhemus Liberty, through the "liberty" backend.
 @interface Liberty : Tracker {
-  liberty_t liberty;
 }
 @end
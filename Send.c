@@ -7,8 +7,67 @@
  *
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE // sendmmsg, recvmmsg
+#endif
+
+#include <poll.h>
+#include <pthread.h>
+
 #include "Send.h"
 
+// Bytes of the messages of a frame, and datagrams
+#define FRAME_SIZE 65536
+#define FRAME_DATAGRAMS 256
+#define BUNDLE_HEADER_SIZE 16 // "#bundle", time tag
+
+struct datagram_s {
+  int sockfd;
+  struct sockaddr_in addr;
+  int offset; // In the buffer of the frame
+  int size;
+  int bundle; // Whether messages can be added
+};
+
+struct send_frame_s {
+  int bundle_size; // 0 for messages sent as they are
+  uint64_t time_tag; // Of the bundles
+  int size;
+  int number_of_datagrams;
+  struct datagram_s datagrams[FRAME_DATAGRAMS];
+  char buffer[FRAME_SIZE] __attribute__ ((aligned (4)));
+};
+
+// Datagrams read at once by the input thread, and bytes of the queue
+// of the datagrams waiting
+#define INPUT_BATCH 8
+#define INPUT_QUEUE_SIZE (1 << 20)
+#define INPUT_POLL_MS 100 // Between the checks of the end of the thread
+#define INPUT_RECEIVE_BUFFER (1 << 20) // Of the socket, for the bursts
+#define INPUT_WRAP 0xffffffff // Size of the header ending the queue
+
+// Header of a datagram in the queue, followed by its bytes padded to 4
+struct input_header_s {
+  uint32_t size;
+  struct sockaddr_in sender;
+};
+
+struct osc_input_s {
+  int sockfd;
+  pthread_t thread;
+  int running; // Cleared to end the thread
+  int wake[2]; // One byte per batch of datagrams queued
+  // Bytes written by the thread and read by the parser, from 0
+  unsigned long head;
+  unsigned long tail;
+  struct osc_input_stats_s stats; // Counted by the thread
+  char* queue;
+  char* buffers; // Of the batch being read
+};
+
+// Frame of the messages sent by this thread, NULL if none
+static __thread send_frame_t collecting = NULL;
+
 // Open the socket
 int open_socket (int port) {
   int sockfd;
@@ -60,9 +119,9 @@ int fill_host_addr (const char* host, int port, struct sockaddr_in* host_addr) {
 }// fill_host_addr
 
 // OSC receive
-int receive_OSC (OSC_space_t space, int sockfd) {
-  /* FIXME: size problem? */
-  char buffer[1024];
+int receive_OSC (OSC_space_t space, int sockfd, struct sockaddr_in* sender) {
+  // Up to the largest datagram, for the uploads of sets
+  char buffer[OSC_MAX_PACKET_SIZE] __attribute__ ((aligned (4)));
   struct sockaddr_in from;
   int nbytes;
   socklen_t size;
@@ -76,15 +135,252 @@ int receive_OSC (OSC_space_t space, int sockfd) {
     return -1;
   }
 
+  if (sender) *sender = from;
+
   return OSC_space_parse (space, buffer, nbytes);
 }// receive_OSC
 
+static int frame_add (send_frame_t frame, int sockfd,
+                      const struct sockaddr_in* addr,
+                      const char* buf, int size);
+
+//_____________INPUT__________________________________________//
+
+// Queues a datagram.  Returns -1 if there is no room.
+static int input_push (osc_input_t input, const char* data, int size,
+                       const struct sockaddr_in* sender) {
+  unsigned long head = input->head;
+  unsigned long tail = __atomic_load_n (&input->tail, __ATOMIC_ACQUIRE);
+  unsigned long need = sizeof (struct input_header_s) + (size + 3) / 4 * 4;
+  unsigned long position = head % INPUT_QUEUE_SIZE;
+  unsigned long contiguous = INPUT_QUEUE_SIZE - position;
+
+  // Datagrams are not split at the end of the queue
+  if (INPUT_QUEUE_SIZE - (head - tail) <
+      need + (contiguous < need ? contiguous : 0))
+    return -1;
+  if (contiguous < need) {
+    if (contiguous >= sizeof (struct input_header_s))
+      ((struct input_header_s*) (input->queue + position))->size = INPUT_WRAP;
+    head += contiguous;
+    position = 0;
+  }
+
+  struct input_header_s* header = (struct input_header_s*) (input->queue + position);
+  header->size = size;
+  header->sender = *sender;
+  memcpy (header + 1, data, size);
+  __atomic_store_n (&input->head, head + need, __ATOMIC_RELEASE);
+  return 0;
+}// input_push
+
+// Counters read by osc_input_get_stats while the thread runs
+static void input_count (unsigned long* counter) {
+  __atomic_fetch_add (counter, 1, __ATOMIC_RELAXED);
+}// input_count
+
+// Queues the datagrams of a batch, drops the truncated ones
+static void input_queue (osc_input_t input, const char* data, int size,
+                         int truncated, const struct sockaddr_in* sender) {
+  if (truncated)
+    input_count (&input->stats.truncated);
+  else if (input_push (input, data, size, sender) == -1)
+    input_count (&input->stats.dropped);
+  else
+    input_count (&input->stats.datagrams);
+}// input_queue
+
+// Reads every datagram waiting on the socket.  Returns their number.
+static int input_drain (osc_input_t input) {
+  int n = 0;
+
+#ifdef __linux__
+  struct mmsghdr messages[INPUT_BATCH];
+  struct iovec iovecs[INPUT_BATCH];
+  struct sockaddr_in senders[INPUT_BATCH];
+
+  for (;;) {
+    for (int i = 0; i < INPUT_BATCH; i++) {
+      iovecs[i].iov_base = input->buffers + i * OSC_MAX_PACKET_SIZE;
+      iovecs[i].iov_len = OSC_MAX_PACKET_SIZE;
+      memset (&messages[i], 0, sizeof (messages[i]));
+      messages[i].msg_hdr.msg_name = &senders[i];
+      messages[i].msg_hdr.msg_namelen = sizeof (senders[i]);
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int received = recvmmsg (input->sockfd, messages, INPUT_BATCH,
+                             MSG_DONTWAIT, NULL);
+    if (received == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        input_count (&input->stats.errors);
+        perror ("recvmmsg");
+      }
+      break;
+    }
+
+    for (int i = 0; i < received; i++)
+      input_queue (input, iovecs[i].iov_base, messages[i].msg_len,
+                   (messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0,
+                   &senders[i]);
+    n += received;
+    if (received < INPUT_BATCH)
+      break;
+  }
+#else
+  for (;;) {
+    struct sockaddr_in sender;
+    struct iovec iovec = { input->buffers, OSC_MAX_PACKET_SIZE };
+    struct msghdr message;
+    memset (&message, 0, sizeof (message));
+    message.msg_name = &sender;
+    message.msg_namelen = sizeof (sender);
+    message.msg_iov = &iovec;
+    message.msg_iovlen = 1;
+
+    ssize_t size = recvmsg (input->sockfd, &message, MSG_DONTWAIT);
+    if (size == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        input_count (&input->stats.errors);
+        perror ("recvmsg");
+      }
+      break;
+    }
+
+    input_queue (input, input->buffers, size,
+                 (message.msg_flags & MSG_TRUNC) != 0, &sender);
+    n++;
+  }
+#endif
+
+  return n;
+}// input_drain
+
+static void* input_main (void* arg) {
+  osc_input_t input = arg;
+  struct pollfd fd = { input->sockfd, POLLIN, 0 };
+
+  while (__atomic_load_n (&input->running, __ATOMIC_RELAXED)) {
+    int ready = poll (&fd, 1, INPUT_POLL_MS);
+    if (ready == -1 && errno != EINTR) {
+      perror ("poll");
+      break;
+    }
+    if (ready <= 0)
+      continue;
+
+    if (input_drain (input) > 0) {
+      char byte = 0;
+      if (write (input->wake[1], &byte, 1) == -1 && errno != EAGAIN)
+        perror ("write");
+    }
+  }
+
+  return NULL;
+}// input_main
+
+osc_input_t osc_input_new (int sockfd) {
+  osc_input_t input = calloc (1, sizeof (*input));
+  input->sockfd = sockfd;
+  input->queue = malloc (INPUT_QUEUE_SIZE);
+  input->buffers = malloc (INPUT_BATCH * OSC_MAX_PACKET_SIZE);
+  input->wake[0] = input->wake[1] = -1;
+
+  int size = INPUT_RECEIVE_BUFFER;
+  setsockopt (sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size));
+
+  if (input->queue == NULL || input->buffers == NULL ||
+      pipe (input->wake) == -1) {
+    perror ("osc_input_new");
+    osc_input_free (input);
+    return NULL;
+  }
+  fcntl (input->wake[0], F_SETFL, O_NONBLOCK);
+  fcntl (input->wake[1], F_SETFL, O_NONBLOCK);
+
+  input->running = 1;
+  int err = pthread_create (&input->thread, NULL, input_main, input);
+  if (err) {
+    fprintf (stderr, "Can't create the OSC input thread: %s\n", strerror (err));
+    input->running = 0;
+    osc_input_free (input);
+    return NULL;
+  }
+
+  return input;
+}// osc_input_new
+
+void osc_input_free (osc_input_t input) {
+  if (input == NULL) return;
+
+  if (input->running) {
+    __atomic_store_n (&input->running, 0, __ATOMIC_RELAXED);
+    pthread_join (input->thread, NULL);
+  }
+  if (input->wake[0] != -1) close (input->wake[0]);
+  if (input->wake[1] != -1) close (input->wake[1]);
+  free (input->buffers);
+  free (input->queue);
+  free (input);
+}// osc_input_free
+
+int osc_input_get_socket (osc_input_t input) {
+  return input->sockfd;
+}// osc_input_get_socket
+
+int osc_input_get_wake_fd (osc_input_t input) {
+  return input->wake[0];
+}// osc_input_get_wake_fd
+
+int osc_input_parse (osc_input_t input, OSC_space_t space,
+                     struct sockaddr_in* sender) {
+  char bytes[64];
+  int n = 0;
+
+  while (read (input->wake[0], bytes, sizeof (bytes)) > 0)
+    ;
+
+  unsigned long tail = input->tail;
+  unsigned long head = __atomic_load_n (&input->head, __ATOMIC_ACQUIRE);
+  while (tail != head) {
+    unsigned long position = tail % INPUT_QUEUE_SIZE;
+    unsigned long contiguous = INPUT_QUEUE_SIZE - position;
+    struct input_header_s* header =
+      (struct input_header_s*) (input->queue + position);
+
+    if (contiguous < sizeof (*header) || header->size == INPUT_WRAP) {
+      tail += contiguous;
+      continue;
+    }
+
+    if (sender) *sender = header->sender;
+    OSC_space_parse (space, (const char*) (header + 1), header->size);
+    tail += sizeof (*header) + (header->size + 3) / 4 * 4;
+    n++;
+  }
+
+  __atomic_store_n (&input->tail, tail, __ATOMIC_RELEASE);
+  return n;
+}// osc_input_parse
+
+void osc_input_get_stats (osc_input_t input, osc_input_stats_t stats) {
+  stats->datagrams = __atomic_load_n (&input->stats.datagrams, __ATOMIC_RELAXED);
+  stats->truncated = __atomic_load_n (&input->stats.truncated, __ATOMIC_RELAXED);
+  stats->dropped = __atomic_load_n (&input->stats.dropped, __ATOMIC_RELAXED);
+  stats->errors = __atomic_load_n (&input->stats.errors, __ATOMIC_RELAXED);
+}// osc_input_get_stats
+
 // Send packet
 int send_packet (int sockfd,
              struct sockaddr* host_addr,
              socklen_t addrlen,
              const char* buf,
              int size) {
+  if (collecting != NULL && addrlen == sizeof (struct sockaddr_in))
+    return frame_add (collecting, sockfd,
+                      (struct sockaddr_in*) host_addr, buf, size);
+
   if (sendto (sockfd, buf, size, 0,
               (struct sockaddr*) host_addr,
               sizeof (*host_addr)) == -1) {
@@ -95,6 +391,179 @@ int send_packet (int sockfd,
   return 0;
 }// send_packet
 
+//_____________FRAMES_________________________________________//
+
+send_frame_t send_frame_new (int bundle_size) {
+  send_frame_t frame = calloc (1, sizeof (*frame));
+  send_frame_set_bundle_size (frame, bundle_size);
+  return frame;
+}// send_frame_new
+
+void send_frame_free (send_frame_t frame) {
+  if (collecting == frame) collecting = NULL;
+  free (frame);
+}// send_frame_free
+
+void send_frame_set_bundle_size (send_frame_t frame, int bundle_size) {
+  if (bundle_size < 0) bundle_size = 0;
+  if (bundle_size > OSC_MAX_PACKET_SIZE) bundle_size = OSC_MAX_PACKET_SIZE;
+  frame->bundle_size = bundle_size;
+}// send_frame_set_bundle_size
+
+static int same_target (const struct datagram_s* d, int sockfd,
+                        const struct sockaddr_in* addr) {
+  return d->sockfd == sockfd &&
+    d->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+    d->addr.sin_port == addr->sin_port;
+}// same_target
+
+// Sends the datagrams of the frame and empties it
+static int frame_flush (send_frame_t frame) {
+  int result = 0;
+  int sent = 0;
+
+  // Time tag of the bundles, known once the frame is processed
+  uint32_t time_tag[2] = { htonl (frame->time_tag >> 32),
+                           htonl (frame->time_tag & 0xffffffff) };
+  for (int i = 0; i < frame->number_of_datagrams; i++)
+    if (frame->datagrams[i].bundle)
+      memcpy (frame->buffer + frame->datagrams[i].offset + 8,
+              time_tag, sizeof (time_tag));
+
+#ifdef __linux__
+  // Consecutive datagrams of a socket in one call
+  struct mmsghdr messages[FRAME_DATAGRAMS];
+  struct iovec iovecs[FRAME_DATAGRAMS];
+  while (sent < frame->number_of_datagrams) {
+    int sockfd = frame->datagrams[sent].sockfd;
+    int n = 0;
+    for (int i = sent;
+         i < frame->number_of_datagrams && frame->datagrams[i].sockfd == sockfd;
+         i++, n++) {
+      struct datagram_s* d = &frame->datagrams[i];
+      iovecs[n].iov_base = frame->buffer + d->offset;
+      iovecs[n].iov_len = d->size;
+      memset (&messages[n], 0, sizeof (messages[n]));
+      messages[n].msg_hdr.msg_name = &d->addr;
+      messages[n].msg_hdr.msg_namelen = sizeof (d->addr);
+      messages[n].msg_hdr.msg_iov = &iovecs[n];
+      messages[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    int done = sendmmsg (sockfd, messages, n, 0);
+    if (done <= 0) {
+      perror ("sendmmsg");
+      result = -1;
+      // Skip the datagram which failed
+      done = 1;
+    }
+    sent += done;
+  }
+#else
+  for (; sent < frame->number_of_datagrams; sent++) {
+    struct datagram_s* d = &frame->datagrams[sent];
+    if (sendto (d->sockfd, frame->buffer + d->offset, d->size, 0,
+                (struct sockaddr*) &d->addr, sizeof (d->addr)) == -1) {
+      perror ("sendto");
+      result = -1;
+    }
+  }
+#endif
+
+  frame->size = 0;
+  frame->number_of_datagrams = 0;
+  return result;
+}// frame_flush
+
+// Adds a message to the last bundle if it is for the same target and
+// has room left, else as a new datagram
+static int frame_add (send_frame_t frame, int sockfd,
+                      const struct sockaddr_in* addr,
+                      const char* buf, int size) {
+  int result = 0;
+
+  if (frame->number_of_datagrams > 0) {
+    struct datagram_s* d = &frame->datagrams[frame->number_of_datagrams - 1];
+    if (d->bundle && same_target (d, sockfd, addr) &&
+        d->size + 4 + size <= frame->bundle_size &&
+        frame->size + 4 + size <= FRAME_SIZE) {
+      uint32_t element_size = htonl (size);
+      memcpy (frame->buffer + frame->size, &element_size, 4);
+      memcpy (frame->buffer + frame->size + 4, buf, size);
+      frame->size += 4 + size;
+      d->size += 4 + size;
+      return 0;
+    }
+  }
+
+  int header = frame->bundle_size > 0 ? BUNDLE_HEADER_SIZE + 4 : 0;
+  if (header + size > FRAME_SIZE)
+    return -1;
+  if (frame->number_of_datagrams == FRAME_DATAGRAMS ||
+      frame->size + header + size > FRAME_SIZE)
+    result = frame_flush (frame);
+
+  struct datagram_s* d = &frame->datagrams[frame->number_of_datagrams++];
+  d->sockfd = sockfd;
+  d->addr = *addr;
+  d->offset = frame->size;
+  d->size = header + size;
+  d->bundle = header != 0;
+
+  char* p = frame->buffer + frame->size;
+  if (header) {
+    // Time tag written by frame_flush
+    uint32_t element_size = htonl (size);
+    memcpy (p, "#bundle", 8);
+    memcpy (p + BUNDLE_HEADER_SIZE, &element_size, 4);
+  }
+  memcpy (p + header, buf, size);
+  frame->size += header + size;
+  return result;
+}// frame_add
+
+void send_frame_begin (send_frame_t frame) {
+  frame->time_tag = OSC_TIME_TAG_IMMEDIATELY;
+  collecting = frame;
+}// send_frame_begin
+
+void send_frame_set_time_tag (send_frame_t frame, uint64_t time_tag) {
+  frame->time_tag = time_tag;
+}// send_frame_set_time_tag
+
+int send_frame_end (void) {
+  send_frame_t frame = collecting;
+  collecting = NULL;
+  return frame ? frame_flush (frame) : 0;
+}// send_frame_end
+
+
+// Templates of the messages sent for every frame, written once by
+// every thread sending them
+static __thread struct OSC_template_s record_template;
+static __thread struct OSC_template_s bump_template;
+static __thread struct OSC_template_s enter_template;
+static __thread struct OSC_template_s leave_template;
+
+// Template initialized on first use, NULL if it can't be
+static OSC_template_t get_template (OSC_template_t t,
+                                    const char* name,
+                                    const char* typetag) {
+  if (t->size == 0 && OSC_template_init (t, name, typetag) == -1)
+    return NULL;
+  return t;
+}// get_template
+
+// Send a template
+static int send_template (int sockfd,
+                          struct sockaddr_in* host_addr,
+                          OSC_template_t t) {
+  return send_packet (sockfd,
+                      (struct sockaddr*) host_addr,
+                      sizeof (*host_addr),
+                      t->buffer,
+                      t->size);
+}// send_template
 
 // Send a record message
 int send_record (int sockfd,
@@ -113,32 +582,27 @@ int send_record (int sockfd,
 			 float accel_x,
 			 float accel_y,
 			 float accel_z) {
-  OSC_message_t m;
-  OSC_message_packet_t p;
-  int result;
-
-  m = OSC_message_make ("/record",
-                        ",iiffffffffffff",
-                        &bird, &instrument,
-                        &delta_x, &delta_y, &delta_z,
-                        &angle_x, &angle_y, &angle_z,
-                        &speed_x, &speed_y, &speed_z,
-						&accel_x, &accel_y, &accel_z);
-
-  if (m == NULL)
+  OSC_template_t t = get_template (&record_template,
+                                   "/record", ",iiffffffffffff");
+  if (t == NULL)
     return -1;
 
-  p = OSC_message_packet (m);
-
-  result = send_packet (sockfd,
-                        (struct sockaddr*) host_addr,
-                        sizeof (*host_addr),
-                        p->buffer,
-                        p->size);
-
-  OSC_message_free (m);
-
-  return result;
+  OSC_template_set_int (t, 0, bird);
+  OSC_template_set_int (t, 1, instrument);
+  OSC_template_set_float (t, 2, delta_x);
+  OSC_template_set_float (t, 3, delta_y);
+  OSC_template_set_float (t, 4, delta_z);
+  OSC_template_set_float (t, 5, angle_x);
+  OSC_template_set_float (t, 6, angle_y);
+  OSC_template_set_float (t, 7, angle_z);
+  OSC_template_set_float (t, 8, speed_x);
+  OSC_template_set_float (t, 9, speed_y);
+  OSC_template_set_float (t, 10, speed_z);
+  OSC_template_set_float (t, 11, accel_x);
+  OSC_template_set_float (t, 12, accel_y);
+  OSC_template_set_float (t, 13, accel_z);
+
+  return send_template (sockfd, host_addr, t);
 }// send_record
 
 
@@ -156,46 +620,87 @@ int send_bump (int sockfd,
            float angle_z,
            float velo_city
 		   ) {
+  OSC_template_t t = get_template (&bump_template, "/bump", ",iifffffff");
+  if (t == NULL)
+    return -1;
+
+  OSC_template_set_int (t, 0, bird);
+  OSC_template_set_int (t, 1, instrument);
+  OSC_template_set_float (t, 2, delta_x);
+  OSC_template_set_float (t, 3, delta_y);
+  OSC_template_set_float (t, 4, delta_z);
+  OSC_template_set_float (t, 5, angle_x);
+  OSC_template_set_float (t, 6, angle_y);
+  OSC_template_set_float (t, 7, angle_z);
+  OSC_template_set_float (t, 8, velo_city);
+
+  return send_template (sockfd, host_addr, t);
+}//send_bump
+
+// Send an enter message or a leave message
+int send_enter_leave (int sockfd,
+                  char * op,
+                  struct sockaddr_in * host_addr,
+                  int bird,
+                  int instrument) {
+  struct OSC_template_s other;
+  OSC_template_t t;
+
+  if (strcmp (op, "/enter") == 0)
+    t = get_template (&enter_template, op, ",ii");
+  else if (strcmp (op, "/leave") == 0)
+    t = get_template (&leave_template, op, ",ii");
+  else {
+    other.size = 0;
+    t = get_template (&other, op, ",ii");
+  }
+  if (t == NULL)
+    return -1;
+
+  OSC_template_set_int (t, 0, bird);
+  OSC_template_set_int (t, 1, instrument);
+
+  return send_template (sockfd, host_addr, t);
+}// send_enter_leave
+
+// Send the result of an upload (see iset_watch_upload): 0 if the
+// sets are in use, -1 if they were rejected
+int send_upload (int sockfd,
+                 struct sockaddr_in * host_addr,
+                 int iset_number,
+                 int result) {
   OSC_message_t m;
   OSC_message_packet_t p;
-  int result;
-
-  m = OSC_message_make ("/bump",
-						",iiffffffff",
-                        &bird, 
-						&instrument,
-                        &delta_x, &delta_y, &delta_z,
-                        &angle_x, &angle_y, &angle_z,
-                        &velo_city 
-						);
+  int res;
 
+  if (iset_number == -1)
+    m = OSC_message_make ("/uploadSetList", ",i", &result);
+  else
+    m = OSC_message_make ("/uploadSet", ",ii", &iset_number, &result);
   if (m == NULL)
     return -1;
 
   p = OSC_message_packet (m);
-
-  result = send_packet (sockfd,
-                        (struct sockaddr*) host_addr,
-                        sizeof (*host_addr),
-                        p->buffer,
-                        p->size);
+  res = send_packet (sockfd,
+                     (struct sockaddr*) host_addr,
+                     sizeof (*host_addr),
+                     p->buffer,
+                     p->size);
 
   OSC_message_free (m);
 
-  return result;
-}//send_bump
+  return res;
+}// send_upload
 
-// Send an enter message or a leave message
-int send_enter_leave (int sockfd,
-                  char * op,
-                  struct sockaddr_in * host_addr,
-                  int bird,
-                  int instrument) {
+// Send the set number to SetKreator
+int load_iset (int sockfd,
+			struct sockaddr_in * host_addr,
+            int iset_number) {
   OSC_message_t m;
   OSC_message_packet_t p;
   int result;
 
-  m = OSC_message_make (op, ",ii", &bird, &instrument);
+  m = OSC_message_make ("/instrumentSet", ",i", &iset_number);
   if (m == NULL)
     return -1;
 
@@ -209,17 +714,18 @@ int send_enter_leave (int sockfd,
   OSC_message_free (m);
 
   return result;
-}// send_enter_leave
+}// load_iset
 
-// Send the set number to SetKreator
-int load_iset (int sockfd,
-			struct sockaddr_in * host_addr,
-            int iset_number) {
+// Send the set of a sensor
+int send_sensor_set (int sockfd,
+                     struct sockaddr_in * host_addr,
+                     int bird,
+                     int iset_number) {
   OSC_message_t m;
   OSC_message_packet_t p;
   int result;
 
-  m = OSC_message_make ("/instrumentSet", ",i", &iset_number);
+  m = OSC_message_make ("/sensorSet", ",ii", &bird, &iset_number);
   if (m == NULL)
     return -1;
 
@@ -233,4 +739,4 @@ int load_iset (int sockfd,
   OSC_message_free (m);
 
   return result;
-}// load_iset
+}// send_sensor_set
@@ -7,6 +7,9 @@
  *
  */
 
+#ifndef __Send_h__
+#define __Send_h__
+
 #include <sys/socket.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,7 +34,39 @@ int open_socket (int port);
 
 void close_socket (int sockfd);
 
-int receive_OSC (OSC_space_t space, int sockfd);
+int fill_host_addr (const char* host, int port, struct sockaddr_in* host_addr);
+
+// Largest UDP datagram
+#define OSC_MAX_PACKET_SIZE 65536
+
+// 'sender', if not NULL, gets the address of the peer
+int receive_OSC (OSC_space_t space, int sockfd, struct sockaddr_in* sender);
+
+// Datagrams read from a socket by a thread of their own, as soon as
+// they arrive and all of them at once (recvmmsg), and parsed later by
+// the thread using them, between its other work
+typedef struct osc_input_s* osc_input_t;
+
+typedef struct osc_input_stats_s* osc_input_stats_t;
+struct osc_input_stats_s {
+  unsigned long datagrams; // Queued
+  unsigned long truncated; // Larger than OSC_MAX_PACKET_SIZE, dropped
+  unsigned long dropped; // Lost because the queue was full
+  unsigned long errors; // Failed reads
+};
+
+// Returns NULL if the thread can't be started
+osc_input_t osc_input_new (int sockfd);
+// Stops the thread, the socket is left open
+void osc_input_free (osc_input_t input);
+int osc_input_get_socket (osc_input_t input);
+// Readable while datagrams are waiting, for select
+int osc_input_get_wake_fd (osc_input_t input);
+// Parses the datagrams waiting in space, each after its sender is
+// written in 'sender' if not NULL.  Returns their number.
+int osc_input_parse (osc_input_t input, OSC_space_t space,
+                     struct sockaddr_in* sender);
+void osc_input_get_stats (osc_input_t input, osc_input_stats_t stats);
 
 int send_packet (int sockfd,
              struct sockaddr* host_addr,
@@ -39,6 +74,24 @@ int send_packet (int sockfd,
              const char* buf,
              int size);
 
+// Messages of a frame, sent together
+typedef struct send_frame_s* send_frame_t;
+
+// 'bundle_size' is the size of the bundles the messages are gathered
+// in, one for every target as long as it fits (a message larger than
+// that has a bundle of its own); 0 to send them as they are.
+send_frame_t send_frame_new (int bundle_size);
+void send_frame_free (send_frame_t frame);
+void send_frame_set_bundle_size (send_frame_t frame, int bundle_size);
+// The messages sent by this thread from send_frame_begin are kept in
+// 'frame' and sent by send_frame_end, in one system call where
+// possible (sendmmsg).
+void send_frame_begin (send_frame_t frame);
+int send_frame_end (void);
+// Time tag of the bundles of the frame being collected (see OSC.h),
+// OSC_TIME_TAG_IMMEDIATELY from send_frame_begin
+void send_frame_set_time_tag (send_frame_t frame, uint64_t time_tag);
+
 int send_record (int sockfd,
              struct sockaddr_in* host_addr,
              int bird,
@@ -77,3 +130,15 @@ int send_enter_leave (int sockfd,
 int load_iset (int sockfd,
 			struct sockaddr_in * host_addr,
 			int iset_number);
+
+int send_upload (int sockfd,
+                 struct sockaddr_in * host_addr,
+                 int iset_number,
+                 int result);
+
+int send_sensor_set (int sockfd,
+                     struct sockaddr_in * host_addr,
+                     int bird,
+                     int iset_number);
+
+#endif
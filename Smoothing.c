@@ -7,6 +7,9 @@
  *
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "Smoothing.h"
 
 
@@ -46,3 +49,96 @@ void smoothing (float alpha, int w_size, float *new_ech, float ech_in[])
 	*new_ech=ech_out;
 }//smoothing
 
+
+/* Smoothing filter */
+
+struct smoothing_filter_s {
+	int w_size;
+	int channels;
+	int stride; // channels rounded up for the vector units
+	float coeffs[MAX_SIZE]; // coeffs[i] weights the sample of age i + 1
+	float sum;
+	int head; // slot of the last sample
+	float *history; // w_size slots of stride values
+	float *out;
+};
+
+smoothing_filter_t smoothing_filter_new (float alpha, int w_size, int channels)
+{
+	if(w_size > MAX_SIZE)
+		w_size = MAX_SIZE;
+	if(w_size < 1)
+		w_size = 1;
+
+	smoothing_filter_t filter = calloc (1, sizeof (*filter));
+	filter->w_size = w_size;
+	filter->channels = channels;
+	filter->stride = (channels + 15) & ~15;
+
+	// Same weights, summed in the same order, as smoothing()
+	float sum = 0.0;
+	int i;
+	for (i=(w_size-1); i>0; i--)
+	{
+		filter->coeffs[i] = pow((double)(w_size-i)/(double)w_size,alpha);
+		sum+= filter->coeffs[i];
+	}
+	filter->coeffs[0] = 1;
+	filter->sum = sum + 1;
+
+	void *p = NULL;
+	if (posix_memalign (&p, 64, (w_size + 1) * filter->stride * sizeof (float)) != 0)
+	{
+		free (filter);
+		return NULL;
+	}
+	filter->history = p;
+	filter->out = filter->history + w_size * filter->stride;
+	smoothing_filter_reset (filter);
+	return filter;
+}
+
+void smoothing_filter_free (smoothing_filter_t filter)
+{
+	if (filter == NULL) return;
+	free (filter->history);
+	free (filter);
+}
+
+void smoothing_filter_reset (smoothing_filter_t filter)
+{
+	memset (filter->history, 0, filter->w_size * filter->stride * sizeof (float));
+	filter->head = 0;
+}
+
+void smoothing_filter_process (smoothing_filter_t filter, float* values)
+{
+	const int w_size = filter->w_size;
+	const int stride = filter->stride;
+	const int n = filter->channels;
+	float *restrict out = filter->out;
+	int c, i;
+
+	for (c = 0; c < n; c++)
+		out[c] = 0.0;
+
+	// The sample of age a is in slot (head + a - 1) % w_size.  As in
+	// smoothing(), the previous sample (age 1) is not weighted.
+	for (i=(w_size-1); i>0; i--)
+	{
+		const float *restrict h = filter->history + ((filter->head + i) % w_size) * stride;
+		const float coeff = filter->coeffs[i];
+		for (c = 0; c < n; c++)
+			out[c] += h[c] * coeff;
+	}
+
+	// The oldest slot gets the new samples
+	filter->head = (filter->head + w_size - 1) % w_size;
+	float *restrict h = filter->history + filter->head * stride;
+	const float sum = filter->sum;
+	for (c = 0; c < n; c++)
+	{
+		h[c] = values[c];
+		values[c] = (out[c] + values[c]) / sum;
+	}
+}//smoothing_filter_process
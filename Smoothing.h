@@ -7,8 +7,37 @@
  *
  */
 
+#ifndef __Smoothing_h__
+#define __Smoothing_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #include <math.h>
 
 #define MAX_SIZE 20
 
-void smoothing (float alpha, int w_size, float *new_ech, float ech_in[]); // Smoothing function prototype
\ No newline at end of file
+// Parameters used for the speed and the acceleration of the sticks
+#define SPEED_SMOOTHING_ALPHA 0.9
+#define ACCEL_SMOOTHING_ALPHA 1.1
+#define SMOOTHING_WINDOW 11
+
+void smoothing (float alpha, int w_size, float *new_ech, float ech_in[]); // Smoothing function prototype
+
+// Same filter as smoothing() for a number of channels at once (the
+// three axes of every sensor), with the weights computed once and the
+// history kept in a ring instead of being shifted.  The results are
+// identical to smoothing() on each channel.
+typedef struct smoothing_filter_s* smoothing_filter_t;
+
+smoothing_filter_t smoothing_filter_new (float alpha, int w_size, int channels);
+void smoothing_filter_free (smoothing_filter_t filter);
+// Forgets the history (as a window filled with zeros)
+void smoothing_filter_reset (smoothing_filter_t filter);
+// Replaces values[0 .. channels - 1] by their smoothed value
+void smoothing_filter_process (smoothing_filter_t filter, float* values);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -10,11 +10,6 @@
 #include <math.h>
 #include "Standardization.h"
 
-//_____VARIABLES_TO_NORMALIZE_POLHEMUS_DATA_(WHICH COMES IN CENTIMETRES)_____//
-#define MAX_X_DIST 150.
-#define MAX_Y_DIST 150.
-#define MAX_Z_DIST 150.
-//___________________________________________________________________________//
 
 	
 // fonction de normalisation des données de position (normalisation par rapport à un cube)
@@ -62,16 +57,16 @@ void bird_data_normalize(float* x, float* y, float* z, float* prev_x, float* pre
  void bird_speed_normalize(float* dx, float* dy, float* dz){
 
 	//normailsation de la vitesse
-	*dx *= 20.;
-	*dy *= 20.;
-	*dz *= 20.;
+	*dx *= SPEED_FACTOR;
+	*dy *= SPEED_FACTOR;
+	*dz *= SPEED_FACTOR;
 	}
 
 // fonction de normalisation de l'accélération	
  void bird_accel_normalize(float* accelx, float* accely, float* accelz){
 	
 	//normalisation de l'accélération
-	*accelx *= 10.;
-	*accely *= 10.;
-	*accelz *= 10.;
+	*accelx *= ACCEL_FACTOR;
+	*accely *= ACCEL_FACTOR;
+	*accelz *= ACCEL_FACTOR;
 	}
\ No newline at end of file
@@ -7,6 +7,14 @@
  *
  */
 
+//_____VARIABLES_TO_NORMALIZE_POLHEMUS_DATA_(WHICH COMES IN CENTIMETRES)_____//
+#define MAX_X_DIST 150.
+#define MAX_Y_DIST 150.
+#define MAX_Z_DIST 150.
+#define SPEED_FACTOR 20.
+#define ACCEL_FACTOR 10.
+//___________________________________________________________________________//
+
 void bird_data_normalize(float* x, float* y, float* z, float* prev_x, float* prev_y, float* prev_z);
 void bird_angle_normalize(float* za, float* ya, float* xa);
 void bird_speed_normalize(float* dx, float* dy, float* dz);
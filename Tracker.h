@@ -18,11 +18,20 @@
 
 #import <Cocoa/Cocoa.h>
 #include "bird_record.h"
+#include "tracker_backend.h"
 
+// Objective-C face of a tracker_t (see tracker_backend.h).
 @interface Tracker : NSObject {
   NSString* error;
+  tracker_t tracker;
 }
 
+// Returns nil if no backend has this name or label.
+- (id) initWithBackend: (const char*) name;
+- (tracker_t) backend;
+- (int) getFlags;
+- (int) getNumberOfBirds;
+- (void) getStats: (tracker_stats_t) stats;
 - (void) open: (NSString*) file;
 - (void) close;
 - (int) getFileDescriptor;
@@ -20,31 +20,65 @@
 @implementation Tracker
 
 - (id) init {
+  return [self initWithBackend:0];
+}
+
+- (id) initWithBackend: (const char*) name {
   self = [super init];
-  if (self)
+  if (self) {
     [self setErrorString:0];
+    tracker = tracker_new (name);
+    if (!tracker) {
+      [self release];
+      return nil;
+    }
+  }
   return self;
 }
 
 - (void) dealloc {
+  tracker_free (tracker);
   [self setErrorString:0];
   [super dealloc];
 }
 
+- (tracker_t) backend {
+  return tracker;
+}
+
+- (int) getFlags {
+  return tracker_get_flags (tracker);
+}
+
+- (int) getNumberOfBirds {
+  return tracker_get_number_of_birds (tracker);
+}
+
+- (void) getStats: (tracker_stats_t) stats {
+  tracker_get_stats (tracker, stats);
+}
+
 - (void) open: (NSString*) file {
+  if (tracker_open (tracker, [file UTF8String]))
+    [self setErrorString:[NSString stringWithUTF8String:tracker_get_error_string (tracker)]];
 }
 
 - (void) close {
+  tracker_close (tracker);
+  [self setErrorString:0];
 }
 
 - (int) getFileDescriptor {
-  return -1;
+  return tracker_get_file_descriptor (tracker);
 }
 
 - (void) readNextRecord {
+  if (tracker_read_next_record (tracker))
+    [self setErrorString:[NSString stringWithUTF8String:tracker_get_error_string (tracker)]];
 }
 
 - (void) getBirdRecord: (int) bird record: (bird_record_t) record {
+  tracker_fill_bird_record (tracker, bird, record);
 }
 
 - (void) setErrorString: (NSString*) string {
@@ -57,4 +91,3 @@
 }
 
 @end
-
@@ -0,0 +1,297 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Compares the instrument queries through the spatial index of the
+// sets (first instrument, and all the instruments containing the
+// sensor) with the linear scan they replaced, on sticks moving
+// through the sets, and checks that they find the same instruments.
+//
+//   iset_bench [set files]
+//
+// The set files are relative to the current directory (default
+// ../ManyInstruments.txt ../Keyboard.txt); a set of 5000 random
+// instruments and a keyboard of 1708 instruments are added: 25 rows of
+// 40 white and 28 black keys, and 8 others.
+//
+// Build: cc -std=gnu99 -O2 -I.. -o iset_bench iset_bench.c ../iset.c -lm
+// (add -mavx for the 8 lanes containment tests of the crowded sets)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "iset.h"
+
+#define STICKS 2
+#define FRAMES 100000
+#define SYNTHETIC_INSTRUMENTS 5000
+#define KEYBOARD_COLUMNS 40 // Of white keys, black keys in between
+#define KEYBOARD_ROWS 25
+
+static double now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float uniform (unsigned* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return ((*seed >> 8) & 0xffff) / 65536.f;
+}
+
+// iset_get_instrument before the index, which wrote the deltas in the
+// instrument
+static void linear_query (iset_t iset, float x, float y, float z, iset_hit_t hit) {
+  for (int i = 0; i < iset->number_of_instruments; i++) {
+    instrument_t inst = iset->instruments[i];
+    hit->delta_x = x - inst->posX;
+    hit->delta_y = y - inst->posY;
+    hit->delta_z = z - inst->posZ;
+
+    switch (inst->type) {
+    case BOX:
+      if ((fabs ((double)(hit->delta_x)) < 0.5 * inst->param1) &&
+          (fabs ((double)(hit->delta_y)) < 0.5 * inst->param2) &&
+          (fabs ((double)(hit->delta_z)) < 0.5 * inst->param3)) {
+        hit->delta_x /= 0.5 * inst->param1;
+        hit->delta_y /= 0.5 * inst->param2;
+        hit->delta_z /= 0.5 * inst->param3;
+        hit->instrument = inst;
+        return;
+      }
+      break;
+    case CYLINDER:
+      if (((hit->delta_x * hit->delta_x +
+            hit->delta_y * hit->delta_y) <
+           (0.5 * inst->param2) * (0.5 * inst->param2)) &&
+          (fabs ((double)(hit->delta_z)) < 0.5 * inst->param3)) {
+        hit->delta_x /= 0.5 * inst->param2;
+        hit->delta_y /= 0.5 * inst->param2;
+        hit->delta_z /= 0.5 * inst->param3;
+        hit->instrument = inst;
+        return;
+      }
+      break;
+    case SPHERE:
+      if ((hit->delta_x * hit->delta_x +
+           hit->delta_y * hit->delta_y +
+           hit->delta_z * hit->delta_z) <
+          (0.5 * inst->param2) * (0.5 * inst->param2)) {
+        hit->delta_x /= 0.5 * inst->param2;
+        hit->delta_y /= 0.5 * inst->param2;
+        hit->delta_z /= 0.5 * inst->param2;
+        hit->instrument = inst;
+        return;
+      }
+      break;
+    }
+  }
+
+  hit->instrument = NULL;
+}
+
+// Small volumes of every type in [-1, 1]^3
+static int write_synthetic_set (const char* filename, int instruments) {
+  FILE* file = fopen (filename, "w");
+  if (file == NULL) return -1;
+
+  unsigned seed = 7;
+  fprintf (file, "SET DESCRIPTION FILE\n");
+  for (int i = 0; i < instruments; i++) {
+    int type = i % 3;
+    fprintf (file, "Instrument #%d\nSynthetic %d\n%d\n-1 -1\n", i, i, type);
+    fprintf (file, "%f %f %f\n",
+             2.f * uniform (&seed) - 1.f,
+             2.f * uniform (&seed) - 1.f,
+             2.f * uniform (&seed) - 1.f);
+    fprintf (file, "%f %f %f\n",
+             0.02f + 0.08f * uniform (&seed),
+             0.02f + 0.08f * uniform (&seed),
+             0.02f + 0.08f * uniform (&seed));
+    fprintf (file, "0 0 0 0 0 0 0 0\n0.5 0.5 0.5\n");
+  }
+
+  return fclose (file);
+}
+
+static void write_instrument (FILE* file, int i, int type, int keyboard,
+                              float x, float y, float z,
+                              float sx, float sy, float sz) {
+  fprintf (file, "Instrument #%d\nKey %d\n%d\n-1 %d\n", i, i, type, keyboard);
+  fprintf (file, "%f %f %f\n%f %f %f\n", x, y, z, sx, sy, sz);
+  fprintf (file, "0 0 0 0 0 0 0 0\n0.5 0.5 0.5\n");
+}
+
+// Rows of keys over [-1, 1]^2 as in Keyboard.txt: white keys side by
+// side along y, black keys between them on the next column, with a few
+// spheres over them and a few keys of another size
+static int write_synthetic_keyboard (const char* filename) {
+  FILE* file = fopen (filename, "w");
+  if (file == NULL) return -1;
+
+  float px = 2.f / (2 * KEYBOARD_ROWS), py = 2.f / KEYBOARD_COLUMNS;
+  int i = 0;
+  fprintf (file, "SET DESCRIPTION FILE\n");
+  for (int s = 0; s < 4; s++, i++)
+    write_instrument (file, i, 2, -1, -0.5f + 0.3f * s, 0.2f * s, 0.f,
+                      0.2f, 0.2f, 0.2f);
+  for (int r = 0; r < KEYBOARD_ROWS; r++)
+    for (int c = 0; c < KEYBOARD_COLUMNS; c++) {
+      float x = -1.f + (2 * r + 0.5f) * px, y = -1.f + (c + 0.5f) * py;
+      write_instrument (file, i++, 0, 0, x, y, 0.f, px, py, 0.6f);
+      if (c % 7 != 2 && c % 7 != 6 && c + 1 < KEYBOARD_COLUMNS)
+        write_instrument (file, i++, 0, 0, x + px, y + 0.5f * py, 0.1f,
+                          px, py, 0.6f);
+    }
+  for (int k = 0; k < 4; k++, i++)
+    write_instrument (file, i, 0, 0, 0.1f * k, -0.3f * k, 0.05f,
+                      0.5f * px, py, 0.6f);
+
+  return fclose (file);
+}
+
+// Sticks wandering in [-1, 1]^3, as the tracker would give them
+static void move (float p[3], float v[3], unsigned* seed) {
+  for (int a = 0; a < 3; a++) {
+    v[a] = 0.98f * v[a] + 0.002f * (uniform (seed) - 0.5f);
+    p[a] += v[a];
+    if (p[a] < -1.f || p[a] > 1.f) {
+      v[a] = -v[a];
+      p[a] += 2.f * v[a];
+    }
+  }
+}
+
+// Instrument found and position in it
+struct result_s {
+  int index;
+  float delta_x, delta_y, delta_z;
+};
+
+static void result (struct result_s* r, iset_hit_t hit) {
+  instrument_t inst = hit->instrument;
+  r->index = inst ? inst->index : -1;
+  r->delta_x = inst ? hit->delta_x : 0.f;
+  r->delta_y = inst ? hit->delta_y : 0.f;
+  r->delta_z = inst ? hit->delta_z : 0.f;
+}
+
+static unsigned long compare (const struct result_s* a,
+                              const struct result_s* b, int n) {
+  unsigned long mismatches = 0;
+  for (int i = 0; i < n; i++)
+    mismatches += memcmp (&a[i], &b[i], sizeof (a[i])) != 0;
+  return mismatches;
+}
+
+static void bench (const char* filename) {
+  iset_t iset = iset_make (filename, filename[0] == '/' ? "" : ".");
+  if (iset->number_of_instruments == 0) {
+    fprintf (stderr, "%s: no instruments\n", filename);
+    iset_free (iset);
+    return;
+  }
+
+  int n = FRAMES * STICKS;
+  float (*points)[3] = malloc (n * sizeof (*points));
+  struct result_s* linear = malloc (n * sizeof (*linear));
+  struct result_s* grid = malloc (n * sizeof (*grid));
+  struct result_s* all = malloc (n * sizeof (*all));
+  struct iset_hit_s found[8];
+
+  float p[STICKS][3] = { { 0 } }, v[STICKS][3] = { { 0 } };
+  unsigned seed = 1;
+  for (int i = 0; i < n; i++) {
+    move (p[i % STICKS], v[i % STICKS], &seed);
+    memcpy (points[i], p[i % STICKS], sizeof (points[i]));
+  }
+
+  double t0 = now ();
+  for (int i = 0; i < n; i++) {
+    linear_query (iset, points[i][0], points[i][1], points[i][2], found);
+    result (&linear[i], found);
+  }
+  double t1 = now ();
+  for (int i = 0; i < n; i++) {
+    iset_query (iset, points[i][0], points[i][1], points[i][2], found);
+    result (&grid[i], found);
+  }
+  double t2 = now ();
+  for (int i = 0; i < n; i++) {
+    // The first of all the instruments containing the sensor
+    if (iset_query_all (iset, points[i][0], points[i][1], points[i][2],
+                        found, 8) == 0)
+      found[0].instrument = NULL;
+    result (&all[i], found);
+  }
+  double t3 = now ();
+
+  unsigned long hits = 0;
+  for (int i = 0; i < n; i++)
+    hits += linear[i].index != -1;
+
+  printf ("%-24s %6d %6.1f%% %9.1f ns %9.1f ns %9.1f ns %10lu\n",
+          filename[0] != '/' ? filename :
+          strstr (filename, "keyboard") ? "synthetic keyboard" : "synthetic",
+          iset->number_of_instruments, 100. * hits / n,
+          (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n, (t3 - t2) * 1e9 / n,
+          compare (linear, grid, n) + compare (linear, all, n));
+
+  free (points);
+  free (linear);
+  free (grid);
+  free (all);
+  iset_free (iset);
+}
+
+int main (int argc, char** argv) {
+  char synthetic[] = "/tmp/iset_benchXXXXXX";
+  int fd = mkstemp (synthetic);
+  if (fd == -1 || write_synthetic_set (synthetic, SYNTHETIC_INSTRUMENTS) == -1) {
+    perror (synthetic);
+    return 1;
+  }
+  close (fd);
+
+  char keyboard[] = "/tmp/iset_keyboardXXXXXX";
+  fd = mkstemp (keyboard);
+  if (fd == -1 || write_synthetic_keyboard (keyboard) == -1) {
+    perror (keyboard);
+    return 1;
+  }
+  close (fd);
+
+  printf ("%-24s %6s %7s %12s %12s %12s %10s\n", "set", "instr", "hits",
+          "linear", "grid", "all", "mismatches");
+
+  if (argc > 1)
+    for (int i = 1; i < argc; i++)
+      bench (argv[i]);
+  else {
+    bench ("../ManyInstruments.txt");
+    bench ("../Keyboard.txt");
+  }
+  bench (synthetic);
+  bench (keyboard);
+
+  unlink (synthetic);
+  unlink (keyboard);
+  return 0;
+}
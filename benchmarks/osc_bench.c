@@ -0,0 +1,286 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Compares the encoding of the messages sent for every frame (/record,
+// /bump, /enter) with OSC_message_make, as Send.c used to, and with
+// the OSC templates, counts the allocations of both, and checks that
+// they give the same bytes.  Then compares the dispatch of the
+// messages received through the hash table of the methods with the
+// linear search it replaced, for spaces of more and more methods, and
+// times address patterns.
+//
+//   osc_bench [messages]
+//
+// OSC.c is included here to count its allocations.
+//
+// Build: cc -std=gnu99 -O2 -I.. -I../libflock/flockUtils -o osc_bench osc_bench.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static unsigned long allocations = 0;
+static volatile unsigned sink; // Keeps the encoding
+
+static void* counted_malloc (size_t size) {
+  allocations++;
+  return malloc (size);
+}
+
+static void* counted_realloc (void* p, size_t size) {
+  allocations++;
+  return realloc (p, size);
+}
+
+#define malloc counted_malloc
+#define realloc counted_realloc
+#include "OSC.c"
+#undef malloc
+#undef realloc
+
+enum { RECORD, BUMP, ENTER, NUMBER_OF_KINDS };
+
+static const char* names[NUMBER_OF_KINDS] = { "/record", "/bump", "/enter" };
+static const char* typetags[NUMBER_OF_KINDS] =
+  { ",iiffffffffffff", ",iifffffff", ",ii" };
+
+static double now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float input (unsigned* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return ((*seed >> 8) & 0xffff) / 65536.f - 0.5f;
+}
+
+// Arguments of message i: two integers and floats
+static void arguments (int i, int* ints, float* floats) {
+  unsigned seed = i;
+  ints[0] = i % 16 + 1;
+  ints[1] = i % 7;
+  for (int k = 0; k < 12; k++)
+    floats[k] = input (&seed);
+}
+
+// Sum of the bytes of a message
+static unsigned checksum (const char* buffer, int size) {
+  unsigned sum = 0;
+  for (int k = 0; k < size; k++)
+    sum = sum * 31 + (unsigned char) buffer[k];
+  return sum;
+}
+
+static unsigned encode_message (int kind, int i) {
+  int ints[2];
+  float f[12];
+  OSC_message_t m;
+
+  arguments (i, ints, f);
+  if (kind == RECORD)
+    m = OSC_message_make ("/record", ",iiffffffffffff", &ints[0], &ints[1],
+                          &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+                          &f[6], &f[7], &f[8], &f[9], &f[10], &f[11]);
+  else if (kind == BUMP)
+    m = OSC_message_make ("/bump", ",iifffffff", &ints[0], &ints[1],
+                          &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6]);
+  else
+    m = OSC_message_make ("/enter", ",ii", &ints[0], &ints[1]);
+
+  OSC_message_packet_t p = OSC_message_packet (m);
+  unsigned sum = checksum (p->buffer, p->size);
+  OSC_message_free (m);
+  return sum;
+}
+
+static unsigned encode_template (OSC_template_t t, int kind, int i) {
+  int ints[2];
+  float f[12];
+  int floats = kind == RECORD ? 12 : kind == BUMP ? 7 : 0;
+
+  arguments (i, ints, f);
+  OSC_template_set_int (t, 0, ints[0]);
+  OSC_template_set_int (t, 1, ints[1]);
+  for (int k = 0; k < floats; k++)
+    OSC_template_set_float (t, 2 + k, f[k]);
+  return checksum (t->buffer, t->size);
+}
+
+//_____________DISPATCH_______________________________________//
+
+// Sum of the numbers of the methods called, and their count
+static unsigned long calls = 0;
+static unsigned long matches = 0;
+
+static int count_call (const char* arguments, void* callback_data) {
+  calls += (unsigned long) callback_data;
+  matches++;
+  return 0;
+}
+
+// parse_leaf before the hash table: the first method with the name and
+// the type tag
+static int linear_parse (OSC_space_t space, const char* buffer, int maxsize) {
+  int name_boundary = OSC_STRING_BOUNDARY (buffer);
+  int typetag_boundary = OSC_STRING_BOUNDARY (buffer + name_boundary);
+
+  if (parse_args (space, buffer + name_boundary, maxsize - name_boundary) == -1)
+    return -1;
+
+  for (int i = 0; i < space->nmethods; i++) {
+    if (strcmp (buffer, space->methods[i]->name) != 0)
+      continue;
+    if (strcmp (buffer + name_boundary, space->methods[i]->typetag) != 0)
+      continue;
+    return space->methods[i]->callback
+      (buffer + name_boundary + typetag_boundary,
+       space->methods[i]->callback_data);
+  }
+  return 0;
+}
+
+static void bench_dispatch (int messages) {
+  const int counts[] = { 16, 128, 1024 };
+  const char* patterns[] = { "/sensor/1?/gain", "/sensor/*/gain",
+                             "/sensor/[0-4]/{gain,pan}" };
+  float value = 0.5f;
+
+  printf ("\n%8s %12s %12s %10s\n", "methods", "linear ns", "hash ns",
+          "mismatches");
+
+  for (size_t k = 0; k < sizeof (counts) / sizeof (counts[0]); k++) {
+    int n = counts[k];
+    OSC_space_t space = OSC_space_make ();
+    OSC_message_t* received = malloc (n * sizeof (*received));
+    char name[64];
+
+    // Per sensor methods, the last one registered found last
+    for (int i = 0; i < n; i++) {
+      snprintf (name, sizeof (name), "/sensor/%d/gain", i);
+      OSC_space_register_method
+        (space, OSC_method_make (name, ",f", count_call, (void*) (long) (i + 1)));
+      received[i] = OSC_message_make (name, ",f", &value);
+    }
+
+    calls = 0;
+    double start = now ();
+    for (int i = 0; i < messages; i++) {
+      OSC_message_packet_t p = OSC_message_packet (received[i % n]);
+      linear_parse (space, p->buffer, p->size);
+    }
+    double linear_time = now () - start;
+    unsigned long linear_calls = calls;
+
+    calls = 0;
+    start = now ();
+    for (int i = 0; i < messages; i++) {
+      OSC_message_packet_t p = OSC_message_packet (received[i % n]);
+      OSC_space_parse (space, p->buffer, p->size);
+    }
+    double hash_time = now () - start;
+
+    printf ("%8d %12.1f %12.1f %10d\n", n, linear_time * 1e9 / messages,
+            hash_time * 1e9 / messages, calls != linear_calls);
+
+    // Address patterns, for the largest space
+    if (k + 1 == sizeof (counts) / sizeof (counts[0]))
+      for (size_t j = 0; j < sizeof (patterns) / sizeof (patterns[0]); j++) {
+        OSC_message_t m = OSC_message_make ((char*) patterns[j], ",f", &value);
+        OSC_message_packet_t p = OSC_message_packet (m);
+        int repeats = messages / n + 1;
+
+        // The first one compiles the pattern, the others find it
+        matches = 0;
+        start = now ();
+        OSC_space_parse (space, p->buffer, p->size);
+        double first_time = now () - start;
+        unsigned long matched = matches;
+        start = now ();
+        for (int i = 0; i < repeats; i++)
+          OSC_space_parse (space, p->buffer, p->size);
+        printf ("%26s: %4lu methods, first %8.1f ns, then %8.1f ns\n",
+                patterns[j], matched, first_time * 1e9,
+                (now () - start) * 1e9 / repeats);
+        OSC_message_free (m);
+      }
+
+    for (int i = 0; i < n; i++)
+      OSC_message_free (received[i]);
+    free (received);
+    OSC_space_free (space);
+  }
+}
+
+int main (int argc, char** argv) {
+  int messages = argc > 1 ? atoi (argv[1]) : 1000000;
+  static struct OSC_template_s templates[NUMBER_OF_KINDS];
+
+  OSC_init ();
+  printf ("%8s %12s %12s %12s %12s %10s\n", "message",
+          "make ns", "make allocs", "template ns", "tmpl allocs", "mismatches");
+
+  for (int kind = 0; kind < NUMBER_OF_KINDS; kind++) {
+    unsigned long start_allocations = allocations;
+    OSC_template_init (&templates[kind], names[kind], typetags[kind]);
+    unsigned long init_allocations = allocations - start_allocations;
+
+    // Same bytes
+    int mismatches = 0;
+    for (int i = 0; i < 1000; i++) {
+      int ints[2];
+      float f[12];
+      arguments (i, ints, f);
+      OSC_message_t m = OSC_message_make
+        ((char*) names[kind], (char*) typetags[kind], &ints[0], &ints[1],
+         &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+         &f[6], &f[7], &f[8], &f[9], &f[10], &f[11]);
+      OSC_message_packet_t p = OSC_message_packet (m);
+      encode_template (&templates[kind], kind, i);
+      if (p->size != templates[kind].size ||
+          memcmp (p->buffer, templates[kind].buffer, p->size) != 0)
+        mismatches++;
+      OSC_message_free (m);
+    }
+
+    unsigned sum = 0;
+    start_allocations = allocations;
+    double start = now ();
+    for (int i = 0; i < messages; i++)
+      sum += encode_message (kind, i);
+    double make_time = now () - start;
+    unsigned long make_allocations = allocations - start_allocations;
+
+    start_allocations = allocations;
+    start = now ();
+    for (int i = 0; i < messages; i++)
+      sum += encode_template (&templates[kind], kind, i);
+    double template_time = now () - start;
+    unsigned long template_allocations = allocations - start_allocations
+      + init_allocations;
+
+    sink = sum;
+    printf ("%8s %12.1f %12.2f %12.1f %12.2f %10d\n", names[kind],
+            make_time * 1e9 / messages, (double) make_allocations / messages,
+            template_time * 1e9 / messages,
+            (double) template_allocations / messages, mismatches);
+  }
+
+  bench_dispatch (messages);
+  return 0;
+}
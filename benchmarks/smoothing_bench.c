@@ -0,0 +1,93 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Compares smoothing(), called for every axis of every sensor as the
+// pipeline used to, with a smoothing_filter over all of them, and
+// checks that both give the same values.
+//
+//   smoothing_bench [frames]
+//
+// Build: cc -std=gnu99 -O2 -I.. -o smoothing_bench smoothing_bench.c ../Smoothing.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Smoothing.h"
+
+#define MAX_SENSORS 64
+
+static double now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float input (unsigned* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return ((*seed >> 8) & 0xffff) / 65536.f - 0.5f;
+}
+
+int main (int argc, char** argv) {
+  int frames = argc > 1 ? atoi (argv[1]) : 100000;
+  const int counts[] = { 2, 8, 16, 64 };
+  static float windows[MAX_SENSORS * 3][MAX_SIZE];
+  static float values[MAX_SENSORS * 3];
+  static float old_values[MAX_SENSORS * 3];
+
+  printf ("%8s %14s %14s %8s %10s\n",
+          "sensors", "smoothing()", "filter", "speedup", "mismatches");
+
+  for (size_t k = 0; k < sizeof (counts) / sizeof (counts[0]); k++) {
+    int channels = 3 * counts[k];
+    smoothing_filter_t filter = smoothing_filter_new
+      (SPEED_SMOOTHING_ALPHA, SMOOTHING_WINDOW, channels);
+    memset (windows, 0, sizeof (windows));
+
+    double old_time = 0., new_time = 0.;
+    unsigned long mismatches = 0;
+    unsigned seed = 1;
+
+    for (int frame = 0; frame < frames; frame++) {
+      for (int c = 0; c < channels; c++)
+        old_values[c] = values[c] = input (&seed);
+
+      double t0 = now ();
+      for (int c = 0; c < channels; c++)
+        smoothing (SPEED_SMOOTHING_ALPHA, SMOOTHING_WINDOW,
+                   &old_values[c], windows[c]);
+      double t1 = now ();
+      smoothing_filter_process (filter, values);
+      double t2 = now ();
+
+      old_time += t1 - t0;
+      new_time += t2 - t1;
+      mismatches += memcmp (values, old_values, channels * sizeof (float)) != 0;
+    }
+
+    // Per sensor and frame
+    double n = (double) frames * counts[k];
+    printf ("%8d %11.1f ns %11.1f ns %7.1fx %10lu\n",
+            counts[k], old_time * 1e9 / n, new_time * 1e9 / n,
+            old_time / new_time, mismatches);
+
+    smoothing_filter_free (filter);
+  }
+
+  return 0;
+}
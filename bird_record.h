@@ -20,6 +20,7 @@
    USA */
 
 #define NUMBER_OF_BIRDS 2
+#define MAX_NUMBER_OF_BIRDS 64
 #define NUMBER_OF_COORDINATES 6
 #define MAX_SIZE 20
 
@@ -57,17 +58,4 @@ struct gameplay_s{
 float up, down, piston, etouf;
 };
 
-
-// Flag structure used in the "bump detection" section
-typedef struct flag_s *flag_t;
-struct flag_s{
-int upward, downward, forward, backward, leftward, rightward, counter;
-};
-
-
-typedef struct velocity_s *velocity_t;
-struct velocity_s{
-float up_down, left_right, for_back, send;
-};
-
 #endif
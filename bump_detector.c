@@ -0,0 +1,306 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "bump_detector.h"
+
+// State of a direction for a sensor
+enum bump_state_e {
+  BUMP_IDLE = 0,
+  BUMP_ARMED, // Moving fast enough along the direction
+  BUMP_BRAKING, // And decelerating
+  BUMP_REFRACTORY, // Just hit, for anti_bounce_delay
+  BUMP_BLOCKED // The opposite direction was hit, for bump_delay
+};
+
+struct bump_detector_s {
+  int sensors;
+  struct bump_params_s params;
+
+  int number_of_directions;
+  struct bump_direction_s directions[BUMP_MAX_DIRECTIONS];
+
+  // [direction][sensor]
+  unsigned char state[BUMP_MAX_DIRECTIONS][MAX_NUMBER_OF_BIRDS];
+  uint64_t since[BUMP_MAX_DIRECTIONS][MAX_NUMBER_OF_BIRDS]; // Time of the state
+  unsigned char hit[BUMP_MAX_DIRECTIONS][MAX_NUMBER_OF_BIRDS];
+
+  struct bump_event_s queue[BUMP_QUEUE_SIZE];
+  unsigned long head;
+  unsigned long tail;
+  unsigned long dropped;
+};
+
+static const struct bump_direction_s default_directions[] = {
+  { "downward", 0, 0, 1, BUMP_FRAME_WORLD, -1, 1 },
+  { "upward", 0, 0, -1, BUMP_FRAME_WORLD, -1, 0 },
+  { "backward", 1, 0, 0, BUMP_FRAME_WORLD, -1, 3 },
+  { "forward", -1, 0, 0, BUMP_FRAME_WORLD, -1, 2 },
+  { "leftward", 0, 1, 0, BUMP_FRAME_WORLD, -1, 5 },
+  { "rightward", 0, -1, 0, BUMP_FRAME_WORLD, -1, 4 }
+};
+
+bump_detector_t bump_detector_new (int sensors) {
+  if (sensors < 1 || sensors > MAX_NUMBER_OF_BIRDS) return NULL;
+
+  bump_detector_t detector = calloc (1, sizeof (*detector));
+  detector->sensors = sensors;
+  bump_params_init (&detector->params);
+  bump_detector_add_default_directions (detector);
+  return detector;
+}
+
+void bump_detector_free (bump_detector_t detector) {
+  free (detector);
+}
+
+void bump_detector_reset (bump_detector_t detector) {
+  memset (detector->state, 0, sizeof (detector->state));
+  memset (detector->since, 0, sizeof (detector->since));
+  detector->head = detector->tail = 0;
+}
+
+//_____________DIRECTIONS_____________________________________//
+
+void bump_detector_clear_directions (bump_detector_t detector) {
+  detector->number_of_directions = 0;
+  bump_detector_reset (detector);
+}
+
+void bump_detector_add_default_directions (bump_detector_t detector) {
+  int first = detector->number_of_directions;
+  if (first + 6 > BUMP_MAX_DIRECTIONS) return;
+
+  for (int i = 0; i < 6; i++) {
+    int index = bump_detector_add_direction (detector, &default_directions[i]);
+    detector->directions[index].opposite = first + default_directions[i].opposite;
+  }
+}
+
+// Copies a direction at an index of the table, and forgets its states
+static void
+set_direction (bump_detector_t detector, int index,
+               const struct bump_direction_s* direction) {
+  bump_direction_t d = &detector->directions[index];
+  *d = *direction;
+  d->name[sizeof (d->name) - 1] = '\0';
+
+  float norm = sqrtf (d->x * d->x + d->y * d->y + d->z * d->z);
+  if (norm > 0.f) {
+    d->x /= norm;
+    d->y /= norm;
+    d->z /= norm;
+  }
+  if (d->opposite >= BUMP_MAX_DIRECTIONS) d->opposite = -1;
+
+  memset (detector->state[index], 0, sizeof (detector->state[index]));
+  memset (detector->since[index], 0, sizeof (detector->since[index]));
+}
+
+int bump_detector_add_direction (bump_detector_t detector,
+                                 const struct bump_direction_s* direction) {
+  if (detector->number_of_directions >= BUMP_MAX_DIRECTIONS) return -1;
+
+  int index = detector->number_of_directions++;
+  set_direction (detector, index, direction);
+  return index;
+}
+
+int bump_detector_put_direction (bump_detector_t detector,
+                                 const struct bump_direction_s* direction) {
+  for (int i = 0; i < detector->number_of_directions; i++) {
+    bump_direction_t d = &detector->directions[i];
+    if (d->instrument == direction->instrument &&
+        strncmp (d->name, direction->name, sizeof (d->name) - 1) == 0) {
+      int opposite = d->opposite;
+      set_direction (detector, i, direction);
+      d->opposite = opposite;
+      return i;
+    }
+  }
+  return bump_detector_add_direction (detector, direction);
+}
+
+int bump_detector_get_number_of_directions (bump_detector_t detector) {
+  return detector->number_of_directions;
+}
+
+bump_direction_t bump_detector_get_direction (bump_detector_t detector,
+                                              int direction) {
+  if (direction < 0 || direction >= detector->number_of_directions)
+    return NULL;
+  return &detector->directions[direction];
+}
+
+int bump_detector_find_direction (bump_detector_t detector, const char* name) {
+  for (int i = 0; i < detector->number_of_directions; i++)
+    if (strcmp (detector->directions[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+//_____________DETECTION______________________________________//
+
+void bump_params_init (bump_params_t params) {
+  params->speed_threshold = 5e-2;
+  params->accel_threshold = -5e-2;
+  params->bump_threshold = 5e-2;
+  params->arm_timeout = 200;
+  params->bump_delay = 300;
+  params->anti_bounce_delay = 100;
+}
+
+void bump_detector_set_params (bump_detector_t detector,
+                               const struct bump_params_s* params) {
+  detector->params = *params;
+}
+
+static void push_event (bump_detector_t detector, const struct bump_event_s* event) {
+  if (detector->head - detector->tail >= BUMP_QUEUE_SIZE) {
+    detector->dropped++;
+    return;
+  }
+  detector->queue[detector->head % BUMP_QUEUE_SIZE] = *event;
+  detector->head++;
+}
+
+void bump_detector_process (bump_detector_t detector,
+                            motion_block_t block, int frame,
+                            const struct bump_sensor_s* sensors) {
+  int n = block->sensors < detector->sensors ? block->sensors : detector->sensors;
+  size_t offset = (size_t) frame * block->stride;
+  const float* dx = block->dx + offset, *dy = block->dy + offset, *dz = block->dz + offset;
+  const float* ax = block->ax + offset, *ay = block->ay + offset, *az = block->az + offset;
+  const bump_params_t params = &detector->params;
+  const uint64_t time = block->time[frame];
+  const uint64_t arm_timeout = params->arm_timeout * 1000000ULL;
+  const uint64_t bump_delay = params->bump_delay * 1000000ULL;
+  const uint64_t anti_bounce_delay = params->anti_bounce_delay * 1000000ULL;
+
+  // Strongest stroke of every sensor in this frame
+  float best[MAX_NUMBER_OF_BIRDS];
+  int best_direction[MAX_NUMBER_OF_BIRDS];
+  for (int s = 0; s < n; s++) {
+    best[s] = -1.f;
+    best_direction[s] = -1;
+  }
+
+  for (int k = 0; k < detector->number_of_directions; k++) {
+    const bump_direction_t d = &detector->directions[k];
+    const float speed_threshold =
+      d->own_thresholds ? d->speed_threshold : params->speed_threshold;
+    const float accel_threshold =
+      d->own_thresholds ? d->accel_threshold : params->accel_threshold;
+    const float bump_threshold =
+      d->own_thresholds ? d->bump_threshold : params->bump_threshold;
+    unsigned char* state = detector->state[k];
+    uint64_t* since = detector->since[k];
+    unsigned char* hit = detector->hit[k];
+
+    for (int s = 0; s < n; s++) {
+      float ux = d->x, uy = d->y, uz = d->z;
+      const float* r = sensors[s].rotation;
+      if (d->frame == BUMP_FRAME_INSTRUMENT && r != NULL) {
+        // Back to the world: by the transpose
+        ux = r[0] * d->x + r[3] * d->y + r[6] * d->z;
+        uy = r[1] * d->x + r[4] * d->y + r[7] * d->z;
+        uz = r[2] * d->x + r[5] * d->y + r[8] * d->z;
+      }
+
+      // Speed and acceleration along the direction
+      float v = ux * dx[s] + uy * dy[s] + uz * dz[s];
+      float a = ux * ax[s] + uy * ay[s] + uz * az[s];
+      int inside = sensors[s].instrument >= 0 &&
+        (d->instrument < 0 || d->instrument == sensors[s].instrument);
+      int st = state[s];
+      hit[s] = 0;
+
+      if (st == BUMP_REFRACTORY || st == BUMP_BLOCKED) {
+        uint64_t delay = st == BUMP_REFRACTORY ? anti_bounce_delay : bump_delay;
+        if (time - since[s] >= delay) st = BUMP_IDLE;
+      }
+      else {
+        if (st == BUMP_IDLE && v > speed_threshold) {
+          st = BUMP_ARMED;
+          since[s] = time;
+        }
+        if (st == BUMP_ARMED) {
+          if (a < accel_threshold)
+            st = BUMP_BRAKING;
+          else if (time - since[s] > arm_timeout)
+            st = BUMP_IDLE;
+        }
+        if (st == BUMP_BRAKING && v < bump_threshold) {
+          if (inside) {
+            st = BUMP_REFRACTORY;
+            since[s] = time;
+            hit[s] = 1;
+            if (-a > best[s]) {
+              best[s] = -a;
+              best_direction[s] = k;
+            }
+          }
+          else {
+            st = BUMP_IDLE;
+          }
+        }
+      }
+
+      state[s] = st;
+    }
+  }
+
+  // Opposite directions, then the events
+  for (int k = 0; k < detector->number_of_directions; k++) {
+    int opposite = detector->directions[k].opposite;
+    if (opposite < 0 || opposite >= detector->number_of_directions) continue;
+
+    for (int s = 0; s < n; s++) {
+      if (!detector->hit[k][s]) continue;
+      detector->state[opposite][s] = sensors[s].fla ? BUMP_IDLE : BUMP_BLOCKED;
+      detector->since[opposite][s] = time;
+    }
+  }
+
+  const float* accel = block->accel + offset;
+  for (int s = 0; s < n; s++) {
+    if (best_direction[s] < 0) continue;
+
+    struct bump_event_s event;
+    event.sensor = s;
+    event.direction = best_direction[s];
+    event.instrument = sensors[s].instrument;
+    event.intensity = accel[s];
+    push_event (detector, &event);
+  }
+}
+
+int bump_detector_next_event (bump_detector_t detector, bump_event_t event) {
+  if (detector->tail == detector->head) return 0;
+  *event = detector->queue[detector->tail % BUMP_QUEUE_SIZE];
+  detector->tail++;
+  return 1;
+}
+
+unsigned long bump_detector_get_dropped (bump_detector_t detector) {
+  return detector->dropped;
+}
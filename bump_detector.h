@@ -0,0 +1,137 @@
+#ifndef __bump_detector_h__
+#define __bump_detector_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Detection of the strokes ("bumps") of the sticks.  A stroke along a
+// direction is a fast move along it (speed threshold), then a
+// deceleration (acceleration threshold), then a stop (bump
+// threshold), inside an instrument.  Directions are unit vectors in a
+// table, the six axes by default, and every direction costs the same
+// for every sensor.  Strokes are queued as events; sending them is up
+// to the caller.
+
+#include "motion_engine.h"
+
+#define BUMP_MAX_DIRECTIONS 32
+#define BUMP_QUEUE_SIZE 256
+
+enum bump_frame_e {
+  // The vector is in the coordinates of the tracker (downward is +z)
+  BUMP_FRAME_WORLD = 0,
+  // The vector is in the coordinates of the instrument, turned by the
+  // rotation given with the sensor
+  BUMP_FRAME_INSTRUMENT
+};
+
+typedef struct bump_direction_s* bump_direction_t;
+struct bump_direction_s {
+  char name[16];
+  float x, y, z; // Unit vector
+  int frame; // bump_frame_e
+  // Index of the instrument the direction is for, -1 for all of them
+  int instrument;
+  // Direction that can't be hit for bump_delay after a stroke
+  // (unless the instrument allows flams), -1 for none
+  int opposite;
+  // Thresholds along the direction, used when 'own_thresholds' is set
+  // (the ones of bump_params_s otherwise)
+  int own_thresholds;
+  float speed_threshold;
+  float accel_threshold;
+  float bump_threshold;
+};
+
+typedef struct bump_params_s* bump_params_t;
+struct bump_params_s {
+  float speed_threshold;
+  float accel_threshold;
+  float bump_threshold;
+  // In milliseconds
+  int arm_timeout; // Time allowed between the move and the deceleration
+  int bump_delay; // Time the opposite direction is blocked
+  int anti_bounce_delay; // Time the direction is blocked
+};
+
+// Where a sensor is, for the current frame
+typedef struct bump_sensor_s* bump_sensor_t;
+struct bump_sensor_s {
+  int instrument; // Index, -1 outside the instruments
+  int fla; // The instrument allows flams: the opposite isn't blocked
+  // 3x3, world to instrument, row major (the to_local of the
+  // instrument), or NULL
+  const float* rotation;
+};
+
+typedef struct bump_event_s* bump_event_t;
+struct bump_event_s {
+  int sensor; // From 0
+  int direction;
+  int instrument;
+  float intensity; // Norm of the acceleration
+};
+
+typedef struct bump_detector_s* bump_detector_t;
+
+extern bump_detector_t bump_detector_new (int sensors);
+extern void bump_detector_free (bump_detector_t detector);
+// Forgets the states and the queued events
+extern void bump_detector_reset (bump_detector_t detector);
+
+// Directions.  The default ones are downward, upward, backward,
+// forward, leftward and rightward, each the opposite of the other.
+extern void bump_detector_clear_directions (bump_detector_t detector);
+extern void bump_detector_add_default_directions (bump_detector_t detector);
+// Returns the index of the direction, or -1 if the table is full.
+// The vector is normalized.
+extern int bump_detector_add_direction (bump_detector_t detector,
+                                        const struct bump_direction_s* direction);
+// Replaces the direction of the same name and instrument, keeping its
+// opposite, or adds it.  Returns its index, or -1 if the table is full.
+extern int bump_detector_put_direction (bump_detector_t detector,
+                                        const struct bump_direction_s* direction);
+extern int bump_detector_get_number_of_directions (bump_detector_t detector);
+extern bump_direction_t bump_detector_get_direction (bump_detector_t detector,
+                                                     int direction);
+extern int bump_detector_find_direction (bump_detector_t detector,
+                                         const char* name);
+
+extern void bump_params_init (bump_params_t params);
+extern void bump_detector_set_params (bump_detector_t detector,
+                                      const struct bump_params_s* params);
+
+// Runs the directions over the first block->sensors sensors of a
+// frame of the block.  sensors[s] tells where sensor s is.  The
+// delays are measured with block->time, which must not decrease.
+extern void bump_detector_process (bump_detector_t detector,
+                                   motion_block_t block, int frame,
+                                   const struct bump_sensor_s* sensors);
+
+// Takes the oldest queued event.  Returns 0 when there is none.
+extern int bump_detector_next_event (bump_detector_t detector,
+                                     bump_event_t event);
+// Events lost because the queue was full
+extern unsigned long bump_detector_get_dropped (bump_detector_t detector);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
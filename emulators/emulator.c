@@ -0,0 +1,279 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/select.h>
+
+#include "emulator.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal (int sig) {
+  running = 0;
+}
+
+static void usage (const char* program, int default_stations, double default_rate) {
+  fprintf (stderr,
+           "Usage: %s [options]\n"
+           "  -s stations   number of stations (default %d)\n"
+           "  -r rate       frames per second (default %g)\n"
+           "  -l link       symbolic link to the pty\n"
+           "  -d prob       probability of dropped bytes in a frame\n"
+           "  -p prob       probability of bad framing bits in a frame\n"
+           "  -e prob       probability of an error code in a frame\n"
+           "  -c code       error code (default 0x75 / 1)\n"
+           "  -S seed       seed of the faults\n"
+           "  -v            log the commands\n",
+           program, default_stations, default_rate);
+}
+
+int emulator_parse_options (emulator_t em, int argc, char** argv,
+                            int default_stations, double default_rate) {
+  em->stations = default_stations;
+  em->rate = default_rate;
+  em->rng = 1;
+  em->master = -1;
+  em->slave = -1;
+
+  int opt;
+  while ((opt = getopt (argc, argv, "s:r:l:d:p:e:c:S:vh")) != -1) {
+    switch (opt) {
+    case 's': em->stations = atoi (optarg); break;
+    case 'r': em->rate = atof (optarg); break;
+    case 'l': em->link = optarg; break;
+    case 'd': em->faults.drop = atof (optarg); break;
+    case 'p': em->faults.phase = atof (optarg); break;
+    case 'e': em->faults.error = atof (optarg); break;
+    case 'c': em->faults.error_code = strtol (optarg, NULL, 0); break;
+    case 'S': em->rng = strtoull (optarg, NULL, 10) | 1; break;
+    case 'v': em->verbose = 1; break;
+    default:
+      usage (argv[0], default_stations, default_rate);
+      return -1;
+    }
+  }
+
+  if (em->stations < 1 || em->stations > EMULATOR_MAX_STATIONS ||
+      em->rate <= 0.) {
+    usage (argv[0], default_stations, default_rate);
+    return -1;
+  }
+
+  return 0;
+}
+
+int emulator_open (emulator_t em) {
+  em->master = posix_openpt (O_RDWR | O_NOCTTY);
+  if (em->master == -1 || grantpt (em->master) || unlockpt (em->master)) {
+    perror ("pty");
+    return -1;
+  }
+
+  const char* name = ptsname (em->master);
+  if (name == NULL) {
+    perror ("ptsname");
+    return -1;
+  }
+  strncpy (em->slave_name, name, sizeof (em->slave_name) - 1);
+
+  // Raw until the driver sets its own attributes
+  em->slave = open (em->slave_name, O_RDWR | O_NOCTTY);
+  if (em->slave == -1) {
+    perror (em->slave_name);
+    return -1;
+  }
+  struct termios tio;
+  tcgetattr (em->slave, &tio);
+  cfmakeraw (&tio);
+  tcsetattr (em->slave, TCSANOW, &tio);
+
+  fcntl (em->master, F_SETFL, O_NONBLOCK);
+
+  if (em->link) {
+    unlink (em->link);
+    if (symlink (em->slave_name, em->link) == -1) {
+      perror (em->link);
+      return -1;
+    }
+  }
+
+  struct sigaction action;
+  memset (&action, 0, sizeof (action));
+  action.sa_handler = handle_signal;
+  sigaction (SIGINT, &action, NULL);
+  sigaction (SIGTERM, &action, NULL);
+
+  printf ("%s emulator on %s\n", em->name, em->link ? em->link : em->slave_name);
+  fflush (stdout);
+  return 0;
+}
+
+void emulator_close (emulator_t em) {
+  if (em->link) unlink (em->link);
+  if (em->slave != -1) close (em->slave);
+  if (em->master != -1) close (em->master);
+}
+
+uint64_t emulator_now () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+double emulator_elapsed (emulator_t em) {
+  return em->start ? (emulator_now () - em->start) / 1e6 : 0.;
+}
+
+// xorshift64*
+double emulator_random (emulator_t em) {
+  em->rng ^= em->rng >> 12;
+  em->rng ^= em->rng << 25;
+  em->rng ^= em->rng >> 27;
+  return ((em->rng * 0x2545F4914F6CDD1DULL) >> 11) * (1. / 9007199254740992.);
+}
+
+void emulator_start_stream (emulator_t em) {
+  em->next_frame = emulator_now ();
+}
+
+int emulator_wait (emulator_t em, int streaming,
+                   unsigned char* buf, size_t size) {
+  while (running) {
+    struct timeval tv;
+    struct timeval* timeout = NULL;
+
+    if (streaming) {
+      uint64_t now = emulator_now ();
+      if (now >= em->next_frame) {
+        em->next_frame += (uint64_t) (1e9 / em->rate);
+        // A late frame is sent, the ones after it keep the rate
+        if (em->next_frame < now) em->next_frame = now;
+        return 0;
+      }
+      uint64_t ns = em->next_frame - now;
+      tv.tv_sec = ns / 1000000000ULL;
+      tv.tv_usec = (ns % 1000000000ULL) / 1000;
+      timeout = &tv;
+    }
+    else {
+      // Checks 'running' now and then
+      tv.tv_sec = 0;
+      tv.tv_usec = 100000;
+      timeout = &tv;
+    }
+
+    fd_set read_fd_set;
+    FD_ZERO (&read_fd_set);
+    FD_SET (em->master, &read_fd_set);
+
+    int sel = select (em->master + 1, &read_fd_set, NULL, NULL, timeout);
+    if (sel == -1 && errno == EINTR) continue;
+    if (sel == -1) {
+      perror ("select");
+      return -1;
+    }
+    if (sel == 0) continue;
+
+    ssize_t len = read (em->master, buf, size);
+    if (len > 0) {
+      if (em->start == 0) em->start = emulator_now ();
+      return len;
+    }
+    // EIO while no process has the slave open, which can't happen as
+    // we keep it open ourselves; anything else is fatal.
+    if (len == -1 && errno != EAGAIN && errno != EIO) {
+      perror ("read");
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+void emulator_station_pose (int station, double t,
+                            float* position, float* angles) {
+  // Every station circles over its own area and strikes twice a second
+  double phase = 0.7 * station;
+  double strike = sin (2. * M_PI * 2. * t + phase);
+
+  position[0] = 0.3 + 0.1 * station / EMULATOR_MAX_STATIONS +
+    0.1 * cos (2. * M_PI * 0.2 * t + phase);
+  position[1] = 0.2 * sin (2. * M_PI * 0.2 * t + phase);
+  position[2] = 0.1 + 0.05 * (strike > 0. ? strike : -0.2 * strike);
+
+  angles[0] = 170. - 20. * position[1];
+  angles[1] = 20. + 40. * strike;
+  angles[2] = 5.;
+}
+
+static void emulator_write (emulator_t em, const unsigned char* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write (em->master, buf, len);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) {
+      // The driver does not read: the bytes are lost, as with a
+      // serial port overrun.
+      em->overruns++;
+      return;
+    }
+    buf += n;
+    len -= n;
+  }
+}
+
+void emulator_send (emulator_t em, const unsigned char* buf, size_t len) {
+  em->frames++;
+
+  if (em->faults.drop > 0. && emulator_random (em) < em->faults.drop) {
+    unsigned char copy[4096];
+    if (len > sizeof (copy)) len = sizeof (copy);
+
+    size_t pos = (size_t) (emulator_random (em) * len);
+    size_t count = 1 + (size_t) (emulator_random (em) * 4);
+    if (pos + count > len) count = len - pos;
+
+    memcpy (copy, buf, pos);
+    memcpy (copy + pos, buf + pos + count, len - pos - count);
+    em->dropped += count;
+    emulator_write (em, copy, len - count);
+    return;
+  }
+
+  emulator_write (em, buf, len);
+}
+
+void emulator_reply (emulator_t em, const void* buf, size_t len) {
+  emulator_write (em, buf, len);
+}
+
+void emulator_print_stats (emulator_t em) {
+  printf ("%lu commands, %lu frames, %lu overruns, "
+          "%lu bytes dropped, %lu phase errors, %lu error codes\n",
+          em->commands, em->frames, em->overruns,
+          em->dropped, em->phase_errors, em->error_codes);
+}
@@ -0,0 +1,102 @@
+#ifndef __emulator_h__
+#define __emulator_h__
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Common parts of the tracker emulators: a pseudo-terminal standing
+// for the serial port, the timing of the frames, the motion of the
+// stations and the injection of transmission errors.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EMULATOR_MAX_STATIONS 16
+
+// Errors injected in the stream sent to the driver.  Probabilities
+// are per frame.
+typedef struct emulator_faults_s* emulator_faults_t;
+struct emulator_faults_s {
+  double drop; // Some bytes of the frame are lost
+  double phase; // Framing bits are wrong (phase bit, "LY" tag)
+  double error; // The device reports error_code
+  int error_code;
+};
+
+typedef struct emulator_s* emulator_t;
+struct emulator_s {
+  const char* name;
+  int master; // Our side of the pty
+  int slave; // Kept open so that the pty survives the driver closing it
+  char slave_name[256];
+  const char* link; // Symbolic link to the slave, or NULL
+  int verbose;
+
+  int stations;
+  double rate; // Frames per second
+  struct emulator_faults_s faults;
+  uint64_t rng;
+
+  uint64_t start; // Time of the first byte received
+  uint64_t next_frame;
+
+  // Statistics
+  unsigned long commands;
+  unsigned long frames;
+  unsigned long overruns; // Frames the driver did not read in time
+  unsigned long dropped; // Bytes removed
+  unsigned long phase_errors;
+  unsigned long error_codes;
+};
+
+// Parses the common options (-s stations, -r rate, -l link, -d drop,
+// -p phase, -e error probability, -c error code, -S seed, -v).
+// Returns 0, or -1 after printing the usage.
+extern int emulator_parse_options (emulator_t em, int argc, char** argv,
+                                   int default_stations, double default_rate);
+
+// Creates the pty and prints the name of the slave.  Returns -1 on
+// error.
+extern int emulator_open (emulator_t em);
+extern void emulator_close (emulator_t em);
+
+extern uint64_t emulator_now (void);
+// Milliseconds since the first byte received, for the logs
+extern double emulator_elapsed (emulator_t em);
+extern double emulator_random (emulator_t em);
+
+// Waits for bytes from the driver until the next frame is due (or
+// forever when streaming is 0).  Returns the number of bytes read into
+// buf, 0 when a frame is due, -1 when the emulator must stop.
+extern int emulator_wait (emulator_t em, int streaming,
+                          unsigned char* buf, size_t size);
+// Schedules the first frame of a stream now
+extern void emulator_start_stream (emulator_t em);
+
+// Position (in [-1, 1]) and angles (in degrees) of a station at time t
+extern void emulator_station_pose (int station, double t,
+                                   float* position, float* angles);
+
+// Writes a frame, after the faults are applied by the caller, except
+// dropped bytes that are applied here.
+extern void emulator_send (emulator_t em, const unsigned char* buf, size_t len);
+// Writes a response to a command, without faults.
+extern void emulator_reply (emulator_t em, const void* buf, size_t len);
+
+extern void emulator_print_stats (emulator_t em);
+
+#endif
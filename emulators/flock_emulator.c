@@ -0,0 +1,359 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Emulates an Ascension Flock of Birds in normal addressing mode on
+// the RS232 port of its master, over a pty, to test libflock without
+// the birds:
+//
+//   flock_emulator -l /tmp/flock -s 2 -r 100 -d 0.001 -p 0.001
+//
+// and open /tmp/flock with the "flock" backend.  RS232 TO FBB,
+// EXAMINE VALUE, CHANGE VALUE (the bird measurement rate sets the
+// frame rate), the record mode commands, POINT, STREAM and GROUP MODE
+// are understood.  Faults: -d drops bytes, -p breaks the phase bits
+// of a record, -e answers the ERROR CODE queries with -c instead of 0.
+//
+// Build: cc -std=gnu99 -O2 -I../libflock/flock -o flock_emulator flock_emulator.c emulator.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flock_command.h"
+#include "emulator.h"
+
+#define NORMAL_ADDRESSING_BIRDS 14
+#define MAX_WORDS 12
+
+struct flock_state_s {
+  int target; // Address of the bird for the next command
+  int group;
+  int stream;
+  unsigned char modes[EMULATOR_MAX_STATIONS];
+
+  // Command being received
+  unsigned char command[32];
+  size_t command_len;
+  size_t command_size;
+};
+
+// Number of data bytes after CHANGE VALUE and the parameter, or -1
+static int change_value_size (unsigned char parameter) {
+  switch (parameter) {
+  case FLOCK_PARAMETER_POSITION_SCALING:
+  case FLOCK_PARAMETER_FILTER_ON_OFF_STATUS:
+  case FLOCK_PARAMETER_BIRD_MEASUREMENT_RATE:
+  case FLOCK_PARAMETER_FBB_HOST_RESPONSE_DELAY:
+    return 2;
+  case FLOCK_PARAMETER_DC_FILTER_CONSTANT_TABLE_ALPHA_MIN:
+  case FLOCK_PARAMETER_DC_FILTER_TABLE_VM:
+  case FLOCK_PARAMETER_DC_FILTER_CONSTANT_TABLE_ALPHA_MAX:
+  case FLOCK_PARAMETER_FBB_ARM:
+    return 14;
+  case FLOCK_PARAMETER_FBB_CONFIGURATION:
+    return 5;
+  case FLOCK_PARAMETER_DISABLE_ENABLE_DATA_READY_OUTPUT:
+  case FLOCK_PARAMETER_CHANGES_DATA_READY_CHARACTER:
+  case FLOCK_PARAMETER_ERROR_DETECT_MASK:
+  case FLOCK_PARAMETER_SUDDEN_OUTPUT_CHANGE_LOCK:
+  case FLOCK_PARAMETER_XYZ_REFERENCE_FRAME:
+  case FLOCK_PARAMETER_GROUP_MODE:
+  case FLOCK_PARAMETER_FBB_AUTO_CONFIGURATION:
+    return 1;
+  }
+  return -1;
+}
+
+// Total size of a command starting with this byte, or 0 if unknown
+static size_t command_size (const unsigned char* command, size_t len) {
+  switch (command[0]) {
+  case FLOCK_COMMAND_EXAMINE_VALUE:
+    return 2;
+  case FLOCK_COMMAND_CHANGE_VALUE:
+    if (len < 2) return 2;
+    return change_value_size (command[1]) == -1 ?
+      0 : 2 + change_value_size (command[1]);
+  case FLOCK_COMMAND_HEMISPHERE:
+    return 3;
+  case FLOCK_COMMAND_ANGLE_ALIGN:
+  case FLOCK_COMMAND_REFERENCE_FRAME:
+    return 13;
+  case FLOCK_COMMAND_BUTTON_MODE:
+  case FLOCK_COMMAND_SYNC:
+    return 2;
+  }
+  return 1;
+}
+
+static int mode_words (unsigned char mode) {
+  switch (mode) {
+  case FLOCK_COMMAND_ANGLES:
+  case FLOCK_COMMAND_POSITION: return 3;
+  case FLOCK_COMMAND_MATRIX: return 9;
+  case FLOCK_COMMAND_QUATERNION: return 4;
+  case FLOCK_COMMAND_POSITION_ANGLES: return 6;
+  case FLOCK_COMMAND_POSITION_MATRIX: return 12;
+  case FLOCK_COMMAND_POSITION_QUATERNION: return 7;
+  }
+  return 0;
+}
+
+// Encodes a bird record: 7 bits per byte, least significant byte
+// first, the phase bit set on the first byte only.
+static size_t encode_bird (emulator_t em, struct flock_state_s* state,
+                           int bird, double t, unsigned char* buf) {
+  unsigned char mode = state->modes[bird];
+  float position[3], angles[3];
+  float values[MAX_WORDS];
+  int words = mode_words (mode);
+
+  emulator_station_pose (bird, t, position, angles);
+  memset (values, 0, sizeof (values));
+
+  switch (mode) {
+  case FLOCK_COMMAND_ANGLES:
+    for (int i = 0; i < 3; i++) values[i] = angles[i] / 180.f;
+    break;
+  case FLOCK_COMMAND_POSITION:
+  case FLOCK_COMMAND_POSITION_ANGLES:
+  case FLOCK_COMMAND_POSITION_MATRIX:
+  case FLOCK_COMMAND_POSITION_QUATERNION:
+    for (int i = 0; i < 3; i++) values[i] = position[i];
+    if (mode == FLOCK_COMMAND_POSITION_ANGLES)
+      for (int i = 0; i < 3; i++) values[3 + i] = angles[i] / 180.f;
+    break;
+  }
+
+  for (int i = 0; i < words; i++) {
+    float v = values[i];
+    if (v > 32767.f / 32768.f) v = 32767.f / 32768.f;
+    if (v < -1.f) v = -1.f;
+    unsigned short word = (unsigned short) (short) (v * 32768.f);
+    buf[2 * i] = (word >> 2) & 0x7f;
+    buf[2 * i + 1] = (word >> 9) & 0x7f;
+  }
+  buf[0] |= 0x80;
+
+  return 2 * words;
+}
+
+static void send_records (emulator_t em, struct flock_state_s* state) {
+  unsigned char buf[EMULATOR_MAX_STATIONS * (2 * MAX_WORDS + 1)];
+  double t = emulator_elapsed (em) / 1000.;
+  size_t len = 0;
+
+  if (state->group) {
+    for (int bird = 0; bird < em->stations; bird++) {
+      len += encode_bird (em, state, bird, t, buf + len);
+      buf[len++] = bird + 1;
+    }
+  }
+  else if (state->target >= 1 && state->target <= em->stations) {
+    len = encode_bird (em, state, state->target - 1, t, buf);
+  }
+
+  if (len == 0) return;
+
+  if (em->faults.phase > 0. && emulator_random (em) < em->faults.phase) {
+    size_t pos = (size_t) (emulator_random (em) * len);
+    if (buf[pos] & 0x80)
+      buf[pos] &= 0x7f;
+    else
+      buf[pos] |= 0x80;
+    em->phase_errors++;
+  }
+
+  emulator_send (em, buf, len);
+}
+
+static void examine_value (emulator_t em, struct flock_state_s* state,
+                           unsigned char parameter) {
+  unsigned char buf[NORMAL_ADDRESSING_BIRDS];
+  size_t len = 0;
+  memset (buf, 0, sizeof (buf));
+
+  switch (parameter) {
+  case FLOCK_PARAMETER_FLOCK_SYSTEM_STATUS:
+    // Accessible, running, with a receiver
+    for (int bird = 0; bird < em->stations; bird++)
+      buf[bird] = 0x80 | 0x40 | 0x20;
+    len = NORMAL_ADDRESSING_BIRDS;
+    break;
+  case FLOCK_PARAMETER_BIRD_SYSTEM_STATUS:
+    buf[0] = state->stream ? 0x20 : 0x00;
+    buf[1] = 0x80 | (state->group ? 0x02 : 0x00);
+    len = 2;
+    break;
+  case FLOCK_PARAMETER_ERROR_CODE:
+    if (em->faults.error > 0. && emulator_random (em) < em->faults.error) {
+      buf[0] = em->faults.error_code ? em->faults.error_code : 1;
+      em->error_codes++;
+    }
+    len = 1;
+    break;
+  case FLOCK_PARAMETER_EXPANDED_ERROR_CODE:
+  case FLOCK_PARAMETER_SOFTWARE_REVISION_NUMBER:
+  case FLOCK_PARAMETER_BIRD_COMPUTER_CRYSTAL_SPEED:
+  case FLOCK_PARAMETER_POSITION_SCALING:
+  case FLOCK_PARAMETER_FILTER_ON_OFF_STATUS:
+    if (parameter == FLOCK_PARAMETER_SOFTWARE_REVISION_NUMBER) {
+      buf[0] = 67;
+      buf[1] = 3;
+    }
+    len = 2;
+    break;
+  case FLOCK_PARAMETER_BIRD_MEASUREMENT_RATE: {
+    unsigned short rate = (unsigned short) (em->rate * 256.);
+    buf[0] = rate & 0xff;
+    buf[1] = rate >> 8;
+    len = 2;
+    break;
+  }
+  case FLOCK_PARAMETER_SYSTEM_MODEL_IDENTIFICATION:
+    memcpy (buf, "6DFOB     ", 10);
+    len = 10;
+    break;
+  default:
+    len = 1;
+    break;
+  }
+
+  emulator_reply (em, buf, len);
+}
+
+static void change_value (emulator_t em, struct flock_state_s* state,
+                          const unsigned char* command) {
+  switch (command[1]) {
+  case FLOCK_PARAMETER_BIRD_MEASUREMENT_RATE: {
+    // Rate * 256, least significant byte first
+    double rate = (command[2] | (command[3] << 8)) / 256.;
+    if (rate > 0.) em->rate = rate;
+    break;
+  }
+  case FLOCK_PARAMETER_GROUP_MODE:
+    state->group = command[2] != 0;
+    break;
+  case FLOCK_PARAMETER_FBB_AUTO_CONFIGURATION:
+    if (command[2] != em->stations)
+      fprintf (stderr, "Auto configuration for %d birds, %d emulated\n",
+               command[2], em->stations);
+    break;
+  }
+}
+
+static void execute (emulator_t em, struct flock_state_s* state) {
+  const unsigned char* command = state->command;
+  state->command_len = 0;
+  em->commands++;
+
+  if (em->verbose) {
+    printf ("%10.3f ms  bird %d:", emulator_elapsed (em), state->target);
+    for (size_t i = 0; i < state->command_size; i++)
+      printf (" %.2x", command[i]);
+    printf ("\n");
+  }
+
+  int target = state->target;
+  // A command is for the master unless RS232 TO FBB precedes it
+  state->target = 1;
+
+  switch (command[0]) {
+  case FLOCK_COMMAND_EXAMINE_VALUE:
+    examine_value (em, state, command[1]);
+    break;
+  case FLOCK_COMMAND_CHANGE_VALUE:
+    change_value (em, state, command);
+    break;
+  case FLOCK_COMMAND_ANGLES:
+  case FLOCK_COMMAND_MATRIX:
+  case FLOCK_COMMAND_QUATERNION:
+  case FLOCK_COMMAND_POSITION:
+  case FLOCK_COMMAND_POSITION_ANGLES:
+  case FLOCK_COMMAND_POSITION_MATRIX:
+  case FLOCK_COMMAND_POSITION_QUATERNION:
+    if (target >= 1 && target <= em->stations)
+      state->modes[target - 1] = command[0];
+    break;
+  case FLOCK_COMMAND_STREAM:
+    if (!state->stream) emulator_start_stream (em);
+    state->stream = 1;
+    break;
+  case FLOCK_COMMAND_POINT:
+    // In stream mode, POINT stops the stream
+    if (state->stream) {
+      state->stream = 0;
+    }
+    else {
+      state->target = target;
+      send_records (em, state);
+      state->target = 1;
+    }
+    break;
+  default:
+    if ((command[0] & 0xf0) == FLOCK_COMMAND_RS232_TO_FBB)
+      state->target = command[0] & 0x0f;
+    break;
+  }
+}
+
+int main (int argc, char** argv) {
+  struct emulator_s em;
+  memset (&em, 0, sizeof (em));
+  em.name = "Flock";
+
+  if (emulator_parse_options (&em, argc, argv, 2, 100.) == -1) return 1;
+  if (em.stations > NORMAL_ADDRESSING_BIRDS) {
+    fprintf (stderr, "At most %d birds in normal addressing mode\n",
+             NORMAL_ADDRESSING_BIRDS);
+    return 1;
+  }
+  if (emulator_open (&em) == -1) return 1;
+
+  struct flock_state_s state;
+  memset (&state, 0, sizeof (state));
+  state.target = 1;
+  for (int bird = 0; bird < EMULATOR_MAX_STATIONS; bird++)
+    state.modes[bird] = FLOCK_COMMAND_POSITION_ANGLES;
+
+  unsigned char buf[256];
+  int len;
+  while ((len = emulator_wait (&em, state.stream, buf, sizeof (buf))) != -1) {
+    if (len == 0) {
+      send_records (&em, &state);
+      continue;
+    }
+
+    for (int i = 0; i < len; i++) {
+      state.command[state.command_len++] = buf[i];
+      state.command_size = command_size (state.command, state.command_len);
+
+      if (state.command_size == 0) {
+        if (em.verbose)
+          printf ("  unknown command %.2x %.2x\n",
+                  state.command[0], state.command[1]);
+        state.command_len = 0;
+        continue;
+      }
+      if (state.command_len >= state.command_size)
+        execute (&em, &state);
+    }
+  }
+
+  emulator_print_stats (&em);
+  emulator_close (&em);
+  return 0;
+}
@@ -0,0 +1,179 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Emulates a Polhemus Liberty on its RS232 port, over a pty, to test
+// liberty_hl without the tracker:
+//
+//   liberty_emulator -l /tmp/liberty -s 2 -r 240 -e 0.01 -c 0x75
+//
+// and open /tmp/liberty with the "liberty" backend.  The driver probe
+// ("\r" until an answer) and the F, U, O, C and P commands are
+// understood; continuous mode sends binary records ("LY", station,
+// command, error indicator, reserved, size, then x, y, z, azimuth,
+// elevation, roll as little endian floats).  Faults: -d drops bytes,
+// -p corrupts the "LY" tag or the station number, -e sets the error
+// indicator to -c.
+//
+// Build: cc -std=gnu99 -O2 -o liberty_emulator liberty_emulator.c emulator.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "emulator.h"
+
+#define STATION_RECORD_SIZE 32
+
+struct liberty_state_s {
+  int binary;
+  int continuous;
+  char command[64];
+  size_t command_len;
+};
+
+static void put_float (unsigned char* buf, float value) {
+  union { float f; unsigned char c[4]; } u;
+  u.f = value;
+  // The Liberty is little endian
+  for (int i = 0; i < 4; i++) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    buf[i] = u.c[3 - i];
+#else
+    buf[i] = u.c[i];
+#endif
+  }
+}
+
+static void send_frame (emulator_t em, struct liberty_state_s* state) {
+  unsigned char buf[EMULATOR_MAX_STATIONS * STATION_RECORD_SIZE];
+  double t = emulator_elapsed (em) / 1000.;
+
+  for (int station = 0; station < em->stations; station++) {
+    unsigned char* record = buf + station * STATION_RECORD_SIZE;
+    float position[3], angles[3];
+    emulator_station_pose (station, t, position, angles);
+
+    record[0] = 'L';
+    record[1] = 'Y';
+    record[2] = station + 1;
+    record[3] = 'C';
+    record[4] = 0x00;
+    record[5] = 0x00;
+    record[6] = STATION_RECORD_SIZE - 8;
+    record[7] = 0;
+
+    // Centimeters (U1) and degrees
+    for (int i = 0; i < 3; i++) {
+      put_float (record + 8 + 4 * i, position[i] * 100.f);
+      put_float (record + 20 + 4 * i, angles[i]);
+    }
+
+    if (em->faults.error > 0. && emulator_random (em) < em->faults.error) {
+      record[4] = em->faults.error_code ? em->faults.error_code : 0x75;
+      em->error_codes++;
+    }
+  }
+
+  if (em->faults.phase > 0. && emulator_random (em) < em->faults.phase) {
+    unsigned char* record =
+      buf + (int) (emulator_random (em) * em->stations) * STATION_RECORD_SIZE;
+    if (emulator_random (em) < 0.5)
+      record[1] = 'X';
+    else
+      record[2] = em->stations + 1;
+    em->phase_errors++;
+  }
+
+  emulator_send (em, buf, em->stations * STATION_RECORD_SIZE);
+}
+
+static void execute (emulator_t em, struct liberty_state_s* state) {
+  char* command = state->command;
+  state->command[state->command_len] = 0;
+  state->command_len = 0;
+  em->commands++;
+
+  if (em->verbose)
+    printf ("%10.3f ms  \"%s\"\n", emulator_elapsed (em), command);
+
+  switch (toupper ((unsigned char) command[0])) {
+  case 0:
+    // The probe of the driver: anything will do
+    emulator_reply (em, "\r\n", 2);
+    break;
+  case 'F':
+    state->binary = command[1] == '1';
+    break;
+  case 'U':
+  case 'O':
+    break;
+  case 'C':
+    if (!state->continuous) emulator_start_stream (em);
+    state->continuous = 1;
+    break;
+  case 'P':
+    // Single record, and the end of the continuous mode
+    if (state->continuous)
+      state->continuous = 0;
+    else
+      send_frame (em, state);
+    break;
+  default:
+    if (em->verbose) printf ("  unknown command\n");
+    break;
+  }
+
+  if (!state->binary && state->continuous) {
+    fprintf (stderr, "ASCII output is not emulated\n");
+    state->continuous = 0;
+  }
+}
+
+int main (int argc, char** argv) {
+  struct emulator_s em;
+  memset (&em, 0, sizeof (em));
+  em.name = "Liberty";
+
+  if (emulator_parse_options (&em, argc, argv, 2, 240.) == -1) return 1;
+  if (emulator_open (&em) == -1) return 1;
+
+  struct liberty_state_s state;
+  memset (&state, 0, sizeof (state));
+
+  unsigned char buf[256];
+  int len;
+  while ((len = emulator_wait (&em, state.continuous, buf, sizeof (buf))) != -1) {
+    if (len == 0) {
+      send_frame (&em, &state);
+      continue;
+    }
+
+    for (int i = 0; i < len; i++) {
+      if (buf[i] == '\r') {
+        execute (&em, &state);
+      }
+      else if (buf[i] != '\n' && state.command_len < sizeof (state.command) - 1) {
+        state.command[state.command_len++] = buf[i];
+      }
+    }
+  }
+
+  emulator_print_stats (&em);
+  emulator_close (&em);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Opens a tracker backend, reads records and closes it, timing each
+// step.  With an emulator on the other side of the pty:
+//
+//   tracker_bench -n 10000 flock /tmp/flock
+//
+// gives the open and close latencies of the driver, the interval
+// between the records, and how often the parser had to resync when
+// faults are injected.
+//
+// Build: from the top directory, with the sources of fobd (see fobd.c)
+// except fobd.c itself, plus emulators/tracker_bench.c.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tracker_backend.h"
+#include "realtime.h"
+
+int main (int argc, char** argv) {
+  long records = 1000;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "n:h")) != -1) {
+    switch (opt) {
+    case 'n': records = atol (optarg); break;
+    default:
+      fprintf (stderr, "Usage: %s [-n records] backend [file]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    fprintf (stderr, "Usage: %s [-n records] backend [file]\n", argv[0]);
+    return 1;
+  }
+
+  tracker_t tracker = tracker_new (argv[optind]);
+  if (tracker == NULL) {
+    fprintf (stderr, "Unknown backend %s\n", argv[optind]);
+    return 1;
+  }
+  const char* file = optind + 1 < argc ? argv[optind + 1] : "";
+
+  uint64_t start = realtime_now ();
+  if (tracker_open (tracker, file)) {
+    fprintf (stderr, "%s\n", tracker_get_error_string (tracker));
+    tracker_free (tracker);
+    return 1;
+  }
+  uint64_t opened = realtime_now ();
+  printf ("Open: %.3f ms\n", (opened - start) / 1e6);
+
+  struct realtime_stats_s intervals;
+  realtime_stats_init (&intervals, "Record interval");
+
+  uint64_t previous = realtime_now ();
+  long read = 0;
+  long errors = 0;
+  while (read < records) {
+    if (tracker_read_next_record (tracker)) {
+      // Give up when the device stops answering at all
+      if (++errors > records) break;
+      continue;
+    }
+
+    uint64_t now = realtime_now ();
+    realtime_stats_add (&intervals, now - previous);
+    previous = now;
+    read++;
+  }
+  uint64_t done = realtime_now ();
+
+  printf ("%ld records in %.3f s (%.1f per second), %ld failed reads\n",
+          read, (done - opened) / 1e9, read * 1e9 / (done - opened), errors);
+  realtime_stats_print (stdout, &intervals);
+
+  struct tracker_stats_s stats;
+  tracker_get_stats (tracker, &stats);
+  printf ("Parser: %lu records, %lu errors, %lu resyncs, %lu dropped\n",
+          stats.records, stats.errors, stats.resyncs, stats.dropped);
+
+  start = realtime_now ();
+  tracker_close (tracker);
+  printf ("Close: %.3f ms\n", (realtime_now () - start) / 1e6);
+
+  tracker_free (tracker);
+  return 0;
+}
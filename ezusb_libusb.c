@@ -0,0 +1,876 @@
+/*
+ * Copyright (c) 2001 Stephen Williams (steve@icarus.com)
+ * Copyright (c) 2001-2002 David Brownell (dbrownell@users.sourceforge.net)
+ * Copyright (c) 2008 Roger Williams (rawqux@users.sourceforge.net)
+ * Copyright (c) 2009 Jon Nall (jon.nall@gmail.com)
+ * Copyright (c) 2009 Anthony Beurive (anthony.beurive@free.fr)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/*
+ * ezusb.h on libusb-1.0, for the systems without IOKit (Linux): the
+ * same loader as ezusb.m, whose control requests go through libusb as
+ * in fxload.  The device is opened in a libusb context of its own, so
+ * that the default context of PiTracker is left alone.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libusb/libusb.h>
+
+#include "ezusb.h"
+
+struct ezusb_s {
+  libusb_context* context;
+  libusb_device_handle* dev;
+};
+
+/*
+ * These are the requests (bRequest) that the bootstrap loader is expected
+ * to recognize.  The codes are reserved by Cypress, and these values match
+ * what EZ-USB hardware, or "Vend_Ax" firmware (2nd stage loader) uses.
+ * Cypress' "a3load" is nice because it supports both FX and FX2, although
+ * it doesn't have the EEPROM support (subset of "Vend_Ax").
+ */
+#define RW_INTERNAL 0xA0        /* hardware implements this one */
+#define RW_EEPROM   0xA2
+#define RW_MEMORY   0xA3
+#define GET_EEPROM_SIZE 0xA5
+
+#define TIMEOUT_MS 1000
+
+/*
+ * For writing to RAM using a first (hardware) or second (software)
+ * stage loader and 0xA0 or 0xA3 vendor requests
+ */
+typedef enum
+{
+    _undef = 0,
+    internal_only,      /* hardware first-stage loader */
+    skip_internal,      /* first phase, second-stage loader */
+    skip_external       /* second phase, second-stage loader */
+} ram_mode;
+
+struct ram_poke_context
+{
+    libusb_device_handle* dev;
+    ram_mode mode;
+    uint32_t total;
+    uint32_t count;
+};
+
+/*
+ * For writing to EEPROM using a 2nd stage loader
+ */
+struct eeprom_poke_context
+{
+    libusb_device_handle* dev;
+    uint16_t ee_addr;    /* next free address */
+    int last;
+};
+
+#define RETRY_LIMIT 5
+
+static int verbose = 0;
+
+static int ram_poke (void* context, const uint16_t addr, const int external,
+    const uint8_t* data, const size_t len);
+
+static int eeprom_poke (void* context, const uint16_t addr, const int external,
+    const uint8_t* data, const size_t len);
+
+static int parse_ihex (FILE* image, void* context,
+                int (*is_external)(const uint16_t addr, const size_t len),
+                int (*poke) (void* context, const uint16_t addr, int external,
+                    const uint8_t* data, const size_t len));
+
+
+static int fx_is_external (const uint16_t addr, const size_t len)
+{
+    /* with 8KB RAM, 0x0000-0x1b3f can be written
+     * we can't tell if it's a 4KB device here
+     */
+    if (addr <= 0x1b3f)
+    {
+        return ((addr + len) > 0x1b40);
+    }
+
+    /* there may be more RAM; unclear if we can write it.
+     * some bulk buffers may be unused, 0x1b3f-0x1f3f
+     * firmware can set ISODISAB for 2KB at 0x2000-0x27ff
+     */
+    return 1;
+}
+
+/*
+ * return true iff [addr,addr+len) includes external RAM
+ * for Cypress EZ-USB FX2
+ */
+static int fx2_is_external (const uint16_t addr, const size_t len)
+{
+    /* 1st 8KB for data/code, 0x0000-0x1fff */
+    if (addr <= 0x1fff)
+    {
+        return ((addr + len) > 0x2000);
+    }
+
+    /* and 512 for data, 0xe000-0xe1ff */
+    else if (addr >= 0xe000 && addr <= 0xe1ff)
+    {
+        return ((addr + len) > 0xe200);
+    }
+
+    /* otherwise, it's certainly external */
+    else
+    {
+        return 1;
+    }
+}
+
+/*
+ * return true iff [addr,addr+len) includes external RAM
+ * for Cypress EZ-USB FX2LP
+ */
+static int fx2lp_is_external (const uint16_t addr, const size_t len)
+{
+    /* 1st 16KB for data/code, 0x0000-0x3fff */
+    if (addr <= 0x3fff)
+    {
+        return ((addr + len) > 0x4000);
+    }
+
+    /* and 512 for data, 0xe000-0xe1ff */
+    else if (addr >= 0xe000 && addr <= 0xe1ff)
+    {
+        return ((addr + len) > 0xe200);
+    }
+
+    /* otherwise, it's certainly external */
+    else
+    {
+        return 1;
+    }
+}
+
+/*
+ * Issues the specified vendor-specific request.  Returns the number of
+ * bytes transferred, or -1 with errno set.
+ */
+static int ctrl_msg (libusb_device_handle* dev, const uint8_t requestType,
+    const uint8_t request, const uint16_t value, const uint16_t index,
+    uint8_t* data, const size_t length)
+{
+    if (length > 0xffff)
+    {
+        fprintf (stderr, "length (%zd) too big (max = %d)\n", length, 0xffff);
+        errno = EINVAL;
+        return -1;
+    }
+
+    int rc = libusb_control_transfer (dev, requestType, request, value, index,
+        data, (uint16_t) length, TIMEOUT_MS);
+
+    if (rc < 0)
+    {
+        errno = rc == LIBUSB_ERROR_TIMEOUT ? ETIMEDOUT : EIO;
+        return -1;
+    }
+
+    return rc;
+}
+
+/*
+ * Issues the specified vendor-specific read request.
+ */
+static int ezusb_read (libusb_device_handle* dev, const char* label,
+    const uint8_t opcode, const uint16_t addr, uint8_t* data,
+    const size_t len)
+{
+    if (verbose)
+    {
+        fprintf (stderr, "%s, addr 0x%04x len %4zd (0x%04zx)\n",
+            label, addr, len, len);
+    }
+
+    const int status = ctrl_msg (dev,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        opcode, addr, 0, data, len);
+    if (status != (int) len)
+    {
+        fprintf (stderr, "%s: %d\n", label, status);
+    }
+
+    return status;
+}
+
+/*
+ * Issues the specified vendor-specific write request.
+ */
+static int ezusb_write (libusb_device_handle* dev, const char* label,
+    const uint8_t opcode, const uint16_t addr, const uint8_t* data,
+    const size_t len)
+{
+    if (verbose)
+    {
+        fprintf (stderr, "%s, addr 0x%04x len %4zd (0x%04zx)\n",
+            label, addr, len, len);
+    }
+
+    const int status = ctrl_msg (dev,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        opcode, addr, 0, (uint8_t*) data, len);
+    if (status != (int) len)
+    {
+        fprintf (stderr, "%s: %d\n", label, status);
+    }
+
+    return status;
+}
+
+/*
+ * Modifies the CPUCS register to stop or reset the CPU.
+ * Returns false on error.
+ */
+static int ezusb_cpucs (libusb_device_handle* dev, const uint16_t addr,
+    const int doRun)
+{
+    uint8_t data = doRun ? 0 : 1;
+
+    if (verbose)
+    {
+        fprintf (stderr, "%s\n", data ? "stop CPU" : "reset CPU");
+    }
+
+    const int status = ctrl_msg (dev,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+        RW_INTERNAL, addr, 0, &data, 1);
+    if (status != 1)
+    {
+        fprintf (stderr, "Can't modify CPUCS\n");
+        return 0;
+    }
+
+    // Successful
+    return 1;
+}
+
+/*
+ * Returns the size of the EEPROM (assuming one is present).
+ * *data == 0 means it uses 8 bit addresses (or there is no EEPROM),
+ * *data == 1 means it uses 16 bit addresses
+ */
+static int ezusb_get_eeprom_type (libusb_device_handle* dev, uint8_t* data)
+{
+    return ezusb_read (dev, "get EEPROM size", GET_EEPROM_SIZE, 0, data, 1);
+}
+
+/*
+ * Load an Intel HEX file into target RAM, in one or two phases (see
+ * ezusb_load_ram_ in ezusb.m).
+ */
+static int ezusb_load_ram_ (libusb_device_handle* dev, const char* hexfilePath,
+    const part_type partType, const int stage)
+{
+    FILE* image;
+    uint16_t cpucs_addr;
+    int (*is_external)(const uint16_t off, const size_t len);
+    struct ram_poke_context ctx;
+    int status;
+
+    image = fopen (hexfilePath, "r");
+    if (image == 0)
+    {
+        fprintf (stderr, "%s: unable to open for input.\n", hexfilePath);
+        return -2;
+    }
+    else if (verbose)
+    {
+        fprintf (stderr, "open RAM hexfile image %s\n", hexfilePath);
+    }
+
+    /* EZ-USB original/FX and FX2 devices differ, apart from the 8051 core */
+    if (partType == ptFX2LP)
+    {
+        cpucs_addr = 0xe600;
+        is_external = fx2lp_is_external;
+    }
+    else if (partType == ptFX2)
+    {
+        cpucs_addr = 0xe600;
+        is_external = fx2_is_external;
+    }
+    else
+    {
+        cpucs_addr = 0x7f92;
+        is_external = fx_is_external;
+    }
+
+    /* use only first stage loader? */
+    if (!stage)
+    {
+        ctx.mode = internal_only;
+
+        /* don't let CPU run while we overwrite its code/data */
+        if (!ezusb_cpucs (dev, cpucs_addr, 0))
+        {
+            fclose (image);
+            return -1;
+        }
+
+        /* 2nd stage, first part? loader was already downloaded */
+    }
+    else
+    {
+        ctx.mode = skip_internal;
+
+        /* let CPU run; overwrite the 2nd stage loader later */
+        if (verbose)
+        {
+            fprintf (stderr, "2nd stage:  write external memory\n");
+        }
+    }
+
+    /* scan the image, first (maybe only) time */
+    ctx.dev = dev;
+    ctx.total = ctx.count = 0;
+    status = parse_ihex (image, &ctx, is_external, ram_poke);
+    if (status < 0)
+    {
+        fprintf (stderr, "unable to download %s\n", hexfilePath);
+        fclose (image);
+        return status;
+    }
+
+    /* second part of 2nd stage: rescan */
+    if (stage)
+    {
+        ctx.mode = skip_external;
+
+        /* don't let CPU run while we overwrite the 1st stage loader */
+        if (!ezusb_cpucs (dev, cpucs_addr, 0))
+        {
+            fclose (image);
+            return -1;
+        }
+
+        /* at least write the interrupt vectors (at 0x0000) for reset! */
+        rewind (image);
+        if (verbose)
+        {
+            fprintf (stderr, "2nd stage:  write on-chip memory\n");
+        }
+
+        status = parse_ihex (image, &ctx, is_external, ram_poke);
+        if (status < 0)
+        {
+            fprintf (stderr, "unable to completely download %s\n", hexfilePath);
+            fclose (image);
+            return status;
+        }
+    }
+
+    fclose (image);
+
+    if (verbose && ctx.count)
+    {
+        fprintf (stderr, "... WROTE: %u bytes, %u segments, avg %u\n",
+            ctx.total, ctx.count, ctx.total / ctx.count);
+    }
+
+    /* now reset the CPU so it runs what we just downloaded */
+    if (!ezusb_cpucs (dev, cpucs_addr, 1))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Load an Intel HEX file into target (large) EEPROM, set up to boot from
+ * that EEPROM using the specified microcontroller-specific config byte.
+ * (Defaults:  FX2 0x08, FX 0x00, AN21xx n/a)
+ *
+ * Caller must have pre-loaded a second stage loader that knows how
+ * to handle the EEPROM write requests.
+ */
+static int ezusb_load_eeprom_ (libusb_device_handle* dev, const char* hexfilePath,
+    const part_type partType, uint8_t config)
+{
+    FILE* image;
+    uint16_t cpucs_addr;
+    int (*is_external)(const uint16_t off, const size_t len);
+    struct eeprom_poke_context ctx;
+    int status;
+    uint8_t value, first_byte;
+
+    if (ezusb_get_eeprom_type (dev, &value) != 1 || value != 1)
+    {
+        fprintf (stderr, "don't see a large enough EEPROM\n");
+        return -1;
+    }
+
+    /* EZ-USB family devices differ, apart from the 8051 core */
+    if (partType == ptFX2 || partType == ptFX2LP)
+    {
+        first_byte = 0xC2;
+        cpucs_addr = 0xe600;
+        is_external = partType == ptFX2 ? fx2_is_external : fx2lp_is_external;
+        ctx.ee_addr = 8;
+        config &= 0x4f;
+        fprintf (stderr,
+            "%s:  config = 0x%02x, %sconnected, I2C = %d KHz\n",
+            partType == ptFX2 ? "FX2" : "FX2LP",
+            config,
+            (config & 0x40) ? "dis" : "",
+            (config & 0x01) ? 400 : 100
+            );
+    }
+    else if (partType == ptFX)
+    {
+        first_byte = 0xB6;
+        cpucs_addr = 0x7f92;
+        is_external = fx_is_external;
+        ctx.ee_addr = 9;
+        config &= 0x07;
+        fprintf (stderr,
+            "FX:  config = 0x%02x, %d MHz%s, I2C = %d KHz\n",
+            config,
+            ((config & 0x04) ? 48 : 24),
+            (config & 0x02) ? " inverted" : "",
+            (config & 0x01) ? 400 : 100
+            );
+    }
+    else if (partType == ptAN21)
+    {
+        first_byte = 0xB2;
+        cpucs_addr = 0x7f92;
+        is_external = fx_is_external;
+        ctx.ee_addr = 7;
+        config = 0;
+        fprintf (stderr, "AN21xx:  no EEPROM config byte\n");
+    }
+    else
+    {
+        fprintf (stderr, "?? Unrecognized microcontroller type %d ??\n", partType);
+        return -1;
+    }
+
+    image = fopen (hexfilePath, "r");
+    if (image == 0)
+    {
+        fprintf (stderr, "%s: unable to open for input.\n", hexfilePath);
+        return -2;
+    }
+    else if (verbose)
+    {
+        fprintf (stderr, "open EEPROM hexfile image %s\n", hexfilePath);
+        fprintf (stderr, "2nd stage:  write boot EEPROM\n");
+    }
+
+    /* make sure the EEPROM won't be used for booting,
+     * in case of problems writing it
+     */
+    value = 0x00;
+    status = ezusb_write (dev, "mark EEPROM as unbootable",
+        RW_EEPROM, 0, &value, sizeof value);
+    if (status < 0)
+    {
+        fclose (image);
+        return status;
+    }
+
+    /* scan the image, write to EEPROM */
+    ctx.dev = dev;
+    ctx.last = 0;
+    status = parse_ihex (image, &ctx, is_external, eeprom_poke);
+    fclose (image);
+    if (status < 0)
+    {
+        fprintf (stderr, "unable to write EEPROM %s\n", hexfilePath);
+        return status;
+    }
+
+    /* append a reset command */
+    value = 0;
+    ctx.last = 1;
+    status = eeprom_poke (&ctx, cpucs_addr, 0, &value, sizeof value);
+    if (status < 0)
+    {
+        fprintf (stderr, "unable to append reset to EEPROM %s\n", hexfilePath);
+        return status;
+    }
+
+    /* write the config byte for FX, FX2 */
+    if (partType != ptAN21)
+    {
+        value = config;
+        status = ezusb_write (dev, "write config byte",
+            RW_EEPROM, 7, &value, sizeof value);
+        if (status < 0)
+        {
+            return status;
+        }
+    }
+
+    /* EZ-USB FX has a reserved byte */
+    if (partType == ptFX)
+    {
+        value = 0;
+        status = ezusb_write (dev, "write reserved byte",
+            RW_EEPROM, 8, &value, sizeof value);
+        if (status < 0)
+        {
+            return status;
+        }
+    }
+
+    /* make the EEPROM say to boot from this EEPROM */
+    status = ezusb_write (dev, "write EEPROM type byte",
+        RW_EEPROM, 0, &first_byte, sizeof first_byte);
+    if (status < 0)
+    {
+        return status;
+    }
+
+    /* Note:  VID/PID/version aren't written.  They should be
+     * written if the EEPROM type is modified (to B4 or C0).
+     */
+
+    return 0;
+}
+
+/*
+ * Parse an Intel HEX image file and invoke the poke() function on the
+ * various segments (see parse_ihex in ezusb.m).
+ */
+static int parse_ihex (FILE* image,
+                void* context,
+                int (*is_external)(const uint16_t addr, const size_t len),
+                int (*poke) (void* context, const uint16_t addr, int external,
+                    const uint8_t* data, const size_t len))
+{
+    uint8_t data [1023];
+    uint16_t data_addr = 0;
+    size_t data_len = 0;
+    int first_line = 1;
+    int external = 0;
+    int rc;
+
+    /* Read the input file as an IHEX file, and report the memory segments
+     * as we go.  Lines are merged into segments of up to 1023 bytes, the
+     * largest an EEPROM segment can be.
+     */
+    for (;;)
+    {
+        char buf [512], *cp;
+        char tmp, type;
+        size_t len;
+        unsigned idx, off;
+
+        cp = fgets (buf, sizeof buf, image);
+        if (cp == 0)
+        {
+            fprintf (stderr, "EOF without EOF record!\n");
+            break;
+        }
+
+        /* EXTENSION: "# comment-till-end-of-line", for copyrights etc */
+        if (buf[0] == '#')
+            continue;
+
+        if (buf[0] != ':')
+        {
+            fprintf (stderr, "not an ihex record: %s", buf);
+            return -2;
+        }
+
+        /* ignore any newline */
+        cp = strchr (buf, '\n');
+        if (cp)
+            *cp = 0;
+
+        if (verbose >= 3)
+            fprintf (stderr, "** LINE: %s\n", buf);
+
+        /* Read the length field (up to 16 bytes) */
+        tmp = buf[3];
+        buf[3] = 0;
+        len = strtoul (buf + 1, 0, 16);
+        buf[3] = tmp;
+
+        /* Read the target offset (address up to 64KB) */
+        tmp = buf[7];
+        buf[7] = 0;
+        off = strtoul (buf + 3, 0, 16);
+        buf[7] = tmp;
+
+        /* Initialize data_addr */
+        if (first_line)
+        {
+            data_addr = off;
+            first_line = 0;
+        }
+
+        /* Read the record type */
+        tmp = buf[9];
+        buf[9] = 0;
+        type = strtoul (buf + 7, 0, 16);
+        buf[9] = tmp;
+
+        /* If this is an EOF record, then make it so. */
+        if (type == 1)
+        {
+            if (verbose >= 2)
+                fprintf (stderr, "EOF on hexfile\n");
+            break;
+        }
+
+        if (type != 0)
+        {
+            fprintf (stderr, "unsupported record type: %u\n", type);
+            return -3;
+        }
+
+        if ((len * 2) + 11 > strlen (buf))
+        {
+            fprintf (stderr, "record too short?\n");
+            return -4;
+        }
+
+        /* flush the saved data if it's not contiguous,
+         * or when we've buffered as much as we can.
+         */
+        if (data_len != 0
+            && (off != (data_addr + data_len)
+                || (data_len + len) > sizeof data))
+        {
+            if (is_external)
+                external = is_external (data_addr, data_len);
+            rc = poke (context, data_addr, external, data, data_len);
+            if (rc < 0)
+                return -1;
+            data_addr = off;
+            data_len = 0;
+        }
+
+        /* append to saved data, flush later */
+        for (idx = 0, cp = buf + 9; idx < len; idx += 1, cp += 2)
+        {
+            tmp = cp[2];
+            cp[2] = 0;
+            data [data_len + idx] = strtoul (cp, 0, 16);
+            cp[2] = tmp;
+        }
+        data_len += len;
+    }
+
+    /* flush any data remaining */
+    if (data_len != 0)
+    {
+        if (is_external)
+            external = is_external (data_addr, data_len);
+        rc = poke (context, data_addr, external, data, data_len);
+        if (rc < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int ram_poke (void* context, const uint16_t addr, const int external,
+    const uint8_t* data, const size_t len)
+{
+    struct ram_poke_context* ctx = context;
+    int rc = 0;
+    uint32_t retry = 0;
+
+    switch (ctx->mode)
+    {
+        case internal_only:     /* CPU should be stopped */
+            if (external)
+            {
+                fprintf (stderr, "can't write %zd bytes external memory at 0x%04x\n",
+                    len, addr);
+                return -EINVAL;
+            }
+            break;
+
+        case skip_internal:     /* CPU must be running */
+            if (!external)
+            {
+                if (verbose >= 2)
+                {
+                    fprintf (stderr, "SKIP on-chip RAM, %zd bytes at 0x%04x\n",
+                        len, addr);
+                }
+                return 0;
+            }
+            break;
+
+        case skip_external:     /* CPU should be stopped */
+            if (external)
+            {
+                if (verbose >= 2)
+                {
+                    fprintf (stderr, "SKIP external RAM, %zd bytes at 0x%04x\n",
+                        len, addr);
+                }
+                return 0;
+            }
+            break;
+
+        default:
+            fprintf (stderr, "bug\n");
+            return -EDOM;
+    }
+
+    ctx->total += len;
+    ++ctx->count;
+
+    /* Retry this till we get a real error. Control messages are not
+     * NAKed (just dropped) so time out means is a real problem.
+     */
+    while ((rc = ezusb_write (ctx->dev,
+            external ? "write external" : "write on-chip",
+            external ? RW_MEMORY : RW_INTERNAL,
+            addr, data, len)) < 0
+        && retry < RETRY_LIMIT)
+    {
+        if (errno != ETIMEDOUT)
+        {
+            break;
+        }
+
+        retry += 1;
+    }
+    return (rc < 0) ? -errno : 0;
+}
+
+static int eeprom_poke (void* context, const uint16_t addr, const int external,
+    const uint8_t* data, const size_t len)
+{
+    struct eeprom_poke_context* ctx = context;
+    int rc = 0;
+    uint8_t header [4];
+
+    if (external)
+    {
+        fprintf (stderr, "EEPROM can't init %zd bytes external memory at 0x%04x\n",
+            len, addr);
+        return -EINVAL;
+    }
+
+    if (len > 1023)
+    {
+        fprintf (stderr, "not fragmenting %zd bytes\n", len);
+        return -EDOM;
+    }
+
+    /* NOTE:  No retries here.  They don't seem to be needed;
+     * could be added if that changes.
+     */
+
+    /* write header */
+    header [0] = len >> 8;
+    header [1] = len;
+    header [2] = addr >> 8;
+    header [3] = addr;
+    if (ctx->last)
+    {
+        header [0] |= 0x80;
+    }
+
+    if ((rc = ezusb_write (ctx->dev, "write EEPROM segment header",
+         RW_EEPROM, ctx->ee_addr, header, 4)) < 0)
+    {
+        return rc;
+    }
+
+    /* write code/data */
+    if ((rc = ezusb_write (ctx->dev, "write EEPROM segment",
+         RW_EEPROM, ctx->ee_addr + 4, data, len)) < 0)
+    {
+        return rc;
+    }
+
+    /* next shouldn't overwrite it */
+    ctx->ee_addr += 4 + len;
+
+    return 0;
+}
+
+//----------------------------------------------------------------------
+
+int ezusb_new
+(ezusb_t* ezusb,
+ int vendor_id,
+ int product_id)
+{
+    *ezusb = NULL;
+
+    libusb_context* context = NULL;
+    if (libusb_init (&context) != 0)
+    {
+        return -1;
+    }
+
+    libusb_device_handle* dev =
+        libusb_open_device_with_vid_pid (context, vendor_id, product_id);
+    if (dev == NULL)
+    {
+        fprintf (stderr, "Couldn't find USB device with %x:%x\n",
+            vendor_id, product_id);
+        libusb_exit (context);
+        return -1;
+    }
+
+    ezusb_t ezusb_ = calloc (1, sizeof (*ezusb_));
+    ezusb_->context = context;
+    ezusb_->dev = dev;
+    *ezusb = ezusb_;
+    return 0;
+}
+
+void ezusb_free
+(ezusb_t ezusb) {
+  if (!ezusb) return;
+  if (ezusb->dev) libusb_close (ezusb->dev);
+  libusb_exit (ezusb->context);
+  free (ezusb);
+}
+
+int ezusb_load_ram
+(ezusb_t ezusb,
+ const char* hexfilePath,
+ const part_type partType,
+ const int stage) {
+
+  return ezusb_load_ram_ (ezusb->dev, hexfilePath, partType, stage);
+}
+
+int ezusb_load_eeprom
+(ezusb_t ezusb,
+ const char* hexfilePath,
+ const part_type partType,
+ uint8_t config) {
+
+  return ezusb_load_eeprom_ (ezusb->dev, hexfilePath, partType, config);
+}
@@ -0,0 +1,134 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdlib.h>
+
+#include "flock/flock.h"
+#include "flock/flock_hl.h"
+#include "tracker_backend.h"
+
+enum flock_backend_error_e {
+  FLOCK_BACKEND_ERROR_OPEN_DEVICE = 1
+};
+
+struct flock_backend_s {
+  flock_t flock;
+  unsigned long records;
+  unsigned long errors;
+};
+
+static void* flock_backend_make () {
+  return calloc (1, sizeof (struct flock_backend_s));
+}
+
+static void flock_backend_free (void* handle) {
+  free (handle);
+}
+
+static int flock_backend_open (void* handle, const char* file) {
+  struct flock_backend_s* b = handle;
+
+  b->flock = flock_hl_open
+    ((char*) file, NUMBER_OF_BIRDS,
+     flock_bird_record_mode_position_angles, 1, 1);
+
+  if (b->flock == NULL)
+    return FLOCK_BACKEND_ERROR_OPEN_DEVICE;
+
+  b->records = 0;
+  b->errors = 0;
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static void flock_backend_close (void* handle) {
+  struct flock_backend_s* b = handle;
+
+  if (b->flock) {
+    flock_hl_close (b->flock);
+    b->flock = NULL;
+  }
+}
+
+static int flock_backend_get_file_descriptor (void* handle) {
+  struct flock_backend_s* b = handle;
+  return !b->flock ? -1 : flock_get_file_descriptor (b->flock);
+}
+
+static int flock_backend_get_number_of_birds (void* handle) {
+  return NUMBER_OF_BIRDS;
+}
+
+static int flock_backend_read_next_record (void* handle) {
+  struct flock_backend_s* b = handle;
+
+  if (flock_next_record (b->flock, 1) == 0) {
+    b->errors++;
+    return TRACKER_ERROR_READ;
+  }
+
+  b->records++;
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static void flock_backend_fill_bird_record (void* handle, int bird, bird_record_t record) {
+  struct flock_backend_s* b = handle;
+  flock_bird_record_t rec = flock_get_record (b->flock, bird);
+  record->x = rec->values.pa.x;
+  record->y = rec->values.pa.y;
+  record->z = rec->values.pa.z;
+  record->za = rec->values.pa.za;
+  record->ya = rec->values.pa.ya;
+  record->xa = rec->values.pa.xa;
+}
+
+static void flock_backend_get_stats (void* handle, tracker_stats_t stats) {
+  struct flock_backend_s* b = handle;
+  stats->records = b->records;
+  stats->errors = b->errors;
+}
+
+static const char* flock_backend_error_to_string (int error) {
+  switch (error) {
+  case FLOCK_BACKEND_ERROR_OPEN_DEVICE:
+    return "Error: can't open device";
+  }
+
+  return "Error: unknown flock error";
+}
+
+static void flock_backend_set_tap (void* handle, tracker_tap_t tap, void* data) {
+  struct flock_backend_s* b = handle;
+  flock_set_tap (b->flock, tap, data);
+}
+
+struct tracker_backend_s flock_backend = {
+  "flock",
+  "Asc. Flock of Birds",
+  0,
+  flock_backend_make,
+  flock_backend_free,
+  flock_backend_open,
+  flock_backend_close,
+  flock_backend_get_file_descriptor,
+  flock_backend_get_number_of_birds,
+  flock_backend_read_next_record,
+  flock_backend_fill_bird_record,
+  flock_backend_get_stats,
+  flock_backend_error_to_string,
+  flock_backend_set_tap,
+  NULL
+};
@@ -0,0 +1,909 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Send.h"
+#include "motion_engine.h"
+#include "bump_detector.h"
+#include "fob_pipeline.h"
+
+
+// Structure of sensors' data
+typedef struct bird_data_s* bird_data_t;
+//structure defined in bird_record.h
+struct bird_data_s {
+  struct gameplay_s gameplay; 
+  struct iset_presence_s presence; // Instrument for enter/leave
+  // Normalized record, for display
+  struct bird_record_s out;
+};
+
+// Time over which the rate of the tracker is measured, in nanoseconds
+#define RATE_WINDOW 1000000000ULL
+// Uploads waiting for their result at once
+#define MAX_UPLOADS 8
+// Frames over which the wall clock time of the frames follows a later
+// capture
+#define CLOCK_OFFSET_FRAMES 4096
+
+// Sets uploaded over OSC, confirmed to their sender once in use
+struct upload_s {
+  unsigned long ticket; // See iset_watch_upload
+  int iset_number; // -1 for a list
+  int sockfd;
+  struct sockaddr_in sender;
+};
+
+struct fob_pipeline_s {
+  fob_params_t params;
+  int centimeters;
+  int sockfd;
+  struct sockaddr_in host_addr;
+  int send_coordinates;
+  send_frame_t output; // Messages of the frame being processed
+  motion_engine_t engine;
+  motion_block_t block; // One frame
+  bump_detector_t detector;
+  uint64_t time; // Of the last frame, in nanoseconds
+  // Rate measured over RATE_WINDOW
+  float rate;
+  uint64_t rate_start;
+  unsigned long rate_frames;
+  // Wall clock time of the frames less their time, 0 until known
+  int64_t clock_offset;
+  // Set chosen over OSC and not loaded yet, confirmed once it is, -1
+  // if none
+  int pending_iset;
+  // Uploads
+  iset_watch_t watch;
+  int uploads_enabled; // Rejected at once when 0
+  int receive_sockfd; // Of the last OSC message
+  iset_list_t list; // Of the OSC messages being dispatched
+  struct sockaddr_in sender;
+  struct upload_s uploads[MAX_UPLOADS];
+  int number_of_uploads;
+  // Set of the list every bird plays in, -1 for the current set
+  int isets_of_birds[MAX_NUMBER_OF_BIRDS];
+  // Birds whose set was chosen over OSC and not confirmed yet
+  char pending_birds[MAX_NUMBER_OF_BIRDS];
+  struct bird_data_s data_of_birds[MAX_NUMBER_OF_BIRDS];
+};
+
+
+// Float argument of an OSC message
+static float
+float_argument (const char* arguments) {
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  float f;
+  memcpy (&f, &value, sizeof (f));
+  return f;
+}// float_argument
+
+// Set the speed threshold
+static int
+set_speed_threshold (const char* arguments, void* callback_data) {
+  float* speed_threshold = callback_data;
+  *speed_threshold = float_argument (arguments);
+  return 0;
+}// set_speed_threshold
+
+// Set the acceleration threshold
+static int
+set_accel_threshold (const char* arguments, void* callback_data) {
+  float* accel_threshold = callback_data;
+  *accel_threshold = float_argument (arguments);
+  return 0;
+}// set_accel_threshold
+
+// Set the bump threshold
+static int
+set_bump_threshold (const char* arguments, void* callback_data) {
+  float* bump_threshold = callback_data;
+  *bump_threshold = float_argument (arguments);
+  return 0;
+}// set_bump_threshold
+
+// Set the bump delay
+static int
+set_bump_delay (const char* arguments, void* callback_data) {
+  int* bump_delay = callback_data;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  *bump_delay = *((int*) &value);
+  return 0;
+}// set_bump_delay
+
+// Set the anti-bounce delay
+static int
+set_anti_bounce_delay (const char* arguments, void* callback_data) {
+  int* anti_bounce_delay = callback_data;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  *anti_bounce_delay = *((int*) &value);
+  return 0;
+}// set_anti_bounce_delay
+
+// Set the time allowed between the move and the deceleration
+static int
+set_arm_timeout (const char* arguments, void* callback_data) {
+  int* arm_timeout = callback_data;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  *arm_timeout = *((int*) &value);
+  return 0;
+}// set_arm_timeout
+
+// Set the hysteresis of the enter/leave messages
+static int
+set_hysteresis_margin (const char* arguments, void* callback_data) {
+  float* margin = callback_data;
+  *margin = float_argument (arguments);
+  return 0;
+}// set_hysteresis_margin
+
+static int
+set_hysteresis_delay (const char* arguments, void* callback_data) {
+  int* delay = callback_data;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  *delay = *((int*) &value);
+  return 0;
+}// set_hysteresis_delay
+
+// Set the velocity and acceleration filter
+static int
+set_filter (const char* arguments, void* callback_data) {
+  int* filter = callback_data;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  if ((int) value < 0 || (int) value >= MOTION_NUMBER_OF_FILTERS)
+    return -1;
+  *filter = value;
+  return 0;
+}// set_filter
+
+// Set a parameter of the filter
+static int
+set_filter_parameter (const char* arguments, void* callback_data) {
+  float* parameter = callback_data;
+  *parameter = float_argument (arguments);
+  return 0;
+}// set_filter_parameter
+
+// Set the latency of the bundles
+static int
+set_latency (const char* arguments, void* callback_data) {
+  int* latency = callback_data;
+  int32_t value = ntohl (*(uint32_t*) arguments);
+  *latency = value < 0 ? -1 : value;
+  return 0;
+}// set_latency
+
+// Set the instrument set
+static int
+set_instrument_set (const char* arguments, void* callback_data) {
+  iset_list_t* list = callback_data;
+  if (*list == NULL)
+    return -1;
+  uint32_t value = ntohl (*(uint32_t*) arguments);
+  iset_list_set_current_iset_index (*list, value);
+    return 0;
+}// set_instrument_set
+
+// Set the instrument set of a sensor (numbered from 1)
+static int
+set_sensor_set (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  int32_t bird = ntohl (*(uint32_t*) arguments);
+  int32_t value = ntohl (*(uint32_t*) (arguments + 4));
+  iset_list_t list = pipeline->list;
+  if (bird < 1 || bird > MAX_NUMBER_OF_BIRDS || value < -1 ||
+      (value >= 0 && (list == NULL || list->number_of_sets == 0)))
+    return -1;
+  // As for /instrumentSet
+  if (value >= 0 && value >= list->number_of_sets)
+    value = list->number_of_sets - 1;
+  fob_pipeline_set_bird_iset (pipeline, bird - 1, value);
+  pipeline->pending_birds[bird - 1] = 1;
+  return 0;
+}// set_sensor_set
+
+// String argument of an OSC message, and the arguments after it
+static const char*
+string_argument (const char** arguments) {
+  const char* s = *arguments;
+  *arguments += (strlen (s) + 4) & ~3;
+  return s;
+}// string_argument
+
+// Reads the name, instrument, frame and vector of a direction, and
+// returns the arguments after them, or NULL if they are wrong
+static const char*
+direction_arguments (const char* arguments, bump_direction_t direction) {
+  memset (direction, 0, sizeof (*direction));
+  const char* name = string_argument (&arguments);
+  strncpy (direction->name, name, sizeof (direction->name) - 1);
+  direction->instrument = (int32_t) ntohl (*(uint32_t*) arguments);
+  direction->frame = (int32_t) ntohl (*(uint32_t*) (arguments + 4));
+  direction->x = float_argument (arguments + 8);
+  direction->y = float_argument (arguments + 12);
+  direction->z = float_argument (arguments + 16);
+  direction->opposite = -1;
+  if (name[0] == '\0' || direction->instrument < -1 ||
+      (direction->frame != BUMP_FRAME_WORLD &&
+       direction->frame != BUMP_FRAME_INSTRUMENT) ||
+      (direction->x == 0.f && direction->y == 0.f && direction->z == 0.f))
+    return NULL;
+  return arguments + 20;
+}// direction_arguments
+
+// Add or change a direction of the bump detection, with the
+// thresholds of the parameters
+static int
+set_direction (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  struct bump_direction_s direction;
+  if (direction_arguments (arguments, &direction) == NULL)
+    return -1;
+  return bump_detector_put_direction (pipeline->detector, &direction) < 0 ? -1 : 0;
+}// set_direction
+
+// Same with thresholds of its own
+static int
+set_direction_thresholds (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  struct bump_direction_s direction;
+  if ((arguments = direction_arguments (arguments, &direction)) == NULL)
+    return -1;
+  direction.own_thresholds = 1;
+  direction.speed_threshold = float_argument (arguments);
+  direction.accel_threshold = float_argument (arguments + 4);
+  direction.bump_threshold = float_argument (arguments + 8);
+  return bump_detector_put_direction (pipeline->detector, &direction) < 0 ? -1 : 0;
+}// set_direction_thresholds
+
+// Index of the direction of a name for an instrument, or else for all
+// of them, -1 if none
+static int
+find_direction (bump_detector_t detector, const char* name, int instrument) {
+  int found = -1;
+  int n = bump_detector_get_number_of_directions (detector);
+  for (int i = 0; i < n; i++) {
+    bump_direction_t d = bump_detector_get_direction (detector, i);
+    if (strncmp (d->name, name, sizeof (d->name) - 1) != 0)
+      continue;
+    if (d->instrument == instrument)
+      return i;
+    if (d->instrument == -1 && found == -1)
+      found = i;
+  }
+  return found;
+}// find_direction
+
+// Set the direction blocked after a stroke in another one, "" for none
+static int
+set_direction_opposite (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  const char* name = string_argument (&arguments);
+  int32_t instrument = ntohl (*(uint32_t*) arguments);
+  const char* opposite_name = arguments + 4;
+  int direction = find_direction (pipeline->detector, name, instrument);
+  if (direction == -1)
+    return -1;
+  int opposite = -1;
+  if (opposite_name[0] != '\0' &&
+      (opposite = find_direction (pipeline->detector, opposite_name,
+                                  instrument)) == -1)
+    return -1;
+  bump_detector_get_direction (pipeline->detector, direction)->opposite = opposite;
+  return 0;
+}// set_direction_opposite
+
+// Remove every direction
+static int
+clear_directions (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  bump_detector_clear_directions (pipeline->detector);
+  return 0;
+}// clear_directions
+
+// Back to the six default directions
+static int
+default_directions (const char* arguments, void* callback_data) {
+  fob_pipeline_t pipeline = callback_data;
+  bump_detector_clear_directions (pipeline->detector);
+  bump_detector_add_default_directions (pipeline->detector);
+  return 0;
+}// default_directions
+
+// Hand sets over to the watch, or reject them at once
+static int
+upload (fob_pipeline_t pipeline, int iset_number, const char* blob) {
+  uint32_t size = ntohl (*(uint32_t*) blob);
+  if (!pipeline->uploads_enabled ||
+      pipeline->number_of_uploads >= MAX_UPLOADS) {
+    send_upload (pipeline->receive_sockfd, &pipeline->sender, iset_number, -1);
+    return -1;
+  }
+
+  struct upload_s* u = &pipeline->uploads[pipeline->number_of_uploads++];
+  u->ticket = iset_watch_upload (pipeline->watch, iset_number,
+                                 blob + sizeof (size), size);
+  u->iset_number = iset_number;
+  u->sockfd = pipeline->receive_sockfd;
+  u->sender = pipeline->sender;
+  return 0;
+}// upload
+
+// Upload a set of the list
+static int
+upload_set (const char* arguments, void* callback_data) {
+  int32_t value = ntohl (*(uint32_t*) arguments);
+  if (value < 0)
+    return -1;
+  return upload (callback_data, value, arguments + 4);
+}// upload_set
+
+// Upload a list
+static int
+upload_set_list (const char* arguments, void* callback_data) {
+  return upload (callback_data, -1, arguments);
+}// upload_set_list
+
+
+void fob_params_init (fob_params_t params) {
+  params->speed_threshold = DEFAULT_SPEED_THRESHOLD;
+  params->accel_threshold = DEFAULT_ACCEL_THRESHOLD;
+  params->bump_threshold = DEFAULT_BUMP_THRESHOLD;
+  params->bump_delay = DEFAULT_BUMP_DELAY_MS;
+  params->anti_bounce_delay = DEFAULT_ANTI_BOUNCE_DELAY_MS;
+  params->arm_timeout = DEFAULT_ARM_TIMEOUT_MS;
+  params->hysteresis_margin = DEFAULT_HYSTERESIS_MARGIN;
+  params->hysteresis_delay = DEFAULT_HYSTERESIS_DELAY_MS;
+  params->latency = -1;
+  motion_filter_params_init (&params->filter);
+}
+
+void fob_params_register_methods (fob_params_t params,
+                                  OSC_space_t space,
+                                  iset_list_t* list) {
+  // Creation of an OSC method changing the speed threshold
+  OSC_space_register_method 
+	(space, OSC_method_make ("/speedThreshold",
+							 ",f",
+							 set_speed_threshold,
+                             &params->speed_threshold)
+	);//changing of the speed threshold
+	
+  // Creation of an OSC method changing the acceleration threshold
+  OSC_space_register_method 
+	(space, OSC_method_make ("/accelThreshold",
+							 ",f",
+							 set_accel_threshold,
+                             &params->accel_threshold)
+	);//changing of the acceleration threshold
+		
+  // Creation of an OSC method changing the bump threshold
+  OSC_space_register_method 
+	(space, OSC_method_make ("/bumpThreshold",
+							 ",f",
+							 set_bump_threshold,
+                             &params->bump_threshold)
+	);//changing of the bump threshold
+  
+   // Creation of an OSC method changing the bump delay
+  OSC_space_register_method 
+	(space, OSC_method_make ("/bumpDelay",
+							 ",i",
+							 set_bump_delay,
+                             &params->bump_delay)
+	);//changing of the bump delay
+	
+   // Creation of an OSC method changing the anti-bounce delay
+  OSC_space_register_method 
+	(space, OSC_method_make ("/antiBounceDelay",
+							 ",i",
+							 set_anti_bounce_delay,
+                             &params->anti_bounce_delay)
+	);//changing of the anti-bounce delay
+
+   // Creation of an OSC method changing the arm timeout
+  OSC_space_register_method 
+	(space, OSC_method_make ("/armTimeout",
+							 ",i",
+							 set_arm_timeout,
+                             &params->arm_timeout)
+	);//changing of the arm timeout
+
+   // Creation of the OSC methods changing the enter/leave hysteresis
+  OSC_space_register_method 
+	(space, OSC_method_make ("/hysteresisMargin",
+							 ",f",
+							 set_hysteresis_margin,
+                             &params->hysteresis_margin)
+	);
+  OSC_space_register_method 
+	(space, OSC_method_make ("/hysteresisDelay",
+							 ",i",
+							 set_hysteresis_delay,
+                             &params->hysteresis_delay)
+	);//changing of the hysteresis
+	
+  // Creation of the OSC methods changing the filter
+  OSC_space_register_method
+	(space, OSC_method_make ("/filter",
+							 ",i",
+							 set_filter,
+                             &params->filter.filter)
+	);//changing of the filter
+
+  {
+    struct {
+      char* name;
+      float* parameter;
+    } filter_parameters[] = {
+      { "/filterRate", &params->filter.rate },
+      { "/minCutoff", &params->filter.min_cutoff },
+      { "/beta", &params->filter.beta },
+      { "/derivativeCutoff", &params->filter.derivative_cutoff },
+      { "/processNoise", &params->filter.process_noise },
+      { "/measurementNoise", &params->filter.measurement_noise }
+    };
+    int i;
+
+    for (i = 0; i < sizeof (filter_parameters) / sizeof (filter_parameters[0]); i++)
+      OSC_space_register_method
+        (space, OSC_method_make (filter_parameters[i].name,
+                                 ",f",
+                                 set_filter_parameter,
+                                 filter_parameters[i].parameter));
+  }
+
+  // Creation of an OSC method changing the latency of the bundles
+  OSC_space_register_method
+	(space, OSC_method_make ("/latency",
+							 ",i",
+							 set_latency,
+                             &params->latency)
+	);//changing of the latency
+
+  // Creation of an OSC method changing the current instrument set
+  OSC_space_register_method 
+	(space, OSC_method_make ("/instrumentSet",
+							 ",i",
+							 set_instrument_set,
+                             list)
+	);//changing of the current instrument set
+}
+
+void fob_pipeline_register_uploads (fob_pipeline_t pipeline,
+                                    OSC_space_t space,
+                                    iset_watch_t watch) {
+  pipeline->watch = watch;
+  pipeline->uploads_enabled = 1;
+
+  // Creation of the OSC methods uploading sets
+  OSC_space_register_method
+    (space, OSC_method_make ("/uploadSet", ",ib", upload_set, pipeline));
+  OSC_space_register_method
+    (space, OSC_method_make ("/uploadSetList", ",b", upload_set_list, pipeline));
+}
+
+void fob_pipeline_enable_uploads (fob_pipeline_t pipeline, int enable) {
+  pipeline->uploads_enabled = enable;
+}
+
+void fob_pipeline_register_sensor_sets (fob_pipeline_t pipeline,
+                                        OSC_space_t space) {
+  // Creation of an OSC method changing the set of a sensor
+  OSC_space_register_method
+    (space, OSC_method_make ("/sensorSet", ",ii", set_sensor_set, pipeline));
+}
+
+void fob_pipeline_register_directions (fob_pipeline_t pipeline,
+                                       OSC_space_t space) {
+  // Creation of the OSC methods changing the directions of the bumps
+  OSC_space_register_method
+    (space, OSC_method_make ("/direction", ",siifff", set_direction, pipeline));
+  OSC_space_register_method
+    (space, OSC_method_make ("/direction", ",siiffffff",
+                             set_direction_thresholds, pipeline));
+  OSC_space_register_method
+    (space, OSC_method_make ("/directionOpposite", ",sis",
+                             set_direction_opposite, pipeline));
+  OSC_space_register_method
+    (space, OSC_method_make ("/clearDirections", ",", clear_directions, pipeline));
+  OSC_space_register_method
+    (space, OSC_method_make ("/defaultDirections", ",",
+                             default_directions, pipeline));
+}
+
+void fob_frame_fill (fob_frame_t frame, tracker_t tracker) {
+  int number_of_birds = tracker_get_number_of_birds (tracker);
+  if (number_of_birds > MAX_NUMBER_OF_BIRDS)
+    number_of_birds = MAX_NUMBER_OF_BIRDS;
+
+  frame->timestamp = tracker_get_record_time (tracker);
+  frame->number_of_birds = number_of_birds;
+  for (int bird = 0; bird < number_of_birds; bird++)
+    tracker_fill_bird_record (tracker, bird + 1, &frame->records[bird]);
+}
+
+fob_pipeline_t fob_pipeline_new (fob_params_t params) {
+  fob_pipeline_t pipeline = calloc (1, sizeof (*pipeline));
+  pipeline->params = params;
+  pipeline->sockfd = -1;
+  pipeline->output = send_frame_new (0);
+  pipeline->engine = motion_engine_new (MAX_NUMBER_OF_BIRDS);
+  pipeline->block = motion_block_new (1, MAX_NUMBER_OF_BIRDS);
+  pipeline->detector = bump_detector_new (MAX_NUMBER_OF_BIRDS);
+  for (int bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++)
+    pipeline->isets_of_birds[bird] = -1;
+  fob_pipeline_reset (pipeline, 0);
+  return pipeline;
+}
+
+void fob_pipeline_free (fob_pipeline_t pipeline) {
+  bump_detector_free (pipeline->detector);
+  motion_block_free (pipeline->block);
+  motion_engine_free (pipeline->engine);
+  send_frame_free (pipeline->output);
+  free (pipeline);
+}
+
+void fob_pipeline_reset (fob_pipeline_t pipeline, int flags) {
+  pipeline->centimeters = (flags & TRACKER_FLAG_CENTIMETERS) != 0;
+  motion_engine_reset (pipeline->engine, pipeline->centimeters);
+  bump_detector_reset (pipeline->detector);
+  pipeline->time = 0;
+  pipeline->rate = 0.f;
+  pipeline->rate_frames = 0;
+  pipeline->clock_offset = 0;
+  pipeline->pending_iset = -1;
+  pipeline->number_of_uploads = 0;
+  memset (pipeline->pending_birds, 0, sizeof (pipeline->pending_birds));
+
+  // Initialization of the "data" structure
+  bird_data_t data;
+  int bird;
+
+  for (bird = 0, data = pipeline->data_of_birds;
+       bird < MAX_NUMBER_OF_BIRDS;
+       bird++, data++) {
+    memset (data, 0, sizeof (*data));
+    iset_presence_init (&data->presence);
+  }
+}
+
+void fob_pipeline_set_output (fob_pipeline_t pipeline,
+                              int sockfd,
+                              const struct sockaddr_in* host_addr) {
+  pipeline->sockfd = sockfd;
+  if (host_addr) pipeline->host_addr = *host_addr;
+}
+
+void fob_pipeline_set_send_coordinates (fob_pipeline_t pipeline,
+                                        int send_coordinates) {
+  pipeline->send_coordinates = send_coordinates;
+}
+
+void fob_pipeline_set_bird_iset (fob_pipeline_t pipeline,
+                                 int bird,
+                                 int iset_number) {
+  if (bird < 0 || bird >= MAX_NUMBER_OF_BIRDS) return;
+  pipeline->isets_of_birds[bird] = iset_number < 0 ? -1 : iset_number;
+}
+
+int fob_pipeline_get_bird_iset (fob_pipeline_t pipeline, int bird) {
+  return pipeline->isets_of_birds[bird];
+}
+
+void fob_pipeline_set_bundle_size (fob_pipeline_t pipeline,
+                                   int bundle_size) {
+  send_frame_set_bundle_size (pipeline->output, bundle_size);
+}
+
+float fob_pipeline_get_rate (fob_pipeline_t pipeline) {
+  return pipeline->rate;
+}
+
+// Counts the frames over RATE_WINDOW.  Bursts of frames don't change
+// the count, only the time they arrive.
+static void update_rate (fob_pipeline_t pipeline, uint64_t timestamp) {
+  if (pipeline->rate_frames == 0 || timestamp < pipeline->rate_start) {
+    pipeline->rate_start = timestamp;
+    pipeline->rate_frames = 1;
+    return;
+  }
+
+  uint64_t elapsed = timestamp - pipeline->rate_start;
+  if (elapsed >= RATE_WINDOW) {
+    pipeline->rate = pipeline->rate_frames * 1e9 / elapsed;
+    pipeline->rate_start = timestamp;
+    pipeline->rate_frames = 0;
+  }
+  pipeline->rate_frames++;
+}
+
+// Time of a frame: its timestamp, or one period after the previous
+// frame when the tracker doesn't know it
+static uint64_t frame_time (fob_pipeline_t pipeline, uint64_t timestamp) {
+  uint64_t time;
+  if (timestamp == 0) {
+    float rate = pipeline->rate > 0.f ? pipeline->rate : FOB_NOMINAL_RATE;
+    time = pipeline->time + (uint64_t) (1e9 / rate);
+  }
+  else {
+    update_rate (pipeline, timestamp);
+    time = timestamp;
+  }
+
+  if (time < pipeline->time) time = pipeline->time;
+  return pipeline->time = time;
+}
+
+// Time tag of the bundles of the frame at 'time' (see frame_time).  The
+// smallest difference seen between the wall clock and the time of the
+// frames is taken as the one at the capture; it is slowly let go of,
+// to follow the drift of the clock of the tracker.
+static uint64_t frame_time_tag (fob_pipeline_t pipeline, uint64_t time) {
+  int64_t offset = OSC_time_tag_to_ns (OSC_time_tag_now ()) - time;
+  if (pipeline->clock_offset == 0 || offset < pipeline->clock_offset)
+    pipeline->clock_offset = offset;
+  else
+    pipeline->clock_offset +=
+      (offset - pipeline->clock_offset) / CLOCK_OFFSET_FRAMES;
+
+  if (pipeline->params->latency < 0)
+    return OSC_TIME_TAG_IMMEDIATELY;
+  return OSC_time_tag_from_ns
+    (time + pipeline->clock_offset + pipeline->params->latency * 1000000ULL);
+}
+
+void fob_pipeline_get_bird_record (fob_pipeline_t pipeline,
+                                   int bird,
+                                   bird_record_t record) {
+  *record = pipeline->data_of_birds[bird].out;
+}
+
+// Sends the current set back if the OSC messages changed it
+static void confirm_iset (fob_pipeline_t pipeline, int sockfd,
+                          iset_list_t list, int iset_number) {
+  if (list && list->current_iset_index != iset_number) {
+    // Send the iset_index in an OSC message if it has changed, when
+    // the set is loaded (see fob_pipeline_process)
+    pipeline->pending_iset = -1;
+    if (iset_list_is_pending (list))
+      pipeline->pending_iset = list->current_iset_index;
+    else
+      load_iset (sockfd, &pipeline->host_addr, list->current_iset_index);
+  }
+}
+
+int fob_pipeline_receive_OSC (fob_pipeline_t pipeline,
+                              OSC_space_t space,
+                              osc_input_t input,
+                              iset_list_t list) {
+  // Remember the current iset_index before "reading" the OSC messages
+  int iset_number = list ? list->current_iset_index : -1;
+  int sockfd = osc_input_get_socket (input);
+  pipeline->receive_sockfd = sockfd;
+  pipeline->list = list;
+  // Messages received from peers
+  int result = osc_input_parse (input, space, &pipeline->sender);
+  confirm_iset (pipeline, sockfd, list, iset_number);
+  return result;
+}
+
+int64_t fob_pipeline_dispatch_OSC (fob_pipeline_t pipeline,
+                                   OSC_space_t space,
+                                   iset_list_t list) {
+  int iset_number = list ? list->current_iset_index : -1;
+  pipeline->list = list;
+  if (OSC_space_dispatch (space) > 0)
+    confirm_iset (pipeline, pipeline->receive_sockfd, list, iset_number);
+
+  uint64_t next = OSC_space_next_time_tag (space);
+  if (next == 0)
+    return -1;
+  int64_t delay = OSC_time_tag_to_ns (next) -
+    OSC_time_tag_to_ns (OSC_time_tag_now ());
+  return delay > 0 ? delay : 0;
+}
+
+void fob_pipeline_process (fob_pipeline_t pipeline,
+                           fob_frame_t frame,
+                           iset_list_t iset_list) {
+  int oscEnabled = (pipeline->sockfd != -1);
+  int sockfd = pipeline->sockfd;
+  struct sockaddr_in* host_addr = &pipeline->host_addr;
+
+  bird_data_t data;
+  int bird;
+
+  // The messages of the frame are sent together at the end
+  if (oscEnabled)
+    send_frame_begin (pipeline->output);
+
+  // The set chosen over OSC is loaded
+  if (pipeline->pending_iset != -1 && !iset_list_is_pending (iset_list)) {
+    if (oscEnabled && iset_list &&
+        iset_list->current_iset_index == pipeline->pending_iset)
+      load_iset (sockfd, host_addr, pipeline->pending_iset);
+    pipeline->pending_iset = -1;
+  }
+
+  // Sets uploaded in use, or rejected
+  for (int i = 0; i < pipeline->number_of_uploads;) {
+    struct upload_s* u = &pipeline->uploads[i];
+    int status = iset_watch_get_upload (pipeline->watch, u->ticket);
+    if (status == 0) {
+      i++;
+      continue;
+    }
+    send_upload (u->sockfd, &u->sender, u->iset_number, status == 1 ? 0 : -1);
+    *u = pipeline->uploads[--pipeline->number_of_uploads];
+  }
+
+  // Sets of the birds chosen over OSC and loaded
+  for (bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++) {
+    int iset_number = pipeline->isets_of_birds[bird];
+    if (!pipeline->pending_birds[bird])
+      continue;
+    // Once the set is loaded, never for one the list doesn't have
+    if (iset_number == -1 ? iset_list_is_pending (iset_list) :
+        iset_list_get_iset (iset_list, iset_number) == NULL)
+      continue;
+    if (oscEnabled)
+      send_sensor_set (sockfd, host_addr, bird + 1, iset_number);
+    pipeline->pending_birds[bird] = 0;
+  }
+
+  // Motion features of all the birds at once
+  motion_block_t block = pipeline->block;
+  struct motion_filter_params_s filter = pipeline->params->filter;
+  if (filter.rate <= 0.f) filter.rate = pipeline->rate;
+  motion_engine_set_filter (pipeline->engine, &filter);
+  block->sensors = frame->number_of_birds;
+  block->time[0] = frame_time (pipeline, frame->timestamp);
+  if (oscEnabled)
+    send_frame_set_time_tag (pipeline->output,
+                             frame_time_tag (pipeline, block->time[0]));
+  for (bird = 0; bird < frame->number_of_birds; bird++)
+    motion_block_set_record (block, 0, bird, &frame->records[bird]);
+  motion_engine_process (pipeline->engine, block);
+
+  // Where every bird is, for the bump detection
+  struct bump_sensor_s sensors[MAX_NUMBER_OF_BIRDS];
+  struct iset_hit_s hits[MAX_NUMBER_OF_BIRDS];
+  struct iset_hysteresis_s hysteresis;
+  iset_t current = NULL;
+  if (iset_list)
+    current = iset_list_get_iset (iset_list, iset_list->current_iset_index);
+  hysteresis.margin = pipeline->params->hysteresis_margin;
+  hysteresis.delay = pipeline->params->hysteresis_delay * 1000000ULL;
+
+  for (bird = 0, data = pipeline->data_of_birds;
+       bird < frame->number_of_birds;
+       bird++, data++) {
+    // Computed for every bird by the motion engine above
+    float x = block->x[bird];
+    float y = block->y[bird];
+    float z = block->z[bird];
+
+    float za = block->za[bird];
+    float ya = block->ya[bird];
+    float xa = block->xa[bird];
+
+    float dx = block->dx[bird];
+    float dy = block->dy[bird];
+    float dz = block->dz[bird];
+
+    float accelx = block->ax[bird];
+    float accely = block->ay[bird];
+    float accelz = block->az[bird];
+
+    if (oscEnabled) {
+      // Get the instrument in which the stick is, in its own set if it
+      // has one
+      int prev_inst = data->presence.instrument;
+      iset_hit_t hit = &hits[bird];
+      iset_t iset = current;
+      if (pipeline->isets_of_birds[bird] != -1)
+        iset = iset_list_get_iset (iset_list, pipeline->isets_of_birds[bird]);
+      if (iset_update_presence (iset, &data->presence, &hysteresis,
+                                x, y, z, block->time[0], hit)) {
+        // Send a "leave" message whenever a stick leaves a volume
+        if (prev_inst != -1)
+          send_enter_leave (sockfd, "/leave", host_addr, bird + 1, prev_inst);
+
+        // Send an "enter" message whenever a stick enters a volume
+        if (hit->instrument != NULL)
+          send_enter_leave (sockfd, "/enter", host_addr, bird + 1,
+                            hit->instrument->index);
+      }
+      instrument_t instrument = hit->instrument;
+
+      if (instrument != NULL)
+        send_record (sockfd,
+                     host_addr,
+                     bird + 1,
+                     instrument->index,
+                     hit->delta_x,
+                     hit->delta_y,
+                     hit->delta_z,
+                     xa, ya, za,
+                     dx, dy, dz,
+                     accelx, accely, accelz);
+
+      // When the "Send coordinates" option is ticked, it enables to see
+      // the sticks in the SetKreator window
+      if (pipeline->send_coordinates)
+        send_record (sockfd,
+                     host_addr,
+                     bird + 1,
+                     -1,
+                     x, y, z,
+                     xa, ya, za,
+                     dx, dy, dz,
+                     accelx, accely, accelz);
+
+      // Where the stick is, for the bump detection after the loop
+      sensors[bird].instrument = instrument ? instrument->index : -1;
+      sensors[bird].fla = instrument ? instrument->fla : 0;
+      sensors[bird].rotation =
+        instrument ? &instrument->to_local[0][0] : NULL;
+    }// if (oscEnabled)
+
+    // Keep the normalized record for display
+    data->out.x = x;
+    data->out.y = y;
+    data->out.z = z;
+    data->out.za = za;
+    data->out.ya = ya;
+    data->out.xa = xa;
+  }// for (bird = 0, data = pipeline->data_of_birds; ...)
+
+  if (!oscEnabled) return;
+
+  // Bumps of all the birds at once
+  struct bump_params_s bump_params;
+  bump_params_init (&bump_params);
+  bump_params.speed_threshold = pipeline->params->speed_threshold;
+  bump_params.accel_threshold = pipeline->params->accel_threshold;
+  bump_params.bump_threshold = pipeline->params->bump_threshold;
+  bump_params.bump_delay = pipeline->params->bump_delay;
+  bump_params.anti_bounce_delay = pipeline->params->anti_bounce_delay;
+  bump_params.arm_timeout = pipeline->params->arm_timeout;
+  bump_detector_set_params (pipeline->detector, &bump_params);
+  bump_detector_process (pipeline->detector, block, 0, sensors);
+
+  struct bump_event_s event;
+  while (bump_detector_next_event (pipeline->detector, &event)) {
+    bird = event.sensor;
+    send_bump (sockfd,
+               host_addr,
+               bird + 1,
+               event.instrument,
+               hits[bird].delta_x,
+               hits[bird].delta_y,
+               hits[bird].delta_z,
+               block->xa[bird], block->ya[bird], block->za[bird],
+               event.intensity);
+  }
+
+  send_frame_end ();
+}// fob_pipeline_process
@@ -0,0 +1,196 @@
+#ifndef __fob_pipeline_h__
+#define __fob_pipeline_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// The processing done on every tracker record: normalization, speed
+// and acceleration, instrument lookup, enter/leave and bump
+// detection, and the OSC messages sent for them.  Shared by the GUI
+// (threadMain) and the fobd daemon.
+
+#include <netinet/in.h>
+
+#include "flockUtils/OSC.h"
+#include "Send.h"
+#include "bird_record.h"
+#include "iset.h"
+#include "iset_watch.h"
+#include "motion_engine.h"
+#include "tracker_backend.h"
+
+#define DEFAULT_SPEED_THRESHOLD 5e-2
+#define DEFAULT_ACCEL_THRESHOLD -5e-2
+#define DEFAULT_BUMP_THRESHOLD 5e-2
+#define DEFAULT_BUMP_DELAY_MS 300
+#define DEFAULT_ANTI_BOUNCE_DELAY_MS 100
+#define DEFAULT_ARM_TIMEOUT_MS 200
+#define DEFAULT_HYSTERESIS_MARGIN 5e-2
+#define DEFAULT_HYSTERESIS_DELAY_MS 0
+// Rate assumed until the one of the tracker is known
+#define FOB_NOMINAL_RATE 240
+
+// Parameters of the gesture detection, changed over OSC
+typedef struct fob_params_s* fob_params_t;
+struct fob_params_s {
+  float speed_threshold;
+  float accel_threshold;
+  float bump_threshold;
+  int bump_delay; // In milliseconds
+  int anti_bounce_delay; // In milliseconds
+  int arm_timeout; // In milliseconds
+  // Enter/leave hysteresis (see iset_hysteresis_s)
+  float hysteresis_margin;
+  int hysteresis_delay; // In milliseconds
+  // Velocity and acceleration filter
+  struct motion_filter_params_s filter;
+  // Time after the capture of a frame at which its bundles are to be
+  // played (see fob_pipeline_set_bundle_size), in milliseconds, -1
+  // for as soon as they arrive
+  int latency;
+};
+
+// Default values of the parameters
+extern void fob_params_init (fob_params_t params);
+// Registers /speedThreshold, /accelThreshold, /bumpThreshold,
+// /bumpDelay, /antiBounceDelay, /armTimeout (in milliseconds),
+// /hysteresisMargin, /hysteresisDelay (in milliseconds), the
+// filter parameters (/filter with a motion_filter_e, /filterRate, 0
+// for the detected rate, /minCutoff, /beta, /derivativeCutoff,
+// /processNoise, /measurementNoise), /latency (in milliseconds, -1
+// for none), and /instrumentSet which changes the current set of
+// *list.
+extern void fob_params_register_methods (fob_params_t params,
+                                         OSC_space_t space,
+                                         iset_list_t* list);
+
+// One record of every bird, as read from the tracker
+typedef struct fob_frame_s* fob_frame_t;
+struct fob_frame_s {
+  uint64_t timestamp; // See tracker_get_record_time
+  int number_of_birds;
+  struct bird_record_s records[MAX_NUMBER_OF_BIRDS];
+};
+
+// Reads the records of every bird and their time after
+// tracker_read_next_record
+extern void fob_frame_fill (fob_frame_t frame, tracker_t tracker);
+
+typedef struct fob_pipeline_s* fob_pipeline_t;
+
+extern fob_pipeline_t fob_pipeline_new (fob_params_t params);
+extern void fob_pipeline_free (fob_pipeline_t pipeline);
+
+// Forgets the previous records, the gesture states and the rate.
+// 'flags' are the tracker flags (see tracker_backend.h).
+extern void fob_pipeline_reset (fob_pipeline_t pipeline, int flags);
+
+// OSC output.  With sockfd == -1 nothing is sent, and neither the
+// instruments nor the bumps are looked for.
+extern void fob_pipeline_set_output (fob_pipeline_t pipeline,
+                                     int sockfd,
+                                     const struct sockaddr_in* host_addr);
+// The messages of a frame are sent at once at its end, in bundles of
+// up to 'bundle_size' bytes for every target, or as they are with 0
+// (the default).  See send_frame_new.  The time tag of the bundles is
+// the time the frame was captured, on the wall clock, plus the latency
+// of the parameters.
+extern void fob_pipeline_set_bundle_size (fob_pipeline_t pipeline,
+                                          int bundle_size);
+// Also send the absolute coordinates (for the set designer)
+extern void fob_pipeline_set_send_coordinates (fob_pipeline_t pipeline,
+                                               int send_coordinates);
+
+// Registers /uploadSet (",ib": a set of the current list and its
+// description, as in a set file) and /uploadSetList (",b": a list
+// replacing the current one, the descriptions of its sets one after
+// the other), handed over to the watch (see iset_watch_upload).  Once
+// the sets are in use, or rejected, /uploadSet (the set and 0 or -1)
+// or /uploadSetList (0 or -1) is sent back to the sender.
+extern void fob_pipeline_register_uploads (fob_pipeline_t pipeline,
+                                           OSC_space_t space,
+                                           iset_watch_t watch);
+// Uploads are only confirmed when the list of the watch is used
+// (iset_watch_get_list).  While it is not, they are rejected at once
+// with 'enable' 0.
+extern void fob_pipeline_enable_uploads (fob_pipeline_t pipeline, int enable);
+
+// Set of the list a bird (numbered from 0) plays in, whatever the
+// current set, so that several performers have their own
+// instruments.  -1, the default, for the current set.  Kept by
+// fob_pipeline_reset.
+extern void fob_pipeline_set_bird_iset (fob_pipeline_t pipeline,
+                                        int bird,
+                                        int iset_number);
+extern int fob_pipeline_get_bird_iset (fob_pipeline_t pipeline, int bird);
+// Registers /sensorSet (",ii": a sensor, numbered from 1, and its
+// set, -1 for the current one, clamped to the list as /instrumentSet),
+// sent back to the target once the set is loaded.
+extern void fob_pipeline_register_sensor_sets (fob_pipeline_t pipeline,
+                                               OSC_space_t space);
+// Registers the methods declaring the directions of the bumps (see
+// bump_direction_s), kept by fob_pipeline_reset:
+// /direction (",siifff": a name, the instrument, -1 for all of them,
+// a bump_frame_e and the vector, then optionally ",siiffffff" the
+// speed, acceleration and bump thresholds of the direction) adds the
+// direction or changes the one of that name and instrument;
+// /directionOpposite (",sis": a direction, its instrument, and the
+// direction blocked after its strokes, "" for none); /clearDirections
+// and /defaultDirections (",").  The instruments are the indexes of
+// the set the sensor is in.
+extern void fob_pipeline_register_directions (fob_pipeline_t pipeline,
+                                              OSC_space_t space);
+
+// Processes one frame against the set of every bird in the list.  The
+// delays of the gestures are measured with the timestamps of the
+// frames; frames without timestamp are taken one period apart.
+extern void fob_pipeline_process (fob_pipeline_t pipeline,
+                                  fob_frame_t frame,
+                                  iset_list_t list);
+
+// Normalized position and angles of a bird (numbered from 0) after
+// the last processed frame
+extern void fob_pipeline_get_bird_record (fob_pipeline_t pipeline,
+                                          int bird,
+                                          bird_record_t record);
+
+// Rate of the tracker measured on the timestamps of the frames, in
+// frames per second, 0 until known
+extern float fob_pipeline_get_rate (fob_pipeline_t pipeline);
+
+// Dispatches in space the OSC messages received by input (see
+// osc_input_parse), and returns their number.  If they changed the
+// current set of the list, the new index is sent back to the target,
+// once the set is loaded if it is not yet (see iset_list_is_pending).
+extern int fob_pipeline_receive_OSC (fob_pipeline_t pipeline,
+                                     OSC_space_t space,
+                                     osc_input_t input,
+                                     iset_list_t list);
+// Dispatches the bundles received for later whose time has come (see
+// OSC_space_dispatch), as fob_pipeline_receive_OSC.  Returns the time
+// until the next one in nanoseconds, -1 if none.
+extern int64_t fob_pipeline_dispatch_OSC (fob_pipeline_t pipeline,
+                                          OSC_space_t space,
+                                          iset_list_t list);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
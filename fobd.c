@@ -0,0 +1,722 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// fobd - FoB without the GUI, for the show computers.
+//
+// An acquisition thread reads the tracker and queues the frames, a
+// processing thread runs them through the same pipeline as the GUI
+// and talks OSC.  Both can be given a realtime policy and a CPU, so
+// that nothing else running on the machine delays the tracker loop.
+//
+//   fobd [-v] config-file
+//
+// See fobd.conf for the configuration keys.  SIGUSR1 prints the
+// latency statistics, SIGINT and SIGTERM stop the daemon.
+//
+/* Built with the other portable sources and libusb-1.0, ezusb_libusb.c
+   taking the place of ezusb.m, for instance from the top directory:
+
+     cc -std=gnu99 -O2 -c -I. -Ilibflock -Ilibflock/flockUtils
+       -Ilibusb-1.0.4 fobd.c fob_pipeline.c bump_detector.c iset.c
+       iset_watch.c realtime.c recording.c tracker_backend.c
+       flock_backend.c liberty_backend.c simulator_backend.c
+       replay_backend.c ezusb_libusb.c Send.c Smoothing.c
+       Standardization.c libflock/flock/flock.c
+       libflock/flock/flock_bird.c libflock/flock/flock_bird_record.c
+       libflock/flock/flock_command.c libflock/flock/flock_error.c
+       libflock/flock/flock_hl.c libflock/flock/flock_mode.c
+       libflock/flockUtils/OSC.c
+     c++ -O2 -c -I. -Ilibflock -Ipolhemus-tracker-terminal-1.0.0/src
+       -Ilibusb-1.0.4 motion_engine.cpp liberty_hl.cpp
+       polhemus-tracker-terminal-1.0.0/src/PiTracker.cpp
+     c++ -o fobd *.o -lusb-1.0 -lpthread -lm */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "Send.h"
+#include "liberty_hl.h"
+#include "tracker_backend.h"
+#include "iset.h"
+#include "iset_watch.h"
+#include "fob_pipeline.h"
+#include "realtime.h"
+
+// Frames between the acquisition and the processing threads
+#define QUEUE_SIZE 256
+
+typedef struct fobd_config_s* fobd_config_t;
+struct fobd_config_s {
+  // Same fields as the GUI
+  char device[256];
+  char file[1024];
+  int osc;
+  int osc_input_port;
+  char osc_target[256];
+  int osc_target_port;
+  int osc_bundle_size; // Of the bundles of a frame, 0 for none
+  int osc_latency; // Of the bundles, in milliseconds, -1 for none
+  char set_list[1024];
+  int watch_set_list; // Reload the sets when their files change
+  int send_coordinates;
+  // Set of every sensor, -1 for the current set
+  int sensor_sets[MAX_NUMBER_OF_BIRDS];
+  char firmware_path[1024];
+  char record[1024]; // Recording of the raw tracker bytes
+  int filter; // motion_filter_e, -1 for the default
+
+  // Scheduling
+  struct realtime_params_s acquisition;
+  struct realtime_params_s processing;
+  int lock_memory;
+  size_t prefault_stack;
+  int stats_interval; // Seconds, 0 to only report on SIGUSR1
+};
+
+struct fobd_slot_s {
+  uint64_t timestamp;
+  struct fob_frame_s frame;
+};
+
+// Single producer, single consumer queue of frames
+struct fobd_queue_s {
+  struct fobd_slot_s slots[QUEUE_SIZE];
+  volatile unsigned long head; // Written by the acquisition thread
+  volatile unsigned long tail; // Written by the processing thread
+  unsigned long dropped;
+  int wake[2]; // One byte per frame, to wake the processing thread
+};
+
+static struct fobd_config_s config;
+static struct fobd_queue_s queue;
+static tracker_t tracker = NULL;
+static int verbose = 0;
+
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t report = 0;
+// A thread didn't get the scheduling of the configuration
+static volatile sig_atomic_t scheduling_failed = 0;
+
+// Set by the processing thread once it can take the frames
+static pthread_mutex_t ready_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static int ready = 0;
+
+// Written by their thread only, read by the reports
+static struct realtime_stats_s interval_stats;
+static struct realtime_stats_s latency_stats;
+static struct realtime_stats_s processing_stats;
+static float tracker_rate; // Measured by the pipeline
+static struct osc_input_stats_s input_stats; // Of the OSC input
+
+static void handle_signal (int sig) {
+  if (sig == SIGUSR1)
+    report = 1;
+  else
+    running = 0;
+}
+
+//_____________CONFIGURATION_________________________________//
+
+static void fobd_config_init (fobd_config_t c) {
+  memset (c, 0, sizeof (*c));
+  strcpy (c->device, "flock");
+  strcpy (c->osc_target, "localhost");
+  c->osc = 1;
+  c->osc_input_port = 3001;
+  c->osc_target_port = 3000;
+  c->watch_set_list = 1;
+  realtime_params_init (&c->acquisition);
+  realtime_params_init (&c->processing);
+  c->prefault_stack = 64 * 1024;
+  c->filter = -1;
+  c->osc_latency = -1;
+  for (int bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++)
+    c->sensor_sets[bird] = -1;
+}
+
+static int parse_boolean (const char* value) {
+  return strcasecmp (value, "yes") == 0 ||
+    strcasecmp (value, "on") == 0 ||
+    strcasecmp (value, "true") == 0 ||
+    strcmp (value, "1") == 0;
+}
+
+static int parse_thread_key (realtime_params_t params,
+                             const char* key,
+                             const char* value) {
+  if (strcmp (key, "scheduler") == 0) {
+    int policy = realtime_policy_from_string (value);
+    if (policy == -1) return -1;
+    params->policy = policy;
+  }
+  else if (strcmp (key, "priority") == 0)
+    params->priority = atoi (value);
+  else if (strcmp (key, "cpu") == 0)
+    params->cpu = atoi (value);
+  // DEADLINE parameters are given in microseconds
+  else if (strcmp (key, "runtime") == 0)
+    params->runtime = strtoull (value, NULL, 10) * 1000;
+  else if (strcmp (key, "deadline") == 0)
+    params->deadline = strtoull (value, NULL, 10) * 1000;
+  else if (strcmp (key, "period") == 0)
+    params->period = strtoull (value, NULL, 10) * 1000;
+  else
+    return -1;
+  return 0;
+}
+
+static void copy_value (char* dest, size_t size, const char* value) {
+  strncpy (dest, value, size - 1);
+  dest[size - 1] = '\0';
+}
+
+// Sets of the sensors, from the first one, separated by spaces
+static int parse_sensor_sets (fobd_config_t c, const char* value) {
+  char* end;
+  for (int bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++) {
+    long n = strtol (value, &end, 10);
+    if (end == value) return *value == '\0' ? 0 : -1;
+    if (n < -1) return -1;
+    c->sensor_sets[bird] = n;
+    value = end;
+  }
+  return *value == '\0' ? 0 : -1;
+}
+
+static int parse_key (fobd_config_t c, const char* key, const char* value) {
+#define STRING_KEY(name) \
+  if (strcmp (key, #name) == 0) { \
+    copy_value (c->name, sizeof (c->name), value); \
+    return 0; \
+  }
+
+  STRING_KEY (device);
+  STRING_KEY (file);
+  STRING_KEY (osc_target);
+  STRING_KEY (set_list);
+  STRING_KEY (firmware_path);
+  STRING_KEY (record);
+#undef STRING_KEY
+
+  if (strcmp (key, "osc") == 0)
+    c->osc = parse_boolean (value);
+  else if (strcmp (key, "osc_input_port") == 0)
+    c->osc_input_port = atoi (value);
+  else if (strcmp (key, "osc_target_port") == 0)
+    c->osc_target_port = atoi (value);
+  else if (strcmp (key, "osc_bundle_size") == 0)
+    c->osc_bundle_size = atoi (value);
+  else if (strcmp (key, "osc_latency") == 0)
+    c->osc_latency = atoi (value);
+  else if (strcmp (key, "watch_set_list") == 0)
+    c->watch_set_list = parse_boolean (value);
+  else if (strcmp (key, "send_coordinates") == 0)
+    c->send_coordinates = parse_boolean (value);
+  else if (strcmp (key, "sensor_sets") == 0)
+    return parse_sensor_sets (c, value);
+  else if (strcmp (key, "lock_memory") == 0)
+    c->lock_memory = parse_boolean (value);
+  else if (strcmp (key, "prefault_stack") == 0)
+    c->prefault_stack = strtoul (value, NULL, 10) * 1024;
+  else if (strcmp (key, "stats_interval") == 0)
+    c->stats_interval = atoi (value);
+  else if (strcmp (key, "filter") == 0)
+    return (c->filter = motion_filter_from_string (value)) == -1 ? -1 : 0;
+  else if (strncmp (key, "acquisition_", 12) == 0)
+    return parse_thread_key (&c->acquisition, key + 12, value);
+  else if (strncmp (key, "processing_", 11) == 0)
+    return parse_thread_key (&c->processing, key + 11, value);
+  else
+    return -1;
+
+  return 0;
+}
+
+static char* trim (char* s) {
+  while (*s == ' ' || *s == '\t') s++;
+  char* end = s + strlen (s);
+  while (end > s &&
+         (end[-1] == ' ' || end[-1] == '\t' ||
+          end[-1] == '\n' || end[-1] == '\r'))
+    end--;
+  *end = '\0';
+  return s;
+}
+
+// Lines are "key = value", '#' starts a comment
+static int fobd_config_read (fobd_config_t c, const char* filename) {
+  FILE* file = fopen (filename, "r");
+  if (file == NULL) {
+    fprintf (stderr, "Can't open %s: %s\n", filename, strerror (errno));
+    return -1;
+  }
+
+  char line[2048];
+  int number = 0;
+  int result = 0;
+
+  while (fgets (line, sizeof (line), file) != NULL) {
+    number++;
+
+    char* comment = strchr (line, '#');
+    if (comment) *comment = '\0';
+
+    char* key = trim (line);
+    if (*key == '\0') continue;
+
+    char* equal = strchr (key, '=');
+    if (equal == NULL) {
+      fprintf (stderr, "%s:%d: missing '='\n", filename, number);
+      result = -1;
+      continue;
+    }
+
+    *equal = '\0';
+    char* value = trim (equal + 1);
+    key = trim (key);
+
+    if (parse_key (c, key, value) == -1) {
+      fprintf (stderr, "%s:%d: bad key or value '%s'\n", filename, number, key);
+      result = -1;
+    }
+  }
+
+  // See realtime_set_thread
+  struct {
+    const char* name;
+    realtime_params_t params;
+  } threads[] = {
+    { "acquisition", &c->acquisition },
+    { "processing", &c->processing }
+  };
+  for (int t = 0; t < 2; t++)
+    if (threads[t].params->policy == REALTIME_SCHED_DEADLINE &&
+        threads[t].params->cpu >= 0) {
+      fprintf (stderr, "%s: %s_cpu can't be used with the deadline scheduler, "
+               "which must be free to run on every CPU; isolate the CPU "
+               "with an exclusive cpuset instead\n",
+               filename, threads[t].name);
+      result = -1;
+    }
+
+  fclose (file);
+  return result;
+}
+
+//_____________ACQUISITION_THREAD____________________________//
+
+static void* acquisition_main (void* arg) {
+  if (realtime_set_thread (&config.acquisition) == -1) {
+    fprintf (stderr, "Error: can't schedule the acquisition thread\n");
+    scheduling_failed = 1;
+    running = 0;
+    return NULL;
+  }
+  realtime_prefault_stack (config.prefault_stack);
+
+  int trackerfd = tracker_get_file_descriptor (tracker);
+  uint64_t previous = 0;
+
+  while (running) {
+    fd_set read_fd_set;
+    FD_ZERO (&read_fd_set);
+    FD_SET (trackerfd, &read_fd_set);
+    struct timeval tv = { 0, 100000 };
+
+    int sel = select (trackerfd + 1, &read_fd_set, NULL, NULL, &tv);
+    if (sel == -1 && errno == EINTR) continue;
+    if (sel == -1) {
+      perror ("select");
+      break;
+    }
+    if (sel == 0) continue;
+
+    if (tracker_read_next_record (tracker) != TRACKER_ERROR_NO_ERROR) {
+      fprintf (stderr, "%s\n", tracker_get_error_string (tracker));
+      break;
+    }
+
+    uint64_t now = realtime_now ();
+    if (previous) realtime_stats_add (&interval_stats, now - previous);
+    previous = now;
+
+    unsigned long head = queue.head;
+    if (head - queue.tail >= QUEUE_SIZE) {
+      // The processing thread is late, this frame is lost
+      queue.dropped++;
+      continue;
+    }
+
+    struct fobd_slot_s* slot = &queue.slots[head % QUEUE_SIZE];
+    slot->timestamp = now;
+    fob_frame_fill (&slot->frame, tracker);
+
+    __sync_synchronize ();
+    queue.head = head + 1;
+
+    char byte = 0;
+    if (write (queue.wake[1], &byte, 1) == -1 && errno != EAGAIN)
+      perror ("write");
+  }
+
+  // The frames queued are processed before the processing thread ends
+  __sync_synchronize ();
+  running = 0;
+  return NULL;
+}
+
+//_____________PROCESSING_THREAD_____________________________//
+
+static void signal_ready (void) {
+  pthread_mutex_lock (&ready_mutex);
+  ready = 1;
+  pthread_cond_signal (&ready_cond);
+  pthread_mutex_unlock (&ready_mutex);
+}
+
+static void wait_ready (void) {
+  pthread_mutex_lock (&ready_mutex);
+  while (!ready)
+    pthread_cond_wait (&ready_cond, &ready_mutex);
+  pthread_mutex_unlock (&ready_mutex);
+}
+
+// Processes the frames waiting in the queue
+static void process_frames (fob_pipeline_t pipeline, iset_list_t iset_list) {
+  while (queue.tail != queue.head) {
+    __sync_synchronize ();
+    struct fobd_slot_s* slot = &queue.slots[queue.tail % QUEUE_SIZE];
+
+    uint64_t start = realtime_now ();
+    realtime_stats_add (&latency_stats, start - slot->timestamp);
+
+    fob_pipeline_process (pipeline, &slot->frame, iset_list);
+
+    realtime_stats_add (&processing_stats, realtime_now () - start);
+    tracker_rate = fob_pipeline_get_rate (pipeline);
+
+    __sync_synchronize ();
+    queue.tail++;
+  }
+}
+
+static void* processing_main (void* arg) {
+  if (realtime_set_thread (&config.processing) == -1) {
+    fprintf (stderr, "Error: can't schedule the processing thread\n");
+    scheduling_failed = 1;
+    running = 0;
+    signal_ready ();
+    return NULL;
+  }
+  realtime_prefault_stack (config.prefault_stack);
+
+  // Gesture detection parameters
+  struct fob_params_s params;
+  fob_params_init (&params);
+  if (config.filter != -1)
+    params.filter.filter = config.filter;
+  params.latency = config.osc_latency;
+
+  // Without list, one can be uploaded over OSC
+  iset_list_t iset_list = NULL;
+  iset_watch_t iset_watch = NULL;
+  if (config.watch_set_list)
+    iset_watch = iset_watch_new ();
+  if (config.set_list[0]) {
+    char path[sizeof (config.set_list)];
+    char name[sizeof (config.set_list)];
+    strcpy (path, config.set_list);
+    strcpy (name, config.set_list);
+    if (iset_watch) {
+      iset_watch_set_file (iset_watch, basename (name), dirname (path));
+      iset_list = iset_watch_wait_list (iset_watch);
+    }
+    else
+      iset_list = iset_list_make (basename (name), dirname (path));
+    if (iset_list->number_of_sets == 0)
+      fprintf (stderr, "Warning: can't find instrument sets in %s\n",
+               config.set_list);
+  }
+  for (int bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++)
+    if (config.sensor_sets[bird] >= 0 &&
+        (iset_list == NULL ||
+         config.sensor_sets[bird] >= iset_list->number_of_sets))
+      fprintf (stderr, "Warning: no set %d for sensor %d\n",
+               config.sensor_sets[bird], bird + 1);
+
+  OSC_init ();
+  OSC_space_t space = OSC_space_make ();
+  fob_params_register_methods (&params, space, &iset_list);
+
+  fob_pipeline_t pipeline = fob_pipeline_new (&params);
+  fob_pipeline_reset (pipeline, tracker_get_flags (tracker));
+  fob_pipeline_set_send_coordinates (pipeline, config.send_coordinates);
+  fob_pipeline_set_bundle_size (pipeline, config.osc_bundle_size);
+  for (int bird = 0; bird < MAX_NUMBER_OF_BIRDS; bird++)
+    fob_pipeline_set_bird_iset (pipeline, bird, config.sensor_sets[bird]);
+  fob_pipeline_register_sensor_sets (pipeline, space);
+  fob_pipeline_register_directions (pipeline, space);
+  if (iset_watch)
+    fob_pipeline_register_uploads (pipeline, space, iset_watch);
+
+  int sockfd = -1;
+  if (config.osc) {
+    struct sockaddr_in host_addr;
+    if ((sockfd = open_socket (config.osc_input_port)) == -1)
+      fprintf (stderr, "Error: can't open OSC input socket\n");
+    else if (fill_host_addr (config.osc_target, config.osc_target_port,
+                             &host_addr) == -1) {
+      fprintf (stderr, "Error: can't get OSC target information\n");
+      close_socket (sockfd);
+      sockfd = -1;
+    }
+    else
+      fob_pipeline_set_output (pipeline, sockfd, &host_addr);
+  }
+
+  // The OSC messages are read by a thread of their own and parsed
+  // between the frames
+  osc_input_t input = NULL;
+  int inputfd = -1;
+  if (sockfd != -1) {
+    if ((input = osc_input_new (sockfd)) == NULL)
+      fprintf (stderr, "Error: can't read the OSC input\n");
+    else
+      inputfd = osc_input_get_wake_fd (input);
+  }
+
+  int maxfd = queue.wake[0] > inputfd ? queue.wake[0] : inputfd;
+  int64_t next_bundle = -1; // Time until the next bundle received for later
+
+  // The acquisition can start
+  signal_ready ();
+
+  while (running) {
+    fd_set read_fd_set;
+    FD_ZERO (&read_fd_set);
+    FD_SET (queue.wake[0], &read_fd_set);
+    if (inputfd != -1) FD_SET (inputfd, &read_fd_set);
+    struct timeval tv = { 0, 100000 };
+    if (next_bundle >= 0 && next_bundle < 100000000)
+      tv.tv_usec = (next_bundle + 999) / 1000;
+
+    int sel = select (maxfd + 1, &read_fd_set, NULL, NULL, &tv);
+    if (sel == -1 && errno == EINTR) continue;
+    if (sel == -1) {
+      perror ("select");
+      break;
+    }
+
+    // Reloaded sets
+    if (iset_watch)
+      iset_list = iset_watch_get_list (iset_watch);
+
+    if (FD_ISSET (queue.wake[0], &read_fd_set)) {
+      char bytes[QUEUE_SIZE];
+      if (read (queue.wake[0], bytes, sizeof (bytes)) == -1 && errno != EAGAIN)
+        perror ("read");
+    }
+
+    process_frames (pipeline, iset_list);
+
+    // The messages received, once the frames are sent
+    if (inputfd != -1 && FD_ISSET (inputfd, &read_fd_set)) {
+      fob_pipeline_receive_OSC (pipeline, space, input, iset_list);
+      osc_input_get_stats (input, &input_stats);
+    }
+    next_bundle = fob_pipeline_dispatch_OSC (pipeline, space, iset_list);
+  }
+
+  // The last frames of a recording
+  __sync_synchronize ();
+  if (iset_watch)
+    iset_list = iset_watch_get_list (iset_watch);
+  process_frames (pipeline, iset_list);
+
+  osc_input_free (input);
+  if (sockfd != -1) close_socket (sockfd);
+  fob_pipeline_free (pipeline);
+  if (iset_watch)
+    iset_watch_free (iset_watch);
+  else
+    iset_list_free (iset_list);
+  OSC_space_free (space);
+  running = 0;
+  return NULL;
+}
+
+//_____________MAIN__________________________________________//
+
+static void print_stats (void) {
+  struct tracker_stats_s stats;
+  tracker_get_stats (tracker, &stats);
+
+  fprintf (stderr, "Tracker: %lu records, %lu errors, %lu resyncs, %lu dropped\n",
+           stats.records, stats.errors, stats.resyncs, stats.dropped);
+  fprintf (stderr, "Queue: %lu frames dropped\n", queue.dropped);
+  fprintf (stderr, "OSC input: %lu datagrams, %lu truncated, %lu dropped, "
+           "%lu errors\n", input_stats.datagrams, input_stats.truncated,
+           input_stats.dropped, input_stats.errors);
+  fprintf (stderr, "Rate: %.1f frames/s\n", tracker_rate);
+  realtime_stats_print (stderr, &interval_stats);
+  realtime_stats_print (stderr, &latency_stats);
+  realtime_stats_print (stderr, &processing_stats);
+}
+
+static int start_thread (pthread_t* thread, void* (*start) (void*)) {
+  int err = pthread_create (thread, NULL, start, NULL);
+  if (err) {
+    fprintf (stderr, "Can't create thread: %s\n", strerror (err));
+    return -1;
+  }
+  return 0;
+}
+
+static void usage (const char* name) {
+  fprintf (stderr, "Usage: %s [-v] config-file\n", name);
+}
+
+int main (int argc, char** argv) {
+  int opt;
+  while ((opt = getopt (argc, argv, "vh")) != -1) {
+    switch (opt) {
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage (argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  fobd_config_init (&config);
+  if (fobd_config_read (&config, argv[optind]) == -1)
+    return EXIT_FAILURE;
+
+  realtime_stats_init (&interval_stats, "Acquisition interval");
+  realtime_stats_init (&latency_stats, "Queue latency");
+  realtime_stats_init (&processing_stats, "Processing time");
+
+  if (config.firmware_path[0])
+    liberty_set_firmware_path (config.firmware_path);
+
+  tracker = tracker_new (config.device);
+  if (tracker == NULL) {
+    fprintf (stderr, "Unknown device %s\n", config.device);
+    return EXIT_FAILURE;
+  }
+
+  if (tracker_open (tracker, config.file) != TRACKER_ERROR_NO_ERROR) {
+    fprintf (stderr, "%s\n", tracker_get_error_string (tracker));
+    tracker_free (tracker);
+    return EXIT_FAILURE;
+  }
+
+  if (config.record[0] &&
+      tracker_start_recording (tracker, config.record) != TRACKER_ERROR_NO_ERROR)
+    fprintf (stderr, "%s\n", tracker_get_error_string (tracker));
+
+  if (verbose)
+    fprintf (stderr, "%s open, %d birds\n",
+             tracker_get_backend (tracker)->label,
+             tracker_get_number_of_birds (tracker));
+
+  if (pipe (queue.wake) == -1) {
+    perror ("pipe");
+    tracker_free (tracker);
+    return EXIT_FAILURE;
+  }
+  fcntl (queue.wake[0], F_SETFL, O_NONBLOCK);
+  fcntl (queue.wake[1], F_SETFL, O_NONBLOCK);
+
+  // Everything is allocated, the realtime threads won't page fault
+  if (config.lock_memory)
+    realtime_lock_memory ();
+
+  struct sigaction action;
+  memset (&action, 0, sizeof (action));
+  action.sa_handler = handle_signal;
+  sigaction (SIGINT, &action, NULL);
+  sigaction (SIGTERM, &action, NULL);
+  sigaction (SIGUSR1, &action, NULL);
+  signal (SIGPIPE, SIG_IGN);
+
+  pthread_t processing_thread, acquisition_thread;
+  int result = EXIT_SUCCESS;
+
+  if (start_thread (&processing_thread, processing_main) == -1) {
+    result = EXIT_FAILURE;
+    goto end;
+  }
+
+  // Not before the sets are loaded and the sockets are open, or the
+  // first frames would be lost
+  wait_ready ();
+  if (scheduling_failed) {
+    pthread_join (processing_thread, NULL);
+    result = EXIT_FAILURE;
+    goto end;
+  }
+
+  if (start_thread (&acquisition_thread, acquisition_main) == -1) {
+    running = 0;
+    pthread_join (processing_thread, NULL);
+    result = EXIT_FAILURE;
+    goto end;
+  }
+
+  int elapsed = 0;
+  while (running) {
+    sleep (1);
+    elapsed++;
+
+    if (report ||
+        (config.stats_interval > 0 && elapsed >= config.stats_interval)) {
+      report = 0;
+      elapsed = 0;
+      print_stats ();
+    }
+  }
+
+  pthread_join (acquisition_thread, NULL);
+  pthread_join (processing_thread, NULL);
+  if (scheduling_failed)
+    result = EXIT_FAILURE;
+
+  if (verbose) print_stats ();
+
+ end:
+  close (queue.wake[0]);
+  close (queue.wake[1]);
+  tracker_free (tracker);
+  return result;
+}
@@ -0,0 +1,1868 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iset.h"
+
+// A set, or a whole list, lives in one block of memory (the arena):
+// the structures, the instruments and their names, the geometry of
+// the instruments as arrays by type of volume, and the spatial index.
+// The files are read first, then the block is allocated and filled.
+#define ARENA_ALIGNMENT 32
+
+// The spatial index is a uniform grid over the bounds of the
+// instruments.  Every cell lists the instruments whose bounds meet it,
+// by rank (decreasing priority, then increasing index), so a lookup
+// only tests the few instruments around the sensor and the first one
+// containing it is the answer.
+#define GRID_MAX_CELLS 32 // Per axis
+#define GRID_MARGIN 1e-4f // Added to the bounds, for the rounding
+
+// A lookup tests all the instruments, SHAPE_LANES at once, instead of
+// going through the grid when the cells list on average more of them
+// than there are groups of lanes, which only happens in small crowded
+// sets.  BRUTE_FORCE_MAX bounds the instruments it may find.
+#ifdef __AVX__
+#define SHAPE_LANES 8
+#else
+#define SHAPE_LANES 4
+#endif
+#define BRUTE_FORCE_MAX 64
+
+typedef float lanes_f __attribute__ ((vector_size (SHAPE_LANES * sizeof (float))));
+typedef int lanes_i __attribute__ ((vector_size (SHAPE_LANES * sizeof (int))));
+
+struct iset_grid_s {
+  float min[3];
+  float max[3];
+  float scale[3]; // Cells per unit
+  int dims[3];
+  int* start; // Of the cells in items, plus the end
+  int* items; // Instrument indices
+  int* rank; // Of every instrument
+};
+
+// The instruments of a type, padded to SHAPE_LANES with volumes that
+// contain nothing
+struct shape_group_s {
+  int count;
+  int* index;
+  float* x, *y, *z; // Centers
+  float* m[9]; // Rotations to the axes of the volumes, by rows
+  int* rotated; // For every SHAPE_LANES volumes, if one is not aligned
+  float* hx, *hy, *hz; // Half sizes
+  // Cylinder: bound of the square of the distance to the axis.
+  // Sphere: bound of the square of the distance to the center.
+  float* r2;
+};
+
+#define SHAPE_ARRAYS 16 // Float arrays of a group
+
+struct iset_shapes_s {
+  struct shape_group_s groups[3]; // BOX, CYLINDER, SPHERE
+};
+
+// The keys of a keyboard (the boxes of a set sharing a keyboard
+// number) are often the same box repeated on a regular lattice.  Then
+// the keys that may contain the sensor are those of the few cells
+// around it, found by index arithmetic, instead of going through the
+// spatial index.  The keys of another size or orientation, or off the
+// lattice, are left to the spatial index.
+#define KEYBOARD_MIN_KEYS 4
+#define KEYBOARD_MAX_REACH 1.5f // Half size of the keys, in cells
+#define KEYBOARD_TOLERANCE 1e-3f // Off the lattice, in cells
+// Keys that may contain the sensor: 4 cells along every axis at most
+#define KEYBOARD_MAX_FOUND 64
+
+struct iset_keyboard_s {
+  float origin[3]; // Center of the first cell
+  float scale[3]; // Cells per unit
+  float reach[3]; // Half size of the keys, in cells, with a margin
+  float half[3]; // Half size of the keys
+  int dims[3];
+  int* cells; // Key of every cell, -1 if none
+};
+
+// A set as read from its file
+struct iset_source_s {
+  char* filename;
+  int number_of_instruments;
+  int allocated;
+  struct instrument_s* instruments; // With malloced names
+  size_t names_size;
+  struct iset_grid_s grid; // Geometry of the grid, without the arrays
+  int cells;
+  int grid_items;
+  int shapes[3]; // Padded number of instruments of every type
+  int* keyed; // Keyboard of every instrument found by it, -1 if none
+  int number_of_keyboards;
+  struct iset_keyboard_s* keyboards; // With malloced cells
+};
+
+struct arena_s {
+  char* base; // NULL to only measure
+  size_t used;
+};
+
+static void*
+arena_alloc (struct arena_s* arena, size_t size) {
+  size_t offset = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+  arena->used = offset + size;
+  return arena->base ? arena->base + offset : NULL;
+}// arena_alloc
+
+// Allocates the block of an arena measured with base == NULL
+static int
+arena_open (struct arena_s* arena) {
+  void* p;
+  if (posix_memalign (&p, ARENA_ALIGNMENT, arena->used ? arena->used : 1))
+    return -1;
+  memset (p, 0, arena->used);
+  arena->base = p;
+  arena->used = 0;
+  return 0;
+}// arena_open
+
+
+//_____________ORIENTATION____________________________________//
+
+// Sets the orientation of an instrument from a quaternion (w, x, y,
+// z), normalized, and the rotation to its axes.  A null quaternion is
+// the identity.
+static void
+instrument_orient (instrument_t inst, double w, double x, double y, double z) {
+  double norm = sqrt (w * w + x * x + y * y + z * z);
+  if (!(norm > 0.)) {
+    w = 1.;
+    x = y = z = 0.;
+    norm = 1.;
+  }
+  w /= norm;
+  x /= norm;
+  y /= norm;
+  z /= norm;
+
+  inst->orientation[0] = w;
+  inst->orientation[1] = x;
+  inst->orientation[2] = y;
+  inst->orientation[3] = z;
+
+  // Transpose of the rotation of the quaternion
+  inst->to_local[0][0] = 1. - 2. * (y * y + z * z);
+  inst->to_local[0][1] = 2. * (x * y + w * z);
+  inst->to_local[0][2] = 2. * (x * z - w * y);
+  inst->to_local[1][0] = 2. * (x * y - w * z);
+  inst->to_local[1][1] = 1. - 2. * (x * x + z * z);
+  inst->to_local[1][2] = 2. * (y * z + w * x);
+  inst->to_local[2][0] = 2. * (x * z + w * y);
+  inst->to_local[2][1] = 2. * (y * z - w * x);
+  inst->to_local[2][2] = 1. - 2. * (x * x + y * y);
+}// instrument_orient
+
+// Same from the angles of the trackers, in degrees: azimuth around Z,
+// then elevation around Y, then roll around X
+static void
+instrument_orient_euler (instrument_t inst,
+                         double azimuth, double elevation, double roll) {
+  double a = azimuth * M_PI / 360., e = elevation * M_PI / 360.,
+    r = roll * M_PI / 360.;
+  double ca = cos (a), sa = sin (a), ce = cos (e), se = sin (e),
+    cr = cos (r), sr = sin (r);
+
+  instrument_orient (inst,
+                     cr * ce * ca + sr * se * sa,
+                     sr * ce * ca - cr * se * sa,
+                     cr * se * ca + sr * ce * sa,
+                     cr * ce * sa - sr * se * ca);
+}// instrument_orient_euler
+
+// Whether the axes of an instrument are those of the set
+static inline int
+instrument_is_aligned (instrument_t inst) {
+  for (int a = 0; a < 3; a++)
+    for (int b = 0; b < 3; b++)
+      if (inst->to_local[a][b] != (a == b ? 1.f : 0.f))
+        return 0;
+  return 1;
+}// instrument_is_aligned
+
+// Position of the sensor relative to the center of an instrument,
+// along its axes
+static inline void
+instrument_to_local (instrument_t inst, float x, float y, float z,
+                     float local[3]) {
+  float dx = x - inst->posX;
+  float dy = y - inst->posY;
+  float dz = z - inst->posZ;
+
+  if (instrument_is_aligned (inst)) {
+    local[0] = dx;
+    local[1] = dy;
+    local[2] = dz;
+    return;
+  }
+
+  for (int a = 0; a < 3; a++)
+    local[a] = inst->to_local[a][0] * dx + inst->to_local[a][1] * dy +
+      inst->to_local[a][2] * dz;
+}// instrument_to_local
+
+// Half sizes of an instrument along its axes.  Returns 0 for an
+// unknown type.
+static int
+instrument_half_sizes (instrument_t inst, double half[3]) {
+  switch (inst->type) {
+  case BOX:
+    half[0] = 0.5 * inst->param1;
+    half[1] = 0.5 * inst->param2;
+    half[2] = 0.5 * inst->param3;
+    return 1;
+  case CYLINDER:
+    half[0] = half[1] = 0.5 * inst->param2;
+    half[2] = 0.5 * inst->param3;
+    return 1;
+  case SPHERE:
+    half[0] = half[1] = half[2] = 0.5 * inst->param2;
+    return 1;
+  default:
+    return 0;
+  }
+}// instrument_half_sizes
+
+
+//_____________SPATIAL_INDEX__________________________________//
+
+// Bounds of an instrument.  Returns 0 for an unknown type.
+static int
+instrument_bounds (instrument_t inst, float lo[3], float hi[3]) {
+  double size[3];
+  if (!instrument_half_sizes (inst, size))
+    return 0;
+
+  // Box of the rotated volume
+  float half[3];
+  for (int a = 0; a < 3; a++) {
+    half[a] = 0.f;
+    for (int b = 0; b < 3; b++)
+      half[a] += fabsf (inst->to_local[b][a]) * (float) fabs (size[b]);
+  }
+
+  float pos[3] = { inst->posX, inst->posY, inst->posZ };
+  for (int a = 0; a < 3; a++) {
+    lo[a] = pos[a] - half[a] - GRID_MARGIN;
+    hi[a] = pos[a] + half[a] + GRID_MARGIN;
+  }
+  return 1;
+}// instrument_bounds
+
+// Cell of a coordinate along an axis, clamped to the grid
+static inline int
+grid_coordinate (iset_grid_t grid, int a, float v) {
+  int c = (int) floorf ((v - grid->min[a]) * grid->scale[a]);
+  if (c < 0) return 0;
+  if (c >= grid->dims[a]) return grid->dims[a] - 1;
+  return c;
+}// grid_coordinate
+
+// Cell of a point, -1 if no instrument can contain it
+static inline int
+grid_cell (iset_grid_t grid, float x, float y, float z) {
+  if (!(x >= grid->min[0] && x <= grid->max[0] &&
+        y >= grid->min[1] && y <= grid->max[1] &&
+        z >= grid->min[2] && z <= grid->max[2]))
+    return -1;
+
+  return (grid_coordinate (grid, 2, z) * grid->dims[1] +
+          grid_coordinate (grid, 1, y)) * grid->dims[0] +
+    grid_coordinate (grid, 0, x);
+}// grid_cell
+
+// Order of the ranks
+static int
+compare_priorities (const void* a, const void* b) {
+  instrument_t i = *(instrument_t*) a, j = *(instrument_t*) b;
+  if (i->priority != j->priority)
+    return i->priority > j->priority ? -1 : 1;
+  return i->index - j->index;
+}// compare_priorities
+
+// Adds the instruments to the cells they meet, in the given order.
+// Without 'next', only counts them in 'counts'.
+static void
+grid_fill (iset_grid_t grid, instrument_t* order, int n,
+           int* counts, int* next) {
+  for (int r = 0; r < n; r++) {
+    float lo[3], hi[3];
+    if (!instrument_bounds (order[r], lo, hi))
+      continue;
+
+    int c0[3], c1[3];
+    for (int a = 0; a < 3; a++) {
+      c0[a] = grid_coordinate (grid, a, lo[a]);
+      c1[a] = grid_coordinate (grid, a, hi[a]);
+    }
+
+    for (int cz = c0[2]; cz <= c1[2]; cz++)
+      for (int cy = c0[1]; cy <= c1[1]; cy++)
+        for (int cx = c0[0]; cx <= c1[0]; cx++) {
+          int cell = (cz * grid->dims[1] + cy) * grid->dims[0] + cx;
+          if (next)
+            grid->items[next[cell]++] = order[r]->index;
+          else
+            counts[cell]++;
+        }
+  }
+}// grid_fill
+
+// Geometry of the grid of a set and size of its arrays, without the
+// keys found by their keyboard
+static void
+grid_plan (struct iset_source_s* source) {
+  iset_grid_t grid = &source->grid;
+  int n = 0;
+
+  for (int a = 0; a < 3; a++) {
+    grid->min[a] = INFINITY;
+    grid->max[a] = -INFINITY;
+    grid->dims[a] = 1;
+  }
+
+  for (int i = 0; i < source->number_of_instruments; i++) {
+    float lo[3], hi[3];
+    if (source->keyed[i] >= 0 ||
+        !instrument_bounds (&source->instruments[i], lo, hi))
+      continue;
+    for (int a = 0; a < 3; a++) {
+      if (lo[a] < grid->min[a]) grid->min[a] = lo[a];
+      if (hi[a] > grid->max[a]) grid->max[a] = hi[a];
+    }
+    n++;
+  }
+
+  source->cells = 1;
+  source->grid_items = 0;
+  if (n == 0)
+    // Nothing to find: empty bounds
+    return;
+
+  // About one instrument per cell
+  float extent[3];
+  double volume = 1.;
+  for (int a = 0; a < 3; a++) {
+    extent[a] = grid->max[a] - grid->min[a];
+    volume *= extent[a];
+  }
+  float size = cbrt (volume / n);
+
+  for (int a = 0; a < 3; a++) {
+    int dim = size > 0.f ? (int) ceilf (extent[a] / size) : 1;
+    if (dim < 1) dim = 1;
+    if (dim > GRID_MAX_CELLS) dim = GRID_MAX_CELLS;
+    grid->dims[a] = dim;
+    grid->scale[a] = dim / extent[a];
+    source->cells *= dim;
+  }
+
+  int count = 0;
+  instrument_t* order = malloc
+    ((source->number_of_instruments + 1) * sizeof (*order));
+  int* counts = calloc (source->cells, sizeof (*counts));
+  for (int i = 0; i < source->number_of_instruments; i++)
+    if (source->keyed[i] < 0)
+      order[count++] = &source->instruments[i];
+  grid_fill (grid, order, count, counts, NULL);
+  for (int cell = 0; cell < source->cells; cell++)
+    source->grid_items += counts[cell];
+  free (counts);
+  free (order);
+}// grid_plan
+
+// Fills the arrays of the grid of a set laid out in an arena.  The
+// keys found by their keyboard ('keyed') have a rank but no cell.
+static void
+grid_build (iset_grid_t grid, iset_t iset, const int* keyed) {
+  int count = iset->number_of_instruments;
+  int cells = grid->dims[0] * grid->dims[1] * grid->dims[2];
+
+  // Ranks
+  instrument_t* order = malloc ((count + 1) * sizeof (*order));
+  memcpy (order, iset->instruments, count * sizeof (*order));
+  qsort (order, count, sizeof (*order), compare_priorities);
+  for (int r = 0; r < count; r++)
+    grid->rank[order[r]->index] = r;
+
+  int n = 0;
+  for (int r = 0; r < count; r++)
+    if (keyed[order[r]->index] < 0)
+      order[n++] = order[r];
+  count = n;
+
+  // Counts, then offsets
+  memset (grid->start, 0, (cells + 1) * sizeof (*grid->start));
+  grid_fill (grid, order, count, grid->start, NULL);
+
+  int total = 0;
+  for (int cell = 0; cell <= cells; cell++) {
+    int n = grid->start[cell];
+    grid->start[cell] = total;
+    total += n;
+  }
+
+  int* next = malloc (cells * sizeof (*next));
+  memcpy (next, grid->start, cells * sizeof (*next));
+  grid_fill (grid, order, count, NULL, next);
+  free (next);
+  free (order);
+}// grid_build
+
+
+//_____________SHAPES_________________________________________//
+
+// Largest float below a bound computed in double, so that the float
+// test "s <= bound" is the double test "s < exact"
+static float
+float_below (double exact) {
+  float f = (float) exact;
+  if ((double) f >= exact)
+    f = nextafterf (f, -INFINITY);
+  return f;
+}// float_below
+
+// Fills the arrays by type of a set laid out in an arena, without the
+// keys found by their keyboard
+static void
+shapes_build (struct iset_shapes_s* shapes, iset_t iset, const int* keyed) {
+  for (int t = 0; t < 3; t++) {
+    struct shape_group_s* g = &shapes->groups[t];
+    for (int i = 0; i < g->count; i++) {
+      // Padding: never hit
+      g->index[i] = -1;
+      g->x[i] = g->y[i] = g->z[i] = 0.f;
+      for (int r = 0; r < 9; r++)
+        g->m[r][i] = 0.f;
+      g->hx[i] = g->hy[i] = g->hz[i] = g->r2[i] = -1.f;
+    }
+    for (int b = 0; b < g->count / SHAPE_LANES; b++)
+      g->rotated[b] = 0;
+    g->count = 0;
+  }
+
+  for (int i = 0; i < iset->number_of_instruments; i++) {
+    instrument_t inst = iset->instruments[i];
+    if (inst->type < BOX || inst->type > SPHERE || keyed[i] >= 0)
+      continue;
+
+    struct shape_group_s* g = &shapes->groups[inst->type];
+    int k = g->count++;
+    g->index[k] = i;
+    g->x[k] = inst->posX;
+    g->y[k] = inst->posY;
+    g->z[k] = inst->posZ;
+    for (int r = 0; r < 9; r++)
+      g->m[r][k] = inst->to_local[r / 3][r % 3];
+    if (!instrument_is_aligned (inst))
+      g->rotated[k / SHAPE_LANES] = 1;
+
+    double half[3];
+    instrument_half_sizes (inst, half);
+    g->hx[k] = half[0];
+    g->hy[k] = half[1];
+    g->hz[k] = half[2];
+    g->r2[k] = float_below (half[0] * half[0]);
+  }
+
+  // Back to the padded sizes
+  for (int t = 0; t < 3; t++) {
+    struct shape_group_s* g = &shapes->groups[t];
+    g->count = (g->count + SHAPE_LANES - 1) / SHAPE_LANES * SHAPE_LANES;
+  }
+}// shapes_build
+
+#define LANES(array) (*(const lanes_f*) &(array)[k])
+
+// Position of the sensor along the axes of SHAPE_LANES instruments of
+// a group starting at 'k', as in instrument_to_local, and whether they
+// contain it.  Returns a bit for each of them.
+static inline int
+shapes_locate (const struct shape_group_s* g, int type, int k,
+               float x, float y, float z, lanes_f local[3]) {
+  lanes_f dx = x - LANES (g->x);
+  lanes_f dy = y - LANES (g->y);
+  lanes_f dz = z - LANES (g->z);
+  lanes_f lx = dx, ly = dy, lz = dz;
+  lanes_i inside;
+
+  if (g->rotated[k / SHAPE_LANES]) {
+    lx = LANES (g->m[0]) * dx + LANES (g->m[1]) * dy + LANES (g->m[2]) * dz;
+    ly = LANES (g->m[3]) * dx + LANES (g->m[4]) * dy + LANES (g->m[5]) * dz;
+    lz = LANES (g->m[6]) * dx + LANES (g->m[7]) * dy + LANES (g->m[8]) * dz;
+  }
+
+  // |l| < h written as l < h and -l < h
+  switch (type) {
+  case BOX: {
+    lanes_f hx = LANES (g->hx), hy = LANES (g->hy), hz = LANES (g->hz);
+    inside = (lx < hx) & (-lx < hx) & (ly < hy) & (-ly < hy) &
+      (lz < hz) & (-lz < hz);
+    break;
+  }
+  case CYLINDER: {
+    lanes_f hz = LANES (g->hz);
+    inside = ((lx * lx + ly * ly) <= LANES (g->r2)) & (lz < hz) & (-lz < hz);
+    break;
+  }
+  default:
+    inside = (lx * lx + ly * ly + lz * lz) <= LANES (g->r2);
+    break;
+  }
+
+  local[0] = lx;
+  local[1] = ly;
+  local[2] = lz;
+
+  int bits = 0;
+  for (int l = 0; l < SHAPE_LANES; l++)
+    bits |= (inside[l] & 1) << l;
+  return bits;
+}// shapes_locate
+
+#undef LANES
+
+
+//_____________KEYBOARDS______________________________________//
+
+static int
+compare_floats (const void* a, const void* b) {
+  float u = *(const float*) a, v = *(const float*) b;
+  return (u > v) - (u < v);
+}// compare_floats
+
+// Lattice of the centers of keys of a size along an axis.  Returns the
+// number of cells, 0 if the keys are too close for their size.
+static int
+lattice_plan (float* centers, int n, double size,
+              float* origin, float* scale) {
+  qsort (centers, n, sizeof (*centers), compare_floats);
+  double extent = (double) centers[n - 1] - centers[0];
+  double tolerance = 1e-5 * (extent + size);
+
+  // The smallest gap between the centers
+  double pitch = 0.;
+  for (int i = 1; i < n; i++) {
+    double gap = (double) centers[i] - centers[i - 1];
+    if (gap > tolerance && (pitch == 0. || gap < pitch))
+      pitch = gap;
+  }
+
+  int dims = 1;
+  if (pitch == 0.)
+    pitch = size;
+  else {
+    dims = (int) lround (extent / pitch) + 1;
+    pitch = extent / (dims - 1);
+  }
+
+  if (0.5 * size / pitch > KEYBOARD_MAX_REACH)
+    return 0;
+  *origin = centers[0];
+  *scale = 1. / pitch;
+  return dims;
+}// lattice_plan
+
+// Keyboard of the keys of number 'number', starting at the first of
+// them, 'first'.  Returns 0 if it is not one.
+static int
+keyboard_plan (struct iset_source_s* source, int first,
+               struct iset_keyboard_s* keyboard) {
+  struct instrument_s* model = &source->instruments[first];
+  int n = source->number_of_instruments;
+  if (model->type != BOX || !instrument_is_aligned (model) ||
+      !(model->param1 > 0.f && model->param2 > 0.f && model->param3 > 0.f))
+    return 0;
+
+  // The keys like the first one
+  int* keys = malloc (n * sizeof (*keys));
+  int count = 0;
+  for (int i = first; i < n; i++) {
+    struct instrument_s* inst = &source->instruments[i];
+    if (inst->keyboard == model->keyboard && inst->type == BOX &&
+        instrument_is_aligned (inst) && inst->param1 == model->param1 &&
+        inst->param2 == model->param2 && inst->param3 == model->param3)
+      keys[count++] = i;
+  }
+
+  size_t cells = 1;
+  float* centers = malloc (n * sizeof (*centers));
+  float sizes[3] = { model->param1, model->param2, model->param3 };
+  for (int a = 0; count >= KEYBOARD_MIN_KEYS && a < 3; a++) {
+    for (int k = 0; k < count; k++) {
+      struct instrument_s* inst = &source->instruments[keys[k]];
+      centers[k] = a == 0 ? inst->posX : a == 1 ? inst->posY : inst->posZ;
+    }
+    keyboard->dims[a] = lattice_plan (centers, count, sizes[a],
+                                      &keyboard->origin[a],
+                                      &keyboard->scale[a]);
+    keyboard->half[a] = 0.5f * sizes[a];
+    keyboard->reach[a] = keyboard->half[a] * keyboard->scale[a] +
+      2.f * KEYBOARD_TOLERANCE;
+    cells *= keyboard->dims[a];
+  }
+  free (centers);
+
+  // Not too sparse
+  if (count < KEYBOARD_MIN_KEYS || cells == 0 ||
+      cells > 4 * (size_t) count + 64) {
+    free (keys);
+    return 0;
+  }
+
+  // The keys on the lattice, one by cell
+  keyboard->cells = malloc (cells * sizeof (*keyboard->cells));
+  for (size_t c = 0; c < cells; c++)
+    keyboard->cells[c] = -1;
+
+  int found = 0;
+  for (int k = 0; k < count; k++) {
+    struct instrument_s* inst = &source->instruments[keys[k]];
+    float center[3] = { inst->posX, inst->posY, inst->posZ };
+    int cell = 0;
+    for (int a = 2; a >= 0 && cell != -1; a--) {
+      float u = (center[a] - keyboard->origin[a]) * keyboard->scale[a];
+      int c = (int) lroundf (u);
+      if (c < 0 || c >= keyboard->dims[a] ||
+          fabsf (u - c) > KEYBOARD_TOLERANCE)
+        cell = -1;
+      else
+        cell = cell * keyboard->dims[a] + c;
+    }
+    if (cell != -1 && keyboard->cells[cell] == -1) {
+      keyboard->cells[cell] = keys[k];
+      found++;
+    }
+  }
+  free (keys);
+
+  if (found < KEYBOARD_MIN_KEYS) {
+    free (keyboard->cells);
+    return 0;
+  }
+  return 1;
+}// keyboard_plan
+
+// Keyboards of a set, and the keys they find
+static void
+keyboards_plan (struct iset_source_s* source) {
+  int n = source->number_of_instruments;
+  source->keyed = malloc ((n + 1) * sizeof (*source->keyed));
+  for (int i = 0; i < n; i++)
+    source->keyed[i] = -1;
+
+  for (int i = 0; i < n; i++) {
+    int number = source->instruments[i].keyboard;
+    int seen = number < 0;
+    for (int j = 0; j < i && !seen; j++)
+      seen = source->instruments[j].keyboard == number;
+    if (seen)
+      continue;
+
+    struct iset_keyboard_s keyboard;
+    if (!keyboard_plan (source, i, &keyboard))
+      continue;
+
+    int k = source->number_of_keyboards++;
+    source->keyboards = realloc
+      (source->keyboards, source->number_of_keyboards * sizeof (keyboard));
+    source->keyboards[k] = keyboard;
+
+    size_t cells = (size_t) keyboard.dims[0] * keyboard.dims[1] *
+      keyboard.dims[2];
+    for (size_t c = 0; c < cells; c++)
+      if (keyboard.cells[c] != -1)
+        source->keyed[keyboard.cells[c]] = k;
+  }
+}// keyboards_plan
+
+
+//_____________SETS___________________________________________//
+
+// Reads a set description from a file, or from memory.  Returns -1
+// if it is not one or if an instrument is cut; the instruments before
+// are kept all the same.
+static int
+iset_source_parse (struct iset_source_s* source, FILE* file) {
+  int error = -1;
+  {
+    // Lines of any length
+    char* buf = NULL;
+    size_t size = 0;
+
+    if (file == NULL)
+      goto read_end;
+
+    if (getline (&buf, &size, file) == -1)
+      goto read_end;
+
+    // The second version may give the orientation of an instrument
+    // after it, on a line "Quaternion w x y z" or "Euler azimuth
+    // elevation roll" (in degrees, see instrument_orient_euler)
+    int version;
+    if (strcmp (buf,"SET DESCRIPTION FILE\n") == 0)
+      version = 1;
+    else if (strcmp (buf,"SET DESCRIPTION FILE 2\n") == 0)
+      version = 2;
+    else
+      goto read_end;
+
+    error = 0;
+    while (getline (&buf, &size, file) != -1) {
+      struct instrument_s _inst;
+      instrument_t inst = &_inst;
+      memset (inst, 0, sizeof (*inst));
+      instrument_orient (inst, 1., 0., 0., 0.);
+
+      if (version >= 2 && source->number_of_instruments > 0) {
+        instrument_t last =
+          &source->instruments[source->number_of_instruments - 1];
+        double q[4];
+        if (sscanf (buf, "Quaternion %lf %lf %lf %lf",
+                    &q[0], &q[1], &q[2], &q[3]) == 4) {
+          instrument_orient (last, q[0], q[1], q[2], q[3]);
+          continue;
+        }
+        if (sscanf (buf, "Euler %lf %lf %lf", &q[0], &q[1], &q[2]) == 3) {
+          instrument_orient_euler (last, q[0], q[1], q[2]);
+          continue;
+        }
+      }
+
+      // Blank lines after the last instrument are not cut instruments
+      if (strspn (buf, " \t\r\n") < strlen (buf))
+        error = -1;
+
+      if (getline (&buf, &size, file) == -1)
+        break;
+
+      int length = strlen (buf);
+      if (length == 0)
+        break;
+
+      if (buf[length - 1] != '\n')
+        break;
+
+      buf[length - 1] = '\0';
+
+      int fields = fscanf(file,
+                          "%d\n"
+                          "%d %d\n"
+                          "%f %f %f\n"
+                          "%f %f %f\n"
+                          "%d %d %d %d %d %d %d %d\n"
+                          "%f %f %f\n",
+                          &inst->type,
+                          &inst->group, &inst->keyboard,
+                          &inst->posX, &inst->posY, &inst->posZ,
+                          &inst->param1, &inst->param2, &inst->param3,
+                          &inst->percussion, &inst->up, &inst->down,
+                          &inst->piston, &inst->etouffe,
+                          &inst->frise, &inst->fla, &inst->continuous,
+                          &inst->red, &inst->green, &inst->blue);
+      if (fields != 20)
+        break;
+      error = 0;
+
+      if (source->number_of_instruments >= source->allocated) {
+        source->allocated += 8;
+        source->instruments = realloc
+          (source->instruments,
+           source->allocated * sizeof (*source->instruments));
+      }
+
+      inst->name = strdup (buf);
+      inst->index = source->number_of_instruments;
+      source->instruments[source->number_of_instruments++] = *inst;
+      source->names_size += length;
+    }
+
+  read_end:
+    free (buf);
+  }
+
+  keyboards_plan (source);
+  grid_plan (source);
+  for (int i = 0; i < source->number_of_instruments; i++) {
+    int type = source->instruments[i].type;
+    if (type >= BOX && type <= SPHERE && source->keyed[i] < 0)
+      source->shapes[type]++;
+  }
+  for (int t = 0; t < 3; t++)
+    source->shapes[t] = (source->shapes[t] + SHAPE_LANES - 1) /
+      SHAPE_LANES * SHAPE_LANES;
+  return error;
+}// iset_source_parse
+
+// Reads a set description file.  A missing file gives an empty set.
+static void
+iset_source_read (struct iset_source_s* source,
+                  const char* filename, const char* directory) {
+  memset (source, 0, sizeof (*source));
+  source->filename = malloc
+    ((strlen (directory) + 1 + strlen (filename) + 1) *
+     sizeof (*source->filename));
+  sprintf (source->filename, "%s/%s", directory, filename);
+
+  FILE* file = fopen (source->filename, "rb");
+  iset_source_parse (source, file);
+  if (file != NULL)
+    fclose (file);
+}// iset_source_read
+
+// Reads a set description in memory, named 'name'.  Returns -1 if it
+// is not one.
+static int
+iset_source_read_memory (struct iset_source_s* source, const char* name,
+                         const void* data, size_t size) {
+  memset (source, 0, sizeof (*source));
+  source->filename = strdup (name);
+
+  // fmemopen doesn't take empty buffers everywhere
+  FILE* file = size > 0 ? fmemopen ((void*) data, size, "rb") : NULL;
+  int error = iset_source_parse (source, file);
+  if (file != NULL)
+    fclose (file);
+  return file != NULL ? error : -1;
+}// iset_source_read_memory
+
+static void
+iset_source_free (struct iset_source_s* source) {
+  free (source->filename);
+  for (int i = 0; i < source->number_of_instruments; i++)
+    free (source->instruments[i].name);
+  free (source->instruments);
+  free (source->keyed);
+  for (int k = 0; k < source->number_of_keyboards; k++)
+    free (source->keyboards[k].cells);
+  free (source->keyboards);
+}// iset_source_free
+
+// Lays a set out in an arena.  Returns NULL when only measuring.
+static iset_t
+iset_layout (struct arena_s* arena, const struct iset_source_s* source) {
+  int n = source->number_of_instruments;
+  int cells = source->cells;
+
+  iset_t iset = arena_alloc (arena, sizeof (*iset));
+  char* filename = arena_alloc (arena, strlen (source->filename) + 1);
+  instrument_t* instruments = arena_alloc (arena, n * sizeof (*instruments));
+  struct instrument_s* storage = arena_alloc (arena, n * sizeof (*storage));
+  char* names = arena_alloc (arena, source->names_size);
+
+  iset_grid_t grid = arena_alloc (arena, sizeof (*grid));
+  int* start = arena_alloc (arena, (cells + 1) * sizeof (*start));
+  int* items = arena_alloc (arena, source->grid_items * sizeof (*items));
+  int* rank = arena_alloc (arena, n * sizeof (*rank));
+
+  struct iset_shapes_s* shapes = arena_alloc (arena, sizeof (*shapes));
+  float* arrays[SHAPE_ARRAYS];
+  int* indices[3];
+  for (int t = 0; t < 3; t++) {
+    size_t count = source->shapes[t];
+    indices[t] = arena_alloc (arena, count * sizeof (int));
+    int* rotated = arena_alloc (arena, count / SHAPE_LANES * sizeof (int));
+    for (int a = 0; a < SHAPE_ARRAYS; a++)
+      arrays[a] = arena_alloc (arena, count * sizeof (float));
+    if (shapes) {
+      struct shape_group_s* g = &shapes->groups[t];
+      g->count = count;
+      g->index = indices[t];
+      g->x = arrays[0];
+      g->y = arrays[1];
+      g->z = arrays[2];
+      for (int r = 0; r < 9; r++)
+        g->m[r] = arrays[3 + r];
+      g->hx = arrays[12];
+      g->hy = arrays[13];
+      g->hz = arrays[14];
+      g->r2 = arrays[15];
+      g->rotated = rotated;
+    }
+  }
+
+  int number_of_keyboards = source->number_of_keyboards;
+  struct iset_keyboard_s* keyboards = arena_alloc
+    (arena, number_of_keyboards * sizeof (*keyboards));
+  for (int k = 0; k < number_of_keyboards; k++) {
+    const struct iset_keyboard_s* keyboard = &source->keyboards[k];
+    size_t cells = (size_t) keyboard->dims[0] * keyboard->dims[1] *
+      keyboard->dims[2];
+    int* storage = arena_alloc (arena, cells * sizeof (*storage));
+    if (keyboards) {
+      keyboards[k] = *keyboard;
+      keyboards[k].cells = storage;
+      memcpy (storage, keyboard->cells, cells * sizeof (*storage));
+    }
+  }
+
+  if (arena->base == NULL)
+    return NULL;
+
+  strcpy (filename, source->filename);
+  iset->filename = filename;
+  iset->number_of_instruments = n;
+  iset->allocated = n;
+  iset->instruments = instruments;
+
+  for (int i = 0; i < n; i++) {
+    storage[i] = source->instruments[i];
+    strcpy (names, source->instruments[i].name);
+    storage[i].name = names;
+    names += strlen (names) + 1;
+    instruments[i] = &storage[i];
+  }
+
+  *grid = source->grid;
+  grid->start = start;
+  grid->items = items;
+  grid->rank = rank;
+  grid_build (grid, iset, source->keyed);
+  iset->grid = grid;
+
+  shapes_build (shapes, iset, source->keyed);
+  iset->shapes = shapes;
+
+  iset->number_of_keyboards = number_of_keyboards;
+  iset->keyboards = keyboards;
+  int keyed = 0;
+  for (int i = 0; i < n; i++)
+    keyed += source->keyed[i] >= 0;
+  int groups = 0;
+  for (int t = 0; t < 3; t++)
+    groups += shapes->groups[t].count / SHAPE_LANES;
+  iset->brute_force = n - keyed <= BRUTE_FORCE_MAX
+    && grid->start[cells] > groups * cells;
+  return iset;
+}// iset_layout
+
+// Lays a set out in a block of its own, and frees its source
+static iset_t
+iset_make_source (struct iset_source_s* source) {
+  struct arena_s arena = { NULL, 0 };
+  iset_layout (&arena, source);
+  if (arena_open (&arena) == -1) {
+    iset_source_free (source);
+    return NULL;
+  }
+
+  iset_t iset = iset_layout (&arena, source);
+  iset->memory = arena.base;
+  iset_source_free (source);
+  return iset;
+}// iset_make_source
+
+// Creation of a set
+iset_t
+iset_make (const char* filename, const char* directory) {
+  struct iset_source_s source;
+  iset_source_read (&source, filename, directory);
+  return iset_make_source (&source);
+}// iset_make
+
+// Free a set
+void
+iset_free (iset_t iset) {
+  if (iset == NULL)
+    return;
+
+  // The sets of a list belong to it
+  free (iset->memory);
+}// iset_free
+
+// Hit of an instrument from the position of the sensor along its axes
+static void
+instrument_hit (instrument_t inst, const float local[3], iset_hit_t hit) {
+  double half[3] = { 1., 1., 1. };
+  instrument_half_sizes (inst, half);
+
+  hit->instrument = inst;
+  hit->delta_x = local[0] / half[0];
+  hit->delta_y = local[1] / half[1];
+  hit->delta_z = local[2] / half[2];
+}// instrument_hit
+
+// Position of the sensor relative to the center of an instrument,
+// divided by its half sizes
+static void
+instrument_locate (instrument_t inst, float x, float y, float z, iset_hit_t hit) {
+  float local[3];
+  instrument_to_local (inst, x, y, z, local);
+  instrument_hit (inst, local, hit);
+}// instrument_locate
+
+// Whether the sensor is in an instrument grown by 'scale' (1 for the
+// instrument itself)
+static int
+instrument_contains (instrument_t inst, float x, float y, float z, double scale) {
+  // Computes the relative position (in comparison to the volume center)
+  float local[3];
+  instrument_to_local (inst, x, y, z, local);
+  float delta_x = local[0];
+  float delta_y = local[1];
+  float delta_z = local[2];
+
+  switch (inst->type) {
+  case BOX:
+    return (fabs ((double)(delta_x)) < 0.5 * inst->param1 * scale) &&
+      (fabs ((double)(delta_y)) < 0.5 * inst->param2 * scale) &&
+      (fabs ((double)(delta_z)) < 0.5 * inst->param3 * scale);
+  case CYLINDER:
+    return ((delta_x * delta_x + delta_y * delta_y) <
+            (0.5 * inst->param2 * scale) * (0.5 * inst->param2 * scale)) &&
+      (fabs ((double)(delta_z)) < 0.5 * inst->param3 * scale);
+  case SPHERE:
+    return (delta_x * delta_x + delta_y * delta_y + delta_z * delta_z) <
+      (0.5 * inst->param2 * scale) * (0.5 * inst->param2 * scale);
+  default:
+    return 0;
+  }
+}// instrument_contains
+
+// Candidates of the cell of a point, by rank.  Returns 0 if none.
+static int
+grid_candidates (iset_t iset, float x, float y, float z,
+                 const int** item, const int** end) {
+  int cell = grid_cell (iset->grid, x, y, z);
+  if (cell < 0)
+    return 0;
+
+  *item = iset->grid->items + iset->grid->start[cell];
+  *end = iset->grid->items + iset->grid->start[cell + 1];
+  return *item < *end;
+}// grid_candidates
+
+// Instrument containing the sensor and the position of the sensor
+// along its axes
+struct found_s {
+  int index;
+  float local[3];
+};
+
+// Instruments containing the sensor, testing all of them.  Returns
+// their number.
+static int
+brute_force_find (iset_t iset, float x, float y, float z,
+                  struct found_s* found) {
+  int n = 0;
+
+  for (int t = BOX; t <= SPHERE; t++) {
+    const struct shape_group_s* g = &iset->shapes->groups[t];
+    for (int k = 0; k < g->count; k += SHAPE_LANES) {
+      lanes_f local[3];
+      int inside = shapes_locate (g, t, k, x, y, z, local);
+      for (int l = 0; inside; l++, inside >>= 1)
+        if (inside & 1) {
+          found[n].index = g->index[k + l];
+          for (int a = 0; a < 3; a++)
+            found[n].local[a] = local[a][l];
+          n++;
+        }
+    }
+  }
+
+  return n;
+}// brute_force_find
+
+// Keys of a keyboard containing the sensor, from the cells around it.
+// Returns their number, up to KEYBOARD_MAX_FOUND.
+static int
+keyboard_find (iset_t iset, const struct iset_keyboard_s* keyboard,
+               float x, float y, float z, struct found_s* found) {
+  float p[3] = { x, y, z };
+  int lo[3], hi[3];
+  for (int a = 0; a < 3; a++) {
+    float u = (p[a] - keyboard->origin[a]) * keyboard->scale[a];
+    // Also false for NaN
+    if (!(u + keyboard->reach[a] >= 0.f &&
+          u - keyboard->reach[a] <= keyboard->dims[a] - 1))
+      return 0;
+    lo[a] = (int) ceilf (u - keyboard->reach[a]);
+    hi[a] = (int) floorf (u + keyboard->reach[a]);
+    if (lo[a] < 0) lo[a] = 0;
+    if (hi[a] >= keyboard->dims[a]) hi[a] = keyboard->dims[a] - 1;
+  }
+
+  // Aligned boxes: the test of instrument_contains, in float since the
+  // half sizes are exact
+  int n = 0;
+  for (int cz = lo[2]; cz <= hi[2]; cz++)
+    for (int cy = lo[1]; cy <= hi[1]; cy++)
+      for (int cx = lo[0]; cx <= hi[0]; cx++) {
+        int key = keyboard->cells
+          [(cz * keyboard->dims[1] + cy) * keyboard->dims[0] + cx];
+        if (key == -1)
+          continue;
+        instrument_t inst = iset->instruments[key];
+        float local[3] = { x - inst->posX, y - inst->posY, z - inst->posZ };
+        if (fabsf (local[0]) < keyboard->half[0] &&
+            fabsf (local[1]) < keyboard->half[1] &&
+            fabsf (local[2]) < keyboard->half[2]) {
+          found[n].index = key;
+          memcpy (found[n].local, local, sizeof (local));
+          n++;
+        }
+      }
+
+  return n;
+}// keyboard_find
+
+// Instrument of highest rank containing the sensor.  Returns 0 if
+// none.
+static int
+find_first (iset_t iset, float x, float y, float z, struct found_s* first) {
+  int* rank = iset->grid->rank;
+  int n = 0;
+
+  if (iset->brute_force) {
+    struct found_s found[BRUTE_FORCE_MAX];
+    n = brute_force_find (iset, x, y, z, found);
+    for (int i = 0; i < n; i++)
+      if (i == 0 || rank[found[i].index] < rank[first->index])
+        *first = found[i];
+  }
+  else {
+    const int* item, *end;
+    if (grid_candidates (iset, x, y, z, &item, &end))
+      for (; item < end; item++)
+        if (instrument_contains (iset->instruments[*item], x, y, z, 1.)) {
+          first->index = *item;
+          instrument_to_local (iset->instruments[*item], x, y, z, first->local);
+          n = 1;
+          break;
+        }
+  }
+
+  for (int k = 0; k < iset->number_of_keyboards; k++) {
+    struct found_s keys[KEYBOARD_MAX_FOUND];
+    int m = keyboard_find (iset, &iset->keyboards[k], x, y, z, keys);
+    for (int i = 0; i < m; i++)
+      if (n == 0 || rank[keys[i].index] < rank[first->index]) {
+        *first = keys[i];
+        n = 1;
+      }
+  }
+
+  return n > 0;
+}// find_first
+
+// Function returning the instrument in which the sensor is (sensor position: (x,y,z) )
+instrument_t
+iset_get_instrument (iset_t iset, float x, float y, float z) {
+  struct iset_hit_s hit;
+  return iset_query (iset, x, y, z, &hit) ? hit.instrument : NULL;
+}// iset_get_instrument
+
+int
+iset_query (iset_t iset, float x, float y, float z, iset_hit_t hit) {
+  hit->instrument = NULL;
+  if (iset == NULL)
+    return 0;
+
+  struct found_s first;
+  if (!find_first (iset, x, y, z, &first))
+    return 0;
+
+  instrument_hit (iset->instruments[first.index], first.local, hit);
+  return 1;
+}// iset_query
+
+// Adds an instrument to the 'n' found, by rank, keeping the first
+// 'max'.  Returns their number.
+static int
+hits_insert (iset_t iset, iset_hit_t hits, int n, int max,
+             const struct found_s* found) {
+  int* rank = iset->grid->rank;
+  int j = n < max ? n : max;
+  for (; j > 0 && rank[hits[j - 1].instrument->index] > rank[found->index]; j--)
+    if (j < max)
+      hits[j] = hits[j - 1];
+  if (j < max)
+    instrument_hit (iset->instruments[found->index], found->local, &hits[j]);
+  return n + 1;
+}// hits_insert
+
+// Instruments containing the sensor through the spatial index, by rank
+static int
+query_all_indexed (iset_t iset, float x, float y, float z,
+                   iset_hit_t hits, int max) {
+  int n = 0;
+
+  if (iset->brute_force) {
+    struct found_s found[BRUTE_FORCE_MAX];
+    int* rank = iset->grid->rank;
+    n = brute_force_find (iset, x, y, z, found);
+
+    // By rank
+    for (int i = 1; i < n; i++) {
+      struct found_s f = found[i];
+      int j = i;
+      for (; j > 0 && rank[found[j - 1].index] > rank[f.index]; j--)
+        found[j] = found[j - 1];
+      found[j] = f;
+    }
+
+    for (int i = 0; i < n && i < max; i++)
+      instrument_hit (iset->instruments[found[i].index], found[i].local,
+                      &hits[i]);
+    return n;
+  }
+
+  const int* item, *end;
+  if (!grid_candidates (iset, x, y, z, &item, &end))
+    return 0;
+
+  for (; item < end; item++) {
+    instrument_t inst = iset->instruments[*item];
+    if (instrument_contains (inst, x, y, z, 1.)) {
+      if (n < max)
+        instrument_locate (inst, x, y, z, &hits[n]);
+      n++;
+    }
+  }
+
+  return n;
+}// query_all_indexed
+
+int
+iset_query_all (iset_t iset, float x, float y, float z,
+                iset_hit_t hits, int max) {
+  if (iset == NULL)
+    return 0;
+
+  int n = query_all_indexed (iset, x, y, z, hits, max);
+  for (int k = 0; k < iset->number_of_keyboards; k++) {
+    struct found_s keys[KEYBOARD_MAX_FOUND];
+    int m = keyboard_find (iset, &iset->keyboards[k], x, y, z, keys);
+    for (int i = 0; i < m; i++)
+      n = hits_insert (iset, hits, n, max, &keys[i]);
+  }
+  return n;
+}// iset_query_all
+
+//_____________PRESENCE_______________________________________//
+
+void
+iset_presence_init (iset_presence_t presence) {
+  presence->instrument = -1;
+  presence->candidate = -1;
+  presence->since = 0;
+}// iset_presence_init
+
+// Whether an instrument of higher rank than 'previous' contains the
+// sensor: the candidates before it in the cell, as they are by rank,
+// and the keys around the sensor
+static int
+presence_outranked (iset_t iset, int previous, float x, float y, float z) {
+  const int* rank = iset->grid->rank;
+  const int* item, *end;
+  if (grid_candidates (iset, x, y, z, &item, &end))
+    for (; item < end && rank[*item] < rank[previous]; item++)
+      if (instrument_contains (iset->instruments[*item], x, y, z, 1.))
+        return 1;
+
+  for (int k = 0; k < iset->number_of_keyboards; k++) {
+    struct found_s keys[KEYBOARD_MAX_FOUND];
+    int m = keyboard_find (iset, &iset->keyboards[k], x, y, z, keys);
+    for (int i = 0; i < m; i++)
+      if (rank[keys[i].index] < rank[previous])
+        return 1;
+  }
+  return 0;
+}// presence_outranked
+
+// Instrument the sensor is in, keeping the one it was in while it is
+// in its grown volume and no instrument of higher rank holds it
+static int
+presence_find (iset_t iset, int previous, double scale,
+               float x, float y, float z) {
+  // The sensor mostly stays in its instrument: then only the
+  // instruments before it are tested
+  if (previous >= 0 && previous < iset->number_of_instruments &&
+      !iset->brute_force &&
+      instrument_contains (iset->instruments[previous], x, y, z, scale) &&
+      !presence_outranked (iset, previous, x, y, z))
+    return previous;
+
+  struct found_s first;
+  int found = find_first (iset, x, y, z, &first) ? first.index : -1;
+
+  if (previous < 0 || previous >= iset->number_of_instruments ||
+      previous == found)
+    return found;
+  if (found != -1 && iset->grid->rank[found] < iset->grid->rank[previous])
+    return found;
+  if (instrument_contains (iset->instruments[previous], x, y, z, scale))
+    return previous;
+  return found;
+}// presence_find
+
+int
+iset_update_presence (iset_t iset, iset_presence_t presence,
+                      const struct iset_hysteresis_s* hysteresis,
+                      float x, float y, float z, uint64_t time,
+                      iset_hit_t hit) {
+  hit->instrument = NULL;
+  if (iset == NULL) {
+    int changed = presence->instrument != -1;
+    iset_presence_init (presence);
+    return changed;
+  }
+
+  int current = presence->instrument;
+  if (current >= iset->number_of_instruments)
+    current = -1;
+  int found = presence_find (iset, current, 1. + hysteresis->margin, x, y, z);
+
+  int changed = 0;
+  if (found == current)
+    presence->candidate = current;
+  else {
+    // The other instrument has to stay found for the delay
+    if (found != presence->candidate) {
+      presence->candidate = found;
+      presence->since = time;
+    }
+    if (time - presence->since >= hysteresis->delay) {
+      current = found;
+      changed = 1;
+    }
+  }
+
+  if (current != presence->instrument)
+    changed = 1;
+  presence->instrument = current;
+  if (current != -1)
+    instrument_locate (iset->instruments[current], x, y, z, hit);
+  return changed;
+}// iset_update_presence
+
+
+//_____________COMPILED_LISTS_________________________________//
+
+// A compiled list is the block of a list as laid out in its arena,
+// after a header, with offsets from the start of the file instead of
+// the pointers.  Mapping it only takes to turn the offsets back into
+// pointers.
+#define COMPILED_MAGIC "FoBsets\n"
+#define COMPILED_VERSION 2
+#define COMPILED_HEADER_SIZE 64 // Keeps the block aligned
+
+struct compiled_header_s {
+  char magic[8];
+  uint32_t version;
+  uint32_t layout; // See compiled_layout
+  uint64_t size; // Of the block
+};
+
+// Fingerprint of the structures of the block, which must be the same
+// for the program mapping a list as for the one that compiled it
+static uint32_t
+compiled_layout (void) {
+  uint32_t sizes[] = {
+    sizeof (void*), sizeof (struct iset_list_s), sizeof (struct iset_s),
+    sizeof (struct instrument_s), sizeof (struct iset_grid_s),
+    sizeof (struct iset_shapes_s), SHAPE_LANES, ARENA_ALIGNMENT, 0x01020304
+  };
+  uint32_t layout = 0;
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (*sizes); i++)
+    layout = layout * 31 + sizes[i];
+  return layout;
+}// compiled_layout
+
+// Pointers of a block being moved: a pointer p becomes p - from + to,
+// and what it points to is at p - from + view
+struct relocation_s {
+  uintptr_t from;
+  uintptr_t to;
+  uintptr_t view;
+};
+
+// Moves a pointer, given by its address.  Returns where its target
+// can be read.
+static void*
+relocate (const struct relocation_s* r, void* field) {
+  void** pointer = field;
+  if (*pointer == NULL)
+    return NULL;
+
+  uintptr_t p = (uintptr_t) *pointer;
+  *pointer = (void*) (p - r->from + r->to);
+  return (void*) (p - r->from + r->view);
+}// relocate
+
+// Moves all the pointers of a list laid out in an arena
+static void
+iset_list_relocate (iset_list_t list, const struct relocation_s* r) {
+  relocate (r, &list->filename);
+  iset_t* isets = relocate (r, &list->isets);
+
+  for (int s = 0; s < list->number_of_sets; s++) {
+    iset_t iset = relocate (r, &isets[s]);
+    relocate (r, &iset->filename);
+
+    instrument_t* instruments = relocate (r, &iset->instruments);
+    for (int i = 0; i < iset->number_of_instruments; i++) {
+      instrument_t inst = relocate (r, &instruments[i]);
+      relocate (r, &inst->name);
+    }
+
+    iset_grid_t grid = relocate (r, &iset->grid);
+    relocate (r, &grid->start);
+    relocate (r, &grid->items);
+    relocate (r, &grid->rank);
+
+    struct iset_shapes_s* shapes = relocate (r, &iset->shapes);
+    for (int t = 0; t < 3; t++) {
+      struct shape_group_s* g = &shapes->groups[t];
+      relocate (r, &g->index);
+      relocate (r, &g->x);
+      relocate (r, &g->y);
+      relocate (r, &g->z);
+      for (int m = 0; m < 9; m++)
+        relocate (r, &g->m[m]);
+      relocate (r, &g->rotated);
+      relocate (r, &g->hx);
+      relocate (r, &g->hy);
+      relocate (r, &g->hz);
+      relocate (r, &g->r2);
+    }
+
+    struct iset_keyboard_s* keyboards = relocate (r, &iset->keyboards);
+    for (int k = 0; k < iset->number_of_keyboards; k++)
+      relocate (r, &keyboards[k].cells);
+  }
+}// iset_list_relocate
+
+int
+iset_list_compile (iset_list_t list, const char* filename) {
+  // Only the lists in one block
+  if (list == NULL || list->set_filenames != NULL)
+    return -1;
+
+  size_t length = COMPILED_HEADER_SIZE + list->size;
+  char* image = calloc (1, length);
+  if (image == NULL)
+    return -1;
+
+  struct compiled_header_s header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, COMPILED_MAGIC, sizeof (header.magic));
+  header.version = COMPILED_VERSION;
+  header.layout = compiled_layout ();
+  header.size = list->size;
+  memcpy (image, &header, sizeof (header));
+  memcpy (image + COMPILED_HEADER_SIZE, list, list->size);
+
+  iset_list_t copy = (iset_list_t) (image + COMPILED_HEADER_SIZE);
+  copy->current_iset_index = 0;
+  copy->memory = NULL;
+  copy->mapped = 0;
+  struct relocation_s r = {
+    (uintptr_t) list - COMPILED_HEADER_SIZE, 0, (uintptr_t) image
+  };
+  iset_list_relocate (copy, &r);
+
+  // Replaced at once, for the programs mapping it
+  char* temporary = malloc (strlen (filename) + 5);
+  sprintf (temporary, "%s.tmp", filename);
+  FILE* file = fopen (temporary, "wb");
+  int error = file == NULL;
+  if (file != NULL) {
+    error = fwrite (image, 1, length, file) != length;
+    error |= fclose (file) != 0;
+  }
+  if (!error)
+    error = rename (temporary, filename) != 0;
+  else
+    unlink (temporary);
+
+  free (temporary);
+  free (image);
+  return error ? -1 : 0;
+}// iset_list_compile
+
+// Maps a compiled list.  Returns NULL, with *compiled set if the file
+// is a compiled list all the same, when it can't.
+static iset_list_t
+iset_list_map (const char* filename, int* compiled) {
+  *compiled = 0;
+  int fd = open (filename, O_RDONLY);
+  if (fd == -1)
+    return NULL;
+
+  struct compiled_header_s header;
+  struct stat st;
+  if (read (fd, &header, sizeof (header)) != sizeof (header) ||
+      memcmp (header.magic, COMPILED_MAGIC, sizeof (header.magic)) != 0 ||
+      fstat (fd, &st) == -1) {
+    close (fd);
+    return NULL;
+  }
+
+  *compiled = 1;
+  if (header.version != COMPILED_VERSION ||
+      header.layout != compiled_layout () ||
+      (uint64_t) st.st_size < COMPILED_HEADER_SIZE + header.size) {
+    fprintf (stderr, "%s was compiled for another version of FoB\n", filename);
+    close (fd);
+    return NULL;
+  }
+
+  // Private: the pointers are written in the pages of this process
+  size_t length = st.st_size;
+  char* image = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (image == MAP_FAILED)
+    return NULL;
+
+  iset_list_t list = (iset_list_t) (image + COMPILED_HEADER_SIZE);
+  struct relocation_s r = { 0, (uintptr_t) image, (uintptr_t) image };
+  iset_list_relocate (list, &r);
+  list->memory = image;
+  list->size = header.size;
+  list->mapped = length;
+  return list;
+}// iset_list_map
+
+// Lays a list out in an arena.  Returns NULL when only measuring.
+static iset_list_t
+iset_list_layout (struct arena_s* arena, const char* filename,
+                  const struct iset_source_s* sources, int number_of_sets) {
+  iset_list_t list = arena_alloc (arena, sizeof (*list));
+  char* name = arena_alloc (arena, strlen (filename) + 1);
+  iset_t* isets = arena_alloc (arena, number_of_sets * sizeof (*isets));
+
+  for (int i = 0; i < number_of_sets; i++) {
+    iset_t iset = iset_layout (arena, &sources[i]);
+    if (isets)
+      isets[i] = iset;
+  }
+
+  if (arena->base == NULL)
+    return NULL;
+
+  strcpy (name, filename);
+  list->filename = name;
+  list->number_of_sets = number_of_sets;
+  list->allocated = number_of_sets;
+  list->isets = isets;
+  return list;
+}// iset_list_layout
+
+// Names of the set files of a list file.  Returns their number.
+static int
+iset_list_read_names (const char* list_filename, char*** names) {
+  int number_of_sets = 0, allocated = 0;
+  FILE* file = fopen (list_filename, "rb");
+  char iset_filename[1024];
+
+  *names = NULL;
+  while (file != NULL &&
+         fgets (iset_filename, sizeof (iset_filename), file) != NULL) {
+    int length = strlen (iset_filename);
+
+    if (length == 0)
+      continue;
+
+    if (iset_filename[length - 1] == '\n') {
+      if (length == 1)
+        continue;
+      iset_filename[length - 1] = '\0';
+      length--;
+    }
+
+    if (number_of_sets >= allocated) {
+      allocated += 8;
+      *names = realloc (*names, allocated * sizeof (**names));
+    }
+
+    (*names)[number_of_sets++] = strdup (iset_filename);
+  }
+
+  if (file != NULL)
+    fclose (file);
+  return number_of_sets;
+}// iset_list_read_names
+
+// Make a list of instrument sets
+iset_list_t
+iset_list_make (const char* filename, const char* directory) {
+  char* list_filename = malloc
+    ((strlen (directory) + 1 + strlen (filename) + 1) *
+     sizeof (*list_filename));
+  sprintf (list_filename, "%s/%s", directory, filename);
+
+  int compiled = 0;
+  iset_list_t mapped = iset_list_map (list_filename, &compiled);
+  if (mapped != NULL) {
+    free (list_filename);
+    return mapped;
+  }
+
+  // An unusable compiled list gives an empty list
+  char** names = NULL;
+  int number_of_sets = compiled ? 0 : iset_list_read_names (list_filename, &names);
+  struct iset_source_s* sources = malloc
+    ((number_of_sets + 1) * sizeof (*sources));
+  for (int i = 0; i < number_of_sets; i++) {
+    iset_source_read (&sources[i], names[i], directory);
+    free (names[i]);
+  }
+  free (names);
+
+  // One block for the list and all its sets
+  iset_list_t list = NULL;
+  struct arena_s arena = { NULL, 0 };
+  iset_list_layout (&arena, list_filename, sources, number_of_sets);
+  if (arena_open (&arena) == 0) {
+    list = iset_list_layout (&arena, list_filename, sources, number_of_sets);
+    list->memory = arena.base;
+    list->size = arena.used;
+  }
+
+  for (int i = 0; i < number_of_sets; i++)
+    iset_source_free (&sources[i]);
+  free (sources);
+  free (list_filename);
+  return list;
+}// iset_list_make
+
+// Free a list of instrument sets
+void
+iset_list_free (iset_list_t list) {
+  if (list == NULL)
+    return;
+
+  if (list->set_filenames) {
+    // Opened lazily: a block for every set
+    for (int i = 0; i < list->number_of_sets; i++) {
+      iset_free (list->isets[i]);
+      free (list->set_filenames[i]);
+    }
+    free (list->set_filenames);
+    free (list->directory);
+    free (list->isets);
+    free (list->filename);
+    free (list);
+  }
+  else if (list->mapped)
+    munmap (list->memory, list->mapped);
+  else
+    free (list->memory);
+}// iset_list_free
+
+// Open a list of instrument sets without loading them
+iset_list_t
+iset_list_open (const char* filename, const char* directory) {
+  char* list_filename = malloc
+    ((strlen (directory) + 1 + strlen (filename) + 1) *
+     sizeof (*list_filename));
+  sprintf (list_filename, "%s/%s", directory, filename);
+
+  // A compiled list is ready at once
+  int compiled = 0;
+  iset_list_t list = iset_list_map (list_filename, &compiled);
+  if (list != NULL) {
+    free (list_filename);
+    return list;
+  }
+
+  // An unusable compiled list gives an empty list
+  list = calloc (1, sizeof (*list));
+  list->filename = list_filename;
+  list->directory = strdup (directory);
+  if (!compiled)
+    list->number_of_sets = iset_list_read_names (list_filename,
+                                                 &list->set_filenames);
+  list->allocated = list->number_of_sets;
+  list->isets = calloc (list->number_of_sets + 1, sizeof (*list->isets));
+  if (list->set_filenames == NULL)
+    // Empty, but opened lazily all the same
+    list->set_filenames = calloc (1, sizeof (*list->set_filenames));
+  return list;
+}// iset_list_open
+
+// Name of a set read from memory in place of set 'index'
+static char*
+iset_list_set_name (iset_list_t list, int index) {
+  const char* filename = list->set_filenames[index];
+  char* name;
+  if (filename != NULL && list->directory != NULL) {
+    name = malloc (strlen (list->directory) + 1 + strlen (filename) + 1);
+    sprintf (name, "%s/%s", list->directory, filename);
+  }
+  else {
+    name = malloc (strlen (list->filename) + 16);
+    sprintf (name, "%s/%d", list->filename, index + 1);
+  }
+  return name;
+}// iset_list_set_name
+
+// Make a list of instrument sets from their descriptions in memory
+iset_list_t
+iset_list_read (const char* name, const void* data, size_t size) {
+  // Every description starts with its first line
+  static const char header[] = "SET DESCRIPTION FILE";
+  const char* text = data;
+  size_t* starts = NULL;
+  int number_of_sets = 0;
+
+  for (size_t p = 0; p + sizeof (header) - 1 <= size; p++)
+    if ((p == 0 || text[p - 1] == '\n') &&
+        memcmp (text + p, header, sizeof (header) - 1) == 0) {
+      starts = realloc (starts, (number_of_sets + 1) * sizeof (*starts));
+      starts[number_of_sets++] = p;
+    }
+
+  if (number_of_sets == 0 || starts[0] != 0) {
+    free (starts);
+    return NULL;
+  }
+
+  // Shaped as a list opened lazily, with every set loaded
+  iset_list_t list = calloc (1, sizeof (*list));
+  list->filename = strdup (name);
+  list->number_of_sets = number_of_sets;
+  list->allocated = number_of_sets;
+  list->isets = calloc (number_of_sets, sizeof (*list->isets));
+  list->set_filenames = calloc (number_of_sets, sizeof (*list->set_filenames));
+
+  for (int i = 0; i < number_of_sets; i++) {
+    size_t end = i + 1 < number_of_sets ? starts[i + 1] : size;
+    if (iset_list_read_iset (list, i, text + starts[i], end - starts[i]) == -1) {
+      iset_list_free (list);
+      list = NULL;
+      break;
+    }
+  }
+
+  free (starts);
+  return list;
+}// iset_list_read
+
+// Read a set of a list from its description in memory
+int
+iset_list_read_iset (iset_list_t list, int index,
+                     const void* data, size_t size) {
+  if (list->set_filenames == NULL || index < 0 || index >= list->number_of_sets)
+    return -1;
+
+  struct iset_source_s source;
+  char* name = iset_list_set_name (list, index);
+  int error = iset_source_read_memory (&source, name, data, size);
+  free (name);
+  if (error == -1) {
+    iset_source_free (&source);
+    return -1;
+  }
+
+  iset_t iset = iset_make_source (&source);
+  if (iset == NULL)
+    return -1;
+
+  iset_free (list->isets[index]);
+  list->isets[index] = iset;
+  return 0;
+}// iset_list_read_iset
+
+// Load the current set of a list opened lazily, or the first one not
+// loaded yet
+int
+iset_list_load_next (iset_list_t list) {
+  if (list->set_filenames == NULL)
+    return -1;
+
+  int next = __atomic_load_n (&list->current_iset_index, __ATOMIC_RELAXED);
+  if (next < 0 || next >= list->number_of_sets || list->isets[next] != NULL)
+    for (next = 0; next < list->number_of_sets; next++)
+      if (list->isets[next] == NULL)
+        break;
+  if (next >= list->number_of_sets)
+    return -1;
+
+  // A missing file gives an empty set
+  iset_t iset = iset_make (list->set_filenames[next], list->directory);
+  if (iset == NULL)
+    return -1;
+
+  __atomic_store_n (&list->isets[next], iset, __ATOMIC_RELEASE);
+  return next;
+}// iset_list_load_next
+
+// Get a set of a list
+iset_t
+iset_list_get_iset (iset_list_t list, int index) {
+  if (list == NULL || index < 0 || index >= list->number_of_sets)
+    return NULL;
+
+  return __atomic_load_n (&list->isets[index], __ATOMIC_ACQUIRE);
+}// iset_list_get_iset
+
+// Whether the current set is still loading
+int
+iset_list_is_pending (iset_list_t list) {
+  return list != NULL && list->number_of_sets > 0 &&
+    iset_list_get_iset (list, list->current_iset_index) == NULL;
+}// iset_list_is_pending
+
+// Choose  a set in the list (each set has an index)
+void
+iset_list_set_current_iset_index (iset_list_t list, int n) {
+  if(n < 0) n = 0;
+  if(n >= list->number_of_sets) n = list->number_of_sets - 1;
+  
+  // Read by the thread loading the sets
+  __atomic_store_n (&list->current_iset_index, n, __ATOMIC_RELAXED);
+}// iset_list_set_current_iset_index
+
+// Get an instrument from the current set
+instrument_t
+iset_list_get_instrument (iset_list_t list, float x, float y, float z) {
+  if (list == NULL)
+    return NULL;
+
+  return iset_get_instrument
+    (iset_list_get_iset (list, list->current_iset_index), x, y, z);
+}// iset_list_get_instrument
+
+// Update the instrument of a sensor in the current set
+int
+iset_list_update_presence (iset_list_t list, iset_presence_t presence,
+                           const struct iset_hysteresis_s* hysteresis,
+                           float x, float y, float z, uint64_t time,
+                           iset_hit_t hit) {
+  iset_t iset = NULL;
+  if (list != NULL)
+    iset = iset_list_get_iset (list, list->current_iset_index);
+
+  return iset_update_presence (iset, presence, hysteresis, x, y, z, time, hit);
+}// iset_list_update_presence
@@ -0,0 +1,230 @@
+#ifndef __iset_h__
+#define __iset_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Instrument sets: the volumes of a 3D map, loaded from the set
+// description files written by the set designer, and the lists of
+// sets that can be switched over OSC.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Setting of the different kinds of instruments
+typedef enum {
+  BOX = 0,
+  CYLINDER = 1,
+  SPHERE = 2
+} instrument_type_t;
+
+
+// Structure of an instrument
+typedef struct instrument_s* instrument_t;
+struct instrument_s {
+  // Identification
+  char* name;
+  int index; // Position in current set
+  int group; // Group of instruments to which it belongs
+  int keyboard; // If it is part of a keyboard
+  int type;
+  // Geometrical parameters
+  float posX;
+  float posY;
+  float posZ;
+  float param1;
+  float param2;
+  float param3;
+  // Orientation: unit quaternion (w, x, y, z) turning the axes of the
+  // volume into those of the set, identity unless given by the file,
+  // and the rotation taking the coordinates of the set to those of the
+  // volume, computed from it
+  float orientation[4];
+  float to_local[3][3];
+  // Gameplay
+  int percussion;
+  int up;
+  int down;
+  int piston;
+  int etouffe;
+  int frise;
+  int fla;
+  int continuous;
+  // Application informations
+  float red;
+  float green;
+  float blue;
+
+  // The highest is found when volumes overlap, then the lowest index
+  int priority;
+};
+
+// Instrument found for a sensor
+typedef struct iset_hit_s* iset_hit_t;
+struct iset_hit_s {
+  instrument_t instrument; // NULL for none
+  // Position relative to the center, along the axes of the volume,
+  // divided by the half sizes (in ]-1, 1[ inside)
+  float delta_x;
+  float delta_y;
+  float delta_z;
+};
+
+
+
+// Spatial index of a set, and its instruments as arrays by type of
+// volume (see iset.c)
+typedef struct iset_grid_s* iset_grid_t;
+typedef struct iset_shapes_s* iset_shapes_t;
+typedef struct iset_keyboard_s* iset_keyboard_t;
+
+// Structure of an instrument set.  The set and everything it points to
+// are in one block of memory, that of its list for the sets of a list.
+typedef struct iset_s* iset_t;
+struct iset_s {
+  char* filename;
+  int number_of_instruments;
+  int allocated;
+  instrument_t* instruments;
+  iset_grid_t grid;
+  iset_shapes_t shapes;
+  // Keyboards whose keys are looked up on a lattice instead of through
+  // the spatial index
+  int number_of_keyboards;
+  iset_keyboard_t keyboards;
+  // Lookups test every instrument instead of going through the grid
+  // (set for small crowded sets)
+  int brute_force;
+  void* memory; // Block of the set, NULL in a list
+};
+
+// Structure of a list of instrument sets
+typedef struct iset_list_s* iset_list_t;
+struct iset_list_s {
+  char* filename;
+  int number_of_sets;
+  int allocated;
+  iset_t* isets; // NULL while loading, see iset_list_get_iset
+  int current_iset_index;
+  void* memory; // Block of the list and of its sets
+  size_t size; // Of the block, from the list
+  size_t mapped; // Length of the mapping of a compiled list, 0 if allocated
+  // Lists opened lazily or read from memory, whose sets have their own
+  // block (NULL names for the sets read from memory)
+  char** set_filenames;
+  char* directory;
+};
+
+// Creation of a set from a set description file
+extern iset_t iset_make (const char* filename, const char* directory);
+// Free a set
+extern void iset_free (iset_t iset);
+// The queries don't change the set and can be made from several
+// threads at once.
+
+// Instrument in which the sensor is (sensor position: (x,y,z) ).
+// When several contain it, the one with the highest priority, then
+// the lowest index.
+extern instrument_t iset_get_instrument (iset_t iset, float x, float y, float z);
+// Same with the position in the instrument.  Returns 0 if none.
+extern int iset_query (iset_t iset, float x, float y, float z, iset_hit_t hit);
+// Every instrument containing the sensor, by decreasing priority.
+// Returns their number; the first 'max' are stored in 'hits'.
+extern int iset_query_all (iset_t iset, float x, float y, float z,
+                           iset_hit_t hits, int max);
+
+// Hysteresis of the instrument a sensor is in, against the enter and
+// leave storms of a sensor shaking on a boundary
+typedef struct iset_hysteresis_s* iset_hysteresis_t;
+struct iset_hysteresis_s {
+  // The sensor stays in its instrument until it is out of the
+  // instrument grown by this fraction of its size (unless an
+  // instrument of higher priority holds it)
+  float margin;
+  // Another instrument, or none, must be found for this time before
+  // the sensor changes, in nanoseconds
+  uint64_t delay;
+};
+
+// Instrument a sensor is in, kept by the caller
+typedef struct iset_presence_s* iset_presence_t;
+struct iset_presence_s {
+  int instrument; // Index, -1 for none
+  int candidate; // Found instead since 'since'
+  uint64_t since;
+};
+
+extern void iset_presence_init (iset_presence_t presence);
+// Updates the instrument of the sensor and fills 'hit' with it (the
+// deltas may be out of ]-1, 1[ in the margin).  Returns 1 if it
+// changed.  'time' is in nanoseconds.
+extern int iset_update_presence (iset_t iset, iset_presence_t presence,
+                                 const struct iset_hysteresis_s* hysteresis,
+                                 float x, float y, float z, uint64_t time,
+                                 iset_hit_t hit);
+
+// Make a list of instrument sets, from a list of set description
+// files or from a list compiled by iset_list_compile, mapped as it is
+extern iset_list_t iset_list_make (const char* filename, const char* directory);
+// Writes a list with its sets and their index, ready to be mapped by
+// iset_list_make on a machine of the same architecture.  Returns -1
+// on error.
+extern int iset_list_compile (iset_list_t list, const char* filename);
+// Free a list of instrument sets
+extern void iset_list_free (iset_list_t list);
+// Reads a list of set description files without the sets, which are
+// loaded one at a time by iset_list_load_next, possibly by another
+// thread than the one using the list.  A compiled list is mapped at
+// once.
+extern iset_list_t iset_list_open (const char* filename, const char* directory);
+// Loads the current set of a list opened lazily if it is not loaded
+// yet, else the first one that is not.  Returns its index, -1 when all
+// of them are loaded.
+extern int iset_list_load_next (iset_list_t list);
+// Make a list of instrument sets from the descriptions of its sets in
+// memory, as in set description files, one after the other.  Returns
+// NULL if one of them is not a set description or an instrument is
+// cut.  Like a list opened lazily, with all its sets loaded.
+extern iset_list_t iset_list_read (const char* name,
+                                   const void* data, size_t size);
+// Reads set 'index' of a list opened lazily, or read from memory, from
+// its description in memory instead of its file.  Returns -1 if the
+// description is not valid, the list is not one of these or has no
+// such set.  Only before the list is shared with another thread.
+extern int iset_list_read_iset (iset_list_t list, int index,
+                                const void* data, size_t size);
+// Set of a list, NULL while it is not loaded
+extern iset_t iset_list_get_iset (iset_list_t list, int index);
+// Whether the current set of a list is not loaded yet.  The lookups
+// find no instrument in the meantime.
+extern int iset_list_is_pending (iset_list_t list);
+// Choose a set in the list (each set has an index)
+extern void iset_list_set_current_iset_index (iset_list_t list, int n);
+// Get an instrument from the current set
+extern instrument_t iset_list_get_instrument (iset_list_t list, float x, float y, float z);
+extern int iset_list_update_presence (iset_list_t list, iset_presence_t presence,
+                                      const struct iset_hysteresis_s* hysteresis,
+                                      float x, float y, float z, uint64_t time,
+                                      iset_hit_t hit);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
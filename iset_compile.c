@@ -0,0 +1,72 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// iset_compile - compiles a list of instrument sets.
+//
+//   iset_compile SetList.txt SetList.fobsets
+//
+// Reads the list and its set description files and writes them, with
+// their spatial index, in one file that fobd and the GUI map as it is
+// when given instead of the list (see iset_list_compile).  The file
+// only suits machines of the same architecture and versions of FoB
+// with the same structures; the others read it as an empty list.
+//
+// Build: cc -std=gnu99 -O2 -o iset_compile iset_compile.c iset.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+
+#include "iset.h"
+
+int main (int argc, char** argv) {
+  if (argc != 3) {
+    fprintf (stderr, "Usage: %s set-list compiled-set-list\n", argv[0]);
+    return 1;
+  }
+
+  char* path = strdup (argv[1]);
+  char* name = strdup (argv[1]);
+  iset_list_t list = iset_list_make (basename (name), dirname (path));
+  free (path);
+  free (name);
+  if (list == NULL || list->number_of_sets == 0) {
+    fprintf (stderr, "Can't find instrument sets in %s\n", argv[1]);
+    iset_list_free (list);
+    return 1;
+  }
+
+  int instruments = 0;
+  for (int i = 0; i < list->number_of_sets; i++) {
+    if (list->isets[i]->number_of_instruments == 0)
+      fprintf (stderr, "Warning: no instrument in %s\n",
+               list->isets[i]->filename);
+    instruments += list->isets[i]->number_of_instruments;
+  }
+
+  if (iset_list_compile (list, argv[2]) == -1) {
+    fprintf (stderr, "Can't write %s\n", argv[2]);
+    iset_list_free (list);
+    return 1;
+  }
+
+  printf ("%d sets, %d instruments, %lu bytes\n", list->number_of_sets,
+          instruments, (unsigned long) list->size);
+  iset_list_free (list);
+  return 0;
+}
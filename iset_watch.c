@@ -0,0 +1,528 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "iset_watch.h"
+#include "realtime.h"
+
+#define WATCH_PERIOD_MS 100 // Between the checks of the thread
+// Time the files must be left alone before they are read, for the
+// editors writing them in several steps
+#define WATCH_SETTLE_NS 200000000ULL
+#define GRACE_POLL_NS 1000000 // Between the looks at the reader
+#define UPLOAD_RESULTS 64 // Uploads whose result is kept
+#define UPLOAD_NAME "upload" // Of the lists uploaded
+
+// A file of the current list
+struct watched_s {
+  char* path;
+  char* name; // Last component
+  int wd; // inotify watch of its directory
+  // Without inotify
+  time_t mtime;
+  off_t size;
+  ino_t ino;
+};
+
+// Sets or list given by iset_watch_upload
+struct upload_s {
+  struct upload_s* next;
+  unsigned long ticket;
+  int index; // Of the set, -1 for a list
+  char* data;
+  size_t size;
+};
+
+// Result of an upload, for the reader
+struct upload_result_s {
+  unsigned long ticket; // Written last
+  unsigned long epoch; // Of the list with it, 0 if rejected
+};
+
+struct iset_watch_s {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  int stop;
+
+  // Last iset_watch_set_file, under the mutex
+  char* filename;
+  char* directory;
+  unsigned long requested;
+  struct upload_s* uploads; // Waiting, in order
+  unsigned long tickets; // Given
+
+  // Published by the thread
+  iset_list_t list;
+  unsigned long epoch; // Number of lists published
+  unsigned long loaded; // Request of the list
+
+  // Of the thread using the lists
+  iset_list_t reader_list;
+  unsigned long reader_epoch; // When it last got a list
+
+  // Of the thread of the watch
+  struct watched_s* files;
+  int number_of_files;
+  int inotify; // -1 without
+  iset_list_t retired; // Left to iset_watch_free
+  // Uploaded list replacing that of the file, and sets uploaded in
+  // place of those of the list, the last first.  Kept over the
+  // reloads until another list is chosen.
+  struct upload_s* uploaded_list;
+  struct upload_s* uploaded_sets;
+
+  struct upload_result_s results[UPLOAD_RESULTS];
+};
+
+static void sleep_ns (long ns) {
+  struct timespec ts = { 0, ns };
+  nanosleep (&ts, NULL);
+}
+
+//_____________FILES__________________________________________//
+
+static void watch_forget_files (iset_watch_t watch) {
+  for (int i = 0; i < watch->number_of_files; i++) {
+    free (watch->files[i].path);
+    free (watch->files[i].name);
+  }
+  free (watch->files);
+  watch->files = NULL;
+  watch->number_of_files = 0;
+
+#ifdef __linux__
+  if (watch->inotify != -1)
+    close (watch->inotify);
+  watch->inotify = -1;
+#endif
+}
+
+// Whether a file changed since the last look, without inotify
+static int watched_changed (struct watched_s* file) {
+  struct stat st;
+  if (stat (file->path, &st) == -1)
+    memset (&st, 0, sizeof (st));
+
+  int changed = st.st_mtime != file->mtime || st.st_size != file->size ||
+    st.st_ino != file->ino;
+  file->mtime = st.st_mtime;
+  file->size = st.st_size;
+  file->ino = st.st_ino;
+  return changed;
+}
+
+static void watch_add_file (iset_watch_t watch, const char* path) {
+  watch->files = realloc
+    (watch->files, (watch->number_of_files + 1) * sizeof (*watch->files));
+  struct watched_s* file = &watch->files[watch->number_of_files++];
+  memset (file, 0, sizeof (*file));
+  file->path = strdup (path);
+  file->wd = -1;
+  watched_changed (file);
+
+  char* copy = strdup (path);
+  file->name = strdup (basename (copy));
+  free (copy);
+
+#ifdef __linux__
+  // The directory, for the files replaced by a rename
+  if (watch->inotify != -1) {
+    copy = strdup (path);
+    file->wd = inotify_add_watch
+      (watch->inotify, dirname (copy),
+       IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+    free (copy);
+  }
+#endif
+}
+
+// Watches the list file and, unless it is compiled, its set files (the
+// list is opened lazily)
+static void watch_files (iset_watch_t watch, iset_list_t list,
+                         const char* filename, const char* directory) {
+  watch_forget_files (watch);
+#ifdef __linux__
+  watch->inotify = inotify_init ();
+#endif
+
+  char* path = malloc (strlen (directory) + 1 + strlen (filename) + 1);
+  sprintf (path, "%s/%s", directory, filename);
+  watch_add_file (watch, path);
+  free (path);
+
+  for (int i = 0; list->set_filenames && i < list->number_of_sets; i++) {
+    if (list->set_filenames[i] == NULL)
+      continue;
+    path = malloc (strlen (list->directory) + 1 +
+                   strlen (list->set_filenames[i]) + 1);
+    sprintf (path, "%s/%s", list->directory, list->set_filenames[i]);
+    watch_add_file (watch, path);
+    free (path);
+  }
+}
+
+// Waits up to WATCH_PERIOD_MS for a change of the files.  Returns 1
+// if there was one.
+static int watch_wait_change (iset_watch_t watch) {
+  int changed = 0;
+
+#ifdef __linux__
+  if (watch->inotify != -1) {
+    struct pollfd pfd = { watch->inotify, POLLIN, 0 };
+    if (poll (&pfd, 1, WATCH_PERIOD_MS) <= 0)
+      return 0;
+
+    char buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    ssize_t length = read (watch->inotify, buf, sizeof (buf));
+    for (char* p = buf; length > 0 && p < buf + length;) {
+      struct inotify_event* event = (struct inotify_event*) p;
+      for (int i = 0; i < watch->number_of_files; i++)
+        if (event->len > 0 && event->wd == watch->files[i].wd &&
+            strcmp (event->name, watch->files[i].name) == 0)
+          changed = 1;
+      p += sizeof (*event) + event->len;
+    }
+    return changed;
+  }
+#endif
+
+  sleep_ns (WATCH_PERIOD_MS * 1000000L);
+  for (int i = 0; i < watch->number_of_files; i++)
+    changed |= watched_changed (&watch->files[i]);
+  return changed;
+}
+
+//_____________PUBLICATION____________________________________//
+
+// Makes a list the current one, then frees the one it replaces once
+// the reader got the new one.  Returns the epoch of the list.
+static unsigned long watch_publish (iset_watch_t watch, iset_list_t list,
+                                    unsigned long request) {
+  iset_list_t old = __atomic_exchange_n (&watch->list, list, __ATOMIC_ACQ_REL);
+  __atomic_store_n (&watch->loaded, request, __ATOMIC_RELEASE);
+  unsigned long epoch = __atomic_add_fetch (&watch->epoch, 1, __ATOMIC_ACQ_REL);
+  if (old == NULL)
+    return epoch;
+
+  while (__atomic_load_n (&watch->reader_epoch, __ATOMIC_ACQUIRE) < epoch) {
+    if (__atomic_load_n (&watch->stop, __ATOMIC_ACQUIRE)) {
+      watch->retired = old;
+      return epoch;
+    }
+    sleep_ns (GRACE_POLL_NS);
+  }
+  iset_list_free (old);
+  return epoch;
+}
+
+static void uploads_free (struct upload_s* upload) {
+  while (upload) {
+    struct upload_s* next = upload->next;
+    free (upload->data);
+    free (upload);
+    upload = next;
+  }
+}
+
+// Opens the list of the file, or the one uploaded, with the sets
+// uploaded in place of theirs
+static iset_list_t watch_open (iset_watch_t watch,
+                               const char* filename, const char* directory) {
+  iset_list_t list;
+  if (watch->uploaded_list)
+    list = iset_list_read (UPLOAD_NAME, watch->uploaded_list->data,
+                           watch->uploaded_list->size);
+  else
+    list = iset_list_open (filename, directory);
+
+  // One upload by set, valid when it came; a set the list lost is
+  // left out
+  for (struct upload_s* upload = watch->uploaded_sets;
+       list && upload; upload = upload->next)
+    iset_list_read_iset (list, upload->index, upload->data, upload->size);
+  return list;
+}
+
+// Publishes a list opened by watch_open, its current set loaded first,
+// with the current set of the list it replaces if 'keep'.  Returns the
+// epoch of the list.
+static unsigned long watch_start (iset_watch_t watch, iset_list_t list,
+                                  unsigned long request, int keep) {
+  if (keep && watch->list)
+    iset_list_set_current_iset_index
+      (list, __atomic_load_n (&watch->list->current_iset_index,
+                              __ATOMIC_RELAXED));
+  iset_list_load_next (list);
+  return watch_publish (watch, list, request);
+}
+
+// Loads a list.  A reload that finds no set keeps the current list.
+static void watch_load (iset_watch_t watch,
+                        const char* filename, const char* directory,
+                        unsigned long request, int reload) {
+  iset_list_t list = watch_open (watch, filename, directory);
+  if (list == NULL) {
+    if (!reload)
+      __atomic_store_n (&watch->loaded, request, __ATOMIC_RELEASE);
+    return;
+  }
+
+  if (reload && list->number_of_sets == 0) {
+    fprintf (stderr, "Can't reload %s/%s, the sets are kept\n",
+             directory, filename);
+    iset_list_free (list);
+    return;
+  }
+
+  // The others after the publication
+  watch_files (watch, list, filename, directory);
+  watch_start (watch, list, request, reload);
+  if (reload)
+    fprintf (stderr, "Reloaded %s/%s\n", directory, filename);
+}
+
+static void watch_result (iset_watch_t watch, unsigned long ticket,
+                          unsigned long epoch) {
+  struct upload_result_s* result = &watch->results[ticket % UPLOAD_RESULTS];
+  __atomic_store_n (&result->epoch, epoch, __ATOMIC_RELAXED);
+  __atomic_store_n (&result->ticket, ticket, __ATOMIC_RELEASE);
+}
+
+// Builds and publishes the list with an upload, or drops it if it is
+// not valid
+static void watch_upload (iset_watch_t watch, struct upload_s* upload,
+                          const char* filename, const char* directory,
+                          unsigned long request) {
+  iset_list_t list = NULL;
+  if (upload->index == -1)
+    list = iset_list_read (UPLOAD_NAME, upload->data, upload->size);
+  else if (watch->list != NULL &&
+           (list = watch_open (watch, filename, directory)) != NULL &&
+           iset_list_read_iset (list, upload->index,
+                                upload->data, upload->size) == -1) {
+    iset_list_free (list);
+    list = NULL;
+  }
+
+  if (list == NULL) {
+    fprintf (stderr, "Uploaded %s rejected\n",
+             upload->index == -1 ? "list" : "set");
+    watch_result (watch, upload->ticket, 0);
+    uploads_free (upload);
+    return;
+  }
+
+  if (upload->index == -1) {
+    // In place of the file until another list is chosen
+    uploads_free (watch->uploaded_list);
+    uploads_free (watch->uploaded_sets);
+    watch->uploaded_list = upload;
+    watch->uploaded_sets = NULL;
+    watch_forget_files (watch);
+  }
+  else {
+    // Replaces the previous upload of the set
+    for (struct upload_s** p = &watch->uploaded_sets; *p; p = &(*p)->next)
+      if ((*p)->index == upload->index) {
+        struct upload_s* previous = *p;
+        *p = previous->next;
+        previous->next = NULL;
+        uploads_free (previous);
+        break;
+      }
+    upload->next = watch->uploaded_sets;
+    watch->uploaded_sets = upload;
+  }
+
+  watch_result (watch, upload->ticket, watch_start (watch, list, request, 1));
+}
+
+static void* watch_main (void* arg) {
+  iset_watch_t watch = arg;
+  char* filename = NULL, *directory = NULL;
+  unsigned long request = 0;
+  uint64_t changed = 0; // Time of the last change, 0 if none
+
+  pthread_mutex_lock (&watch->mutex);
+  while (!__atomic_load_n (&watch->stop, __ATOMIC_ACQUIRE)) {
+    if (watch->requested != request) {
+      free (filename);
+      free (directory);
+      filename = strdup (watch->filename);
+      directory = strdup (watch->directory);
+      request = watch->requested;
+      pthread_mutex_unlock (&watch->mutex);
+
+      // The uploads were for the previous list
+      uploads_free (watch->uploaded_list);
+      uploads_free (watch->uploaded_sets);
+      watch->uploaded_list = watch->uploaded_sets = NULL;
+      watch_load (watch, filename, directory, request, 0);
+      changed = 0;
+      pthread_mutex_lock (&watch->mutex);
+      continue;
+    }
+
+    if (watch->uploads) {
+      struct upload_s* upload = watch->uploads;
+      watch->uploads = upload->next;
+      upload->next = NULL;
+      pthread_mutex_unlock (&watch->mutex);
+
+      watch_upload (watch, upload, filename, directory, request);
+      pthread_mutex_lock (&watch->mutex);
+      continue;
+    }
+    pthread_mutex_unlock (&watch->mutex);
+
+    // The sets not loaded yet, one at a time to see the requests
+    if (watch->list && iset_list_load_next (watch->list) != -1) {
+      pthread_mutex_lock (&watch->mutex);
+      continue;
+    }
+
+    if (watch_wait_change (watch))
+      changed = realtime_now ();
+    else if (changed && realtime_now () - changed >= WATCH_SETTLE_NS) {
+      watch_load (watch, filename, directory, request, 1);
+      changed = 0;
+    }
+
+    pthread_mutex_lock (&watch->mutex);
+  }
+  pthread_mutex_unlock (&watch->mutex);
+
+  free (filename);
+  free (directory);
+  return NULL;
+}
+
+//_____________INTERFACE______________________________________//
+
+iset_watch_t iset_watch_new (void) {
+  iset_watch_t watch = calloc (1, sizeof (*watch));
+  watch->inotify = -1;
+  pthread_mutex_init (&watch->mutex, NULL);
+
+  if (pthread_create (&watch->thread, NULL, watch_main, watch) != 0) {
+    pthread_mutex_destroy (&watch->mutex);
+    free (watch);
+    return NULL;
+  }
+  return watch;
+}
+
+void iset_watch_free (iset_watch_t watch) {
+  if (watch == NULL) return;
+
+  __atomic_store_n (&watch->stop, 1, __ATOMIC_RELEASE);
+  pthread_join (watch->thread, NULL);
+  pthread_mutex_destroy (&watch->mutex);
+
+  watch_forget_files (watch);
+  uploads_free (watch->uploads);
+  uploads_free (watch->uploaded_list);
+  uploads_free (watch->uploaded_sets);
+  iset_list_free (watch->list);
+  iset_list_free (watch->retired);
+  free (watch->filename);
+  free (watch->directory);
+  free (watch);
+}
+
+void iset_watch_set_file (iset_watch_t watch,
+                          const char* filename,
+                          const char* directory) {
+  pthread_mutex_lock (&watch->mutex);
+  free (watch->filename);
+  free (watch->directory);
+  watch->filename = strdup (filename);
+  watch->directory = strdup (directory);
+  watch->requested++;
+  pthread_mutex_unlock (&watch->mutex);
+}
+
+iset_list_t iset_watch_get_list (iset_watch_t watch) {
+  // The epoch first: once the thread sees it, the list read after it
+  // is the one it published
+  unsigned long epoch = __atomic_load_n (&watch->epoch, __ATOMIC_ACQUIRE);
+  iset_list_t list = __atomic_load_n (&watch->list, __ATOMIC_ACQUIRE);
+  iset_list_t previous = watch->reader_list;
+
+  if (list != previous && list != NULL && previous != NULL &&
+      strcmp (list->filename, previous->filename) == 0)
+    iset_list_set_current_iset_index (list, previous->current_iset_index);
+
+  watch->reader_list = list;
+  __atomic_store_n (&watch->reader_epoch, epoch, __ATOMIC_RELEASE);
+  return list;
+}
+
+unsigned long iset_watch_upload (iset_watch_t watch, int index,
+                                 const void* data, size_t size) {
+  struct upload_s* upload = calloc (1, sizeof (*upload));
+  upload->index = index < 0 ? -1 : index;
+  upload->data = malloc (size ? size : 1);
+  memcpy (upload->data, data, size);
+  upload->size = size;
+
+  pthread_mutex_lock (&watch->mutex);
+  unsigned long ticket = upload->ticket = ++watch->tickets;
+  struct upload_s** last = &watch->uploads;
+  while (*last)
+    last = &(*last)->next;
+  *last = upload;
+  pthread_mutex_unlock (&watch->mutex);
+  return ticket;
+}
+
+int iset_watch_get_upload (iset_watch_t watch, unsigned long ticket) {
+  struct upload_result_s* result = &watch->results[ticket % UPLOAD_RESULTS];
+  if (__atomic_load_n (&result->ticket, __ATOMIC_ACQUIRE) != ticket)
+    return 0;
+
+  unsigned long epoch = __atomic_load_n (&result->epoch, __ATOMIC_RELAXED);
+  if (epoch == 0)
+    return -1;
+  return watch->reader_epoch >= epoch ? 1 : 0;
+}
+
+iset_list_t iset_watch_wait_list (iset_watch_t watch) {
+  pthread_mutex_lock (&watch->mutex);
+  unsigned long request = watch->requested;
+  pthread_mutex_unlock (&watch->mutex);
+
+  for (;;) {
+    int loaded = __atomic_load_n (&watch->loaded, __ATOMIC_ACQUIRE) >= request;
+    iset_list_t list = iset_watch_get_list (watch);
+    if (loaded)
+      return list;
+    sleep_ns (GRACE_POLL_NS);
+  }
+}
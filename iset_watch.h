@@ -0,0 +1,76 @@
+#ifndef __iset_watch_h__
+#define __iset_watch_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Lists of instrument sets loaded and reloaded while running.  A
+// thread of the watch loads the lists and reloads them when their
+// files change (inotify on Linux, the modification times elsewhere),
+// then publishes them with an atomic swap.  The thread processing the
+// records gets the current list once per loop; a list it dropped is
+// freed when it comes back for the next one, so it never waits and
+// never locks.  The sets and lists uploaded over OSC are built and
+// published by the same thread.
+
+#include "iset.h"
+
+typedef struct iset_watch_s* iset_watch_t;
+
+// Starts the thread, without list
+extern iset_watch_t iset_watch_new (void);
+// Once the thread using the lists is done with them
+extern void iset_watch_free (iset_watch_t watch);
+
+// Has the thread load a list and watch its files.  The list is
+// published as soon as its current set is loaded; the thread loads the
+// others after it (see iset_list_open), a set chosen while they load
+// first.  May be called from any thread.
+extern void iset_watch_set_file (iset_watch_t watch,
+                                 const char* filename,
+                                 const char* directory);
+
+// For the one thread using the lists, once per loop: the current list,
+// NULL before the first one is loaded.  The lists it got before must
+// not be used anymore.  A reloaded list keeps the current set of the
+// one it replaces.
+extern iset_list_t iset_watch_get_list (iset_watch_t watch);
+// Same, once the list of the last iset_watch_set_file is published
+extern iset_list_t iset_watch_wait_list (iset_watch_t watch);
+
+// Has the thread publish a list with a set uploaded in place of set
+// 'index' of the current list, its description given as in a set
+// file, or with index -1 a list uploaded in place of the current one,
+// its sets given one after the other (see iset_list_read).  They are
+// checked by the thread, which drops them if they are not valid, and
+// kept over the reloads until another list is chosen.  The data is
+// copied.  Returns a ticket for iset_watch_get_upload.  May be called
+// from any thread.
+extern unsigned long iset_watch_upload (iset_watch_t watch, int index,
+                                        const void* data, size_t size);
+// For the thread using the lists, after iset_watch_get_list: 1 once the
+// list it got has the upload of a ticket, -1 if it was dropped, 0
+// meanwhile.  Only the last uploads are remembered.
+extern int iset_watch_get_upload (iset_watch_t watch, unsigned long ticket);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
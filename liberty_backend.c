@@ -0,0 +1,87 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdlib.h>
+
+#include "liberty_hl.h"
+#include "tracker_backend.h"
+
+static void* liberty_backend_make () {
+  return liberty_new ();
+}
+
+static void liberty_backend_free (void* handle) {
+  liberty_free ((liberty_t) handle);
+}
+
+static int liberty_backend_open (void* handle, const char* file) {
+  return liberty_open ((liberty_t) handle, file);
+}
+
+static void liberty_backend_close (void* handle) {
+  liberty_close ((liberty_t) handle);
+}
+
+static int liberty_backend_get_file_descriptor (void* handle) {
+  return liberty_get_file_descriptor ((liberty_t) handle);
+}
+
+static int liberty_backend_get_number_of_birds (void* handle) {
+  return NUMBER_OF_BIRDS;
+}
+
+static int liberty_backend_read_next_record (void* handle) {
+  // A record that can't be synchronized in time is not an error, the
+  // previous one is kept.
+  liberty_read_next_record ((liberty_t) handle);
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static void liberty_backend_fill_bird_record (void* handle, int bird, bird_record_t record) {
+  liberty_fill_bird_record ((liberty_t) handle, bird, record);
+}
+
+static void liberty_backend_get_stats (void* handle, tracker_stats_t stats) {
+  struct liberty_stats_s s;
+  liberty_get_stats ((liberty_t) handle, &s);
+  stats->records = s.records;
+  stats->errors = s.errorIndicators;
+  stats->resyncs = s.stationNumberErrors + s.sizeErrors;
+  stats->dropped = 0;
+}
+
+static void liberty_backend_set_tap (void* handle, tracker_tap_t tap, void* data) {
+  liberty_set_tap ((liberty_t) handle, tap, data);
+}
+
+struct tracker_backend_s liberty_backend = {
+  "liberty",
+  "Polhemus Liberty",
+  TRACKER_FLAG_CENTIMETERS | TRACKER_FLAG_NO_FILE,
+  liberty_backend_make,
+  liberty_backend_free,
+  liberty_backend_open,
+  liberty_backend_close,
+  liberty_backend_get_file_descriptor,
+  liberty_backend_get_number_of_birds,
+  liberty_backend_read_next_record,
+  liberty_backend_fill_bird_record,
+  liberty_backend_get_stats,
+  liberty_error_to_string,
+  liberty_backend_set_tap,
+  NULL
+};
@@ -57,6 +57,7 @@ struct liberty_s {
   struct bird_record_s bird_records[NUMBER_OF_BIRDS];
   int sync;
 
+  unsigned long records;
   unsigned long syncs;
   unsigned long tagSuccesses;
   unsigned long stationNumberErrors;
@@ -67,6 +68,12 @@ struct liberty_s {
 
   fill_bird_record_t fill_bird_record;
 
+  liberty_tap_t tap;
+  void* tap_data;
+
+  // Opened with liberty_open_fd.
+  int attached;
+
   // For USB.
   PiTracker* tracker;
   int usb_transfer;
@@ -192,6 +199,7 @@ static void liberty_init (liberty_t liberty) {
   liberty->fd = -1;
   liberty->sockfd = -1;
   liberty->usb_transfer = 0;
+  liberty->attached = 0;
 
   FD_ZERO (&liberty->input_fd_set);
   memset (liberty->buf, 0, sizeof (liberty->buf));
@@ -206,6 +214,7 @@ static void liberty_init (liberty_t liberty) {
   memset (liberty->errorIndicatorCounts, 0, sizeof (liberty->errorIndicatorCounts));
   liberty->sizeErrors = 0;
   liberty->syncs = 0;
+  liberty->records = 0;
 
   long one = 1;
   int big_endian = !(*((char*) &one));
@@ -418,6 +427,20 @@ int liberty_open (liberty_t liberty, const char* file) {
   return LIBERTY_ERROR_NO_ERROR;
 }
 
+int liberty_open_fd (liberty_t liberty, int fd) {
+  liberty_close (liberty);
+
+  liberty->fd = fd;
+  liberty->attached = 1;
+  FD_SET (liberty->fd, &liberty->input_fd_set);
+  return LIBERTY_ERROR_NO_ERROR;
+}
+
+void liberty_set_tap (liberty_t liberty, liberty_tap_t tap, void* data) {
+  liberty->tap = tap;
+  liberty->tap_data = data;
+}
+
 static char* liberty_error_string (int error) {
   char* result = "unknown error";
 
@@ -505,6 +528,9 @@ void liberty_close (liberty_t liberty) {
     delete liberty->tracker;
     liberty->tracker = 0;
   }
+  else if (liberty->attached) {
+    close (liberty->fd);
+  }
   else {
     tcflush (liberty->fd, TCIOFLUSH);
     tcsetattr (liberty->fd, TCSANOW, &liberty->initialAtt);
@@ -602,7 +628,7 @@ static void liberty_unsync (liberty_t liberty) {
   liberty->sync = 0;
 }
 
-void liberty_read_next_record (liberty_t liberty) {
+int liberty_read_next_record (liberty_t liberty) {
   liberty_unsync (liberty);
   int tries = 0;
 
@@ -612,12 +638,14 @@ void liberty_read_next_record (liberty_t liberty) {
     struct timeval tv = { 0, 1000 };
 
     int sel = select (liberty->fd + 1, &read_fd_set, 0, 0, &tv);
-    if (sel == -1) return;
-    if (tries++ > 20) return;
+    if (sel == -1) return 0;
+    if (tries++ > 20) return 0;
     if (sel == 0) continue;
 
     int len = read (liberty->fd, buf, sizeof (buf));
-    if (len <= 0) return;
+    if (len <= 0) return 0;
+
+    if (liberty->tap) liberty->tap (liberty->tap_data, buf, len);
 
     /*
     static int ndisplays = 0;
@@ -630,9 +658,37 @@ void liberty_read_next_record (liberty_t liberty) {
     liberty_push (liberty, buf, len);
   }
 
+  liberty->records++;
+  return 1;
 }
 
 void liberty_fill_bird_record (liberty_t liberty, int bird, bird_record_t record) {
   *record = liberty->bird_records[bird - 1];
 }
 
+void liberty_get_stats (liberty_t liberty, liberty_stats_t stats) {
+  stats->records = liberty->records;
+  stats->syncs = liberty->syncs;
+  stats->tagSuccesses = liberty->tagSuccesses;
+  stats->stationNumberErrors = liberty->stationNumberErrors;
+  stats->errorIndicators = liberty->errorIndicators;
+  stats->sizeErrors = liberty->sizeErrors;
+}
+
+const char* liberty_error_to_string (int err) {
+  switch (err) {
+  case LIBERTY_ERROR_NO_ERROR:
+    return "Liberty error: no error";
+  case LIBERTY_ERROR_OPEN_DEVICE:
+    return "Liberty error: can't open device";
+  case LIBERTY_ERROR_READ_DEVICE:
+    return "Liberty error: can't read device";
+  case LIBERTY_ERROR_GET_TERMINAL_ATTRIBUTES:
+    return "Liberty error: can't get terminal attributes";
+  case LIBERTY_ERROR_SET_TERMINAL_ATTRIBUTES:
+    return "Liberty error: can't set terminal attributes";
+  }
+
+  return "Liberty error: unknown error";
+}
+
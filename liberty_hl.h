@@ -21,10 +21,23 @@ extern "C" {
    along with this program; if not, write to the Free Software
    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
 
+#include <stddef.h>
+
 #include "bird_record.h"
 
 typedef struct liberty_s* liberty_t;
 
+// Counters gathered while parsing the stream coming from the device.
+typedef struct liberty_stats_s* liberty_stats_t;
+struct liberty_stats_s {
+  unsigned long records;
+  unsigned long syncs;
+  unsigned long tagSuccesses;
+  unsigned long stationNumberErrors;
+  unsigned long errorIndicators;
+  unsigned long sizeErrors;
+};
+
 enum liberty_error_e {
   LIBERTY_ERROR_NO_ERROR = 0,
   LIBERTY_ERROR_OPEN_DEVICE,
@@ -40,8 +53,19 @@ extern void liberty_free (liberty_t liberty);
 extern int liberty_open (liberty_t liberty, const char* file);
 extern void liberty_close (liberty_t liberty);
 extern int liberty_get_file_descriptor (liberty_t liberty);
-extern void liberty_read_next_record (liberty_t liberty);
+extern int liberty_read_next_record (liberty_t liberty);
 extern void liberty_fill_bird_record (liberty_t liberty, int bird, bird_record_t record);
+extern void liberty_get_stats (liberty_t liberty, liberty_stats_t stats);
+
+// Reads the records from an already open descriptor (a replayed
+// recording for instance) instead of a device.  The Liberty is assumed
+// to be configured and in continuous mode; nothing is written.
+extern int liberty_open_fd (liberty_t liberty, int fd);
+
+// Function called with every block of bytes read from the device
+typedef void (*liberty_tap_t) (void* data, const void* buf, size_t len);
+extern void liberty_set_tap (liberty_t liberty, liberty_tap_t tap, void* data);
+extern const char* liberty_error_to_string (int error);
 
 #ifdef __cplusplus
 }
@@ -59,7 +59,6 @@ flock_open (const char * filename, int flags, int birds)
   flock_t flock;
   int fd;
   struct termios oldtio, newtio;
-  int i;
 
   if (!init)
     flock_init ();
@@ -133,6 +132,22 @@ flock_open (const char * filename, int flags, int birds)
       */
     }
 
+  flock = flock_open_fd (fd, birds);
+  flock->oldtio = oldtio;
+  flock->newtio = newtio;
+
+  return flock;
+}
+
+flock_t
+flock_open_fd (int fd, int birds)
+{
+  flock_t flock;
+  int i;
+
+  if (!init)
+    flock_init ();
+
   flock = (flock_t) malloc (sizeof (struct flock_s));
   assert (flock);
 
@@ -145,8 +160,7 @@ flock_open (const char * filename, int flags, int birds)
     flock->birds[i] = flock_bird_make (flock, i + 1);
 
   flock->fd = fd;
-  flock->oldtio = oldtio;
-  flock->newtio = newtio;
+  flock->tty = isatty (fd);
 
   flock->expected_size = 0;
   flock->allocated = MAX_RESPONSE_SIZE;
@@ -170,12 +184,24 @@ flock_open (const char * filename, int flags, int birds)
   flock->group_bytes = 0;
   flock->stream = 0;
 
+  flock->tap = NULL;
+  flock->tap_data = NULL;
+
   /* FIXME: verify the number of birds and their status.
      (Higher-level function?) */
 
   return flock;
 }
 
+void
+flock_set_tap (flock_t flock, flock_tap_t tap, void * data)
+{
+  assert (flock);
+
+  flock->tap = tap;
+  flock->tap_data = data;
+}
+
 void
 flock_close (flock_t flock)
 {
@@ -192,6 +218,9 @@ flock_close (flock_t flock)
   for (i = 0; i < flock->nbirds; i++)
     flock_bird_free (flock->birds[i]);
 
+  free (flock->birds);
+  free (flock->bird_records);
+  free (flock->data);
   free (flock);
 }
 
@@ -331,13 +360,16 @@ flock_read (flock_t flock, int expected_size)
   received = read (flock->fd, (void *) (flock->data + flock->stored),
                    flock->allocated - flock->stored);
 
-  if (received == -1)
+  if (received == -1 || (received == 0 && !flock->tty))
     {
-      /* Something went wrong. */
+      /* Something went wrong, or there is nothing more to read. */
       flock->error = FLOCK_SYSTEM_CALL_ERROR;
       return NULL;
     }
 
+  if (flock->tap && received > 0)
+    flock->tap (flock->tap_data, flock->data + flock->stored, received);
+
   flock->stored += received;
 
   /* Testing again if we have enough bytes for the caller. */
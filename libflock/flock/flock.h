@@ -20,6 +20,8 @@
 #ifndef __FLOCK_H__
 #define __FLOCK_H__
 
+#include <stddef.h>
+
 #include <flock/flock_command.h>
 
 /* Should be called first before calling other functions in the
@@ -39,6 +41,20 @@ typedef struct flock_s * flock_t;
    argument is the number of birds (individual units) in the flock. */
 extern flock_t flock_open (const char * filename, int flags, int birds);
 
+/* Allocates a flock handler around a descriptor that is already
+   open, such as a pipe or a socket delivering recorded data.  The
+   serial settings are left alone.  The descriptor is closed with the
+   handler. */
+extern flock_t flock_open_fd (int fd, int birds);
+
+/* Function called with every block of bytes read from the flock, for
+   instance to record them. */
+typedef void (* flock_tap_t) (void * data, const void * buf, size_t size);
+
+/* Sets the function called by 'flock_read' with the bytes it gets
+   from the device ('tap' is NULL to remove it). */
+extern void flock_set_tap (flock_t flock, flock_tap_t tap, void * data);
+
 /* Deletes a flock handler from memory.  Closes the related file. */
 extern void flock_close (flock_t flock);
 
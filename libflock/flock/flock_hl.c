@@ -119,6 +119,35 @@ flock_hl_open (char * device,
   return flock;
 }
 
+flock_t
+flock_hl_open_stream_fd (int fd,
+                         int number_of_birds,
+                         flock_bird_record_mode_t mode)
+{
+  flock_t flock;
+  int i;
+
+  if (flock_bird_record_mode_command (mode) == 0)
+    return NULL;
+
+  flock = flock_open_fd (fd, number_of_birds);
+
+  /* Same state as after the configuration commands. */
+  flock->group = 1;
+  flock->group_bytes = 0;
+  for (i = 0; i < flock->nbirds; i++)
+    {
+      flock->birds[i]->record_mode = mode;
+      flock->group_bytes += 1 +
+        flock_bird_record_mode_number_of_bytes (mode);
+    }
+  flock->stream = 1;
+  /* Sizes of the responses are given by 'flock_next_record'. */
+  flock->expected_size = -1;
+
+  return flock;
+}
+
 void
 flock_hl_close (flock_t flock)
 {
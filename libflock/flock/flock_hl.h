@@ -34,6 +34,14 @@ extern flock_t flock_hl_open (char * device,
 			      int group_mode,
 			      int stream_mode);
 
+/* Wraps a descriptor delivering the stream of a flock configured as
+   'flock_hl_open' does with group and stream modes, for instance a
+   recording being replayed.  Nothing is written to the descriptor.
+   Returns NULL on error.  Such a flock is closed with 'flock_close'. */
+extern flock_t flock_hl_open_stream_fd (int fd,
+					int number_of_birds,
+					flock_bird_record_mode_t mode);
+
 /* Closes a flock.  Stops eventual stream mode and checks the flock's
    status before closing the device and freeing the memory. */
 extern void flock_hl_close (flock_t flock);
@@ -39,6 +39,9 @@ struct flock_s {
 
   /* File descriptor. */
   int fd;
+  /* Whether the descriptor is a terminal.  On other descriptors, a
+     read returning nothing means the end of the data. */
+  int tty;
   /* Old serial device settings. */
   struct termios oldtio;
   /* New serial device settings. */
@@ -87,6 +90,10 @@ struct flock_s {
   /* Array of 'nbirds' structures to store last received bird's
      records. */
   struct flock_bird_record_s * bird_records;
+
+  /* Called with the bytes read from the device, if not NULL. */
+  flock_tap_t tap;
+  void * tap_data;
 };
 
 #endif
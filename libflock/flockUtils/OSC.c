@@ -20,12 +20,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <time.h>
 
 #include "OSC.h"
 
@@ -41,6 +43,8 @@ struct OSC_argtype_s {
   /* Returns the number of bytes that the OSC argument takes in the
      raw OSC packet. */
   int (* size) (const void * value);
+  /* Same, from the raw argument in a packet. */
+  int (* raw_size) (const void * raw);
   /* Writes the OSC argument as a raw sequence of bytes at a given
      location.  Converts from host order to network order. */
   void (* put) (const void * value, void * dest);
@@ -59,17 +63,19 @@ OSC_argtype_4bytes_size (const void * value)
 static void
 OSC_argtype_4bytes_put (const void * value, void * dest)
 {
-  *((unsigned long *) dest) = htonl (*((unsigned long *) value));
+  *((uint32_t *) dest) = htonl (*((uint32_t *) value));
 }
 
 
 static struct OSC_argtype_s OSC_argtype_int = {
-  'i', OSC_argtype_4bytes_size, OSC_argtype_4bytes_put
+  'i', OSC_argtype_4bytes_size, OSC_argtype_4bytes_size,
+  OSC_argtype_4bytes_put
 };
 
 
 static struct OSC_argtype_s OSC_argtype_float = {
-  'f', OSC_argtype_4bytes_size, OSC_argtype_4bytes_put
+  'f', OSC_argtype_4bytes_size, OSC_argtype_4bytes_size,
+  OSC_argtype_4bytes_put
 };
 
 
@@ -88,29 +94,54 @@ OSC_argtype_string_put (const void * value, void * dest)
 
 
 static struct OSC_argtype_s OSC_argtype_string = {
-  's', OSC_argtype_string_size, OSC_argtype_string_put
+  's', OSC_argtype_string_size, OSC_argtype_string_size,
+  OSC_argtype_string_put
 };
 
+/* A blob is its size, in network order in a raw packet, then its
+   bytes, padded to a multiple of 4 with zeros.  The blob given to
+   OSC_message_make starts with its size in host order. */
+#define OSC_BLOB_MAX_SIZE (1 << 30)
+
 static int
-OSC_argtype_blob_size (const void * value)
+OSC_argtype_blob_data_size (uint32_t size)
 {
-  int size;
+  /* Larger than any packet, without overflowing the position of the
+     parser. */
+  if (size > OSC_BLOB_MAX_SIZE)
+    size = OSC_BLOB_MAX_SIZE;
+  return sizeof (uint32_t) + (size + OSC_PADDING - 1) / OSC_PADDING * OSC_PADDING;
+}
 
-  size = sizeof (size) + *((int *) value);
-  size = ((size / OSC_PADDING) + 1) * OSC_PADDING;
-  return size;
+
+static int
+OSC_argtype_blob_raw_size (const void * raw)
+{
+  return OSC_argtype_blob_data_size (ntohl (*((uint32_t *) raw)));
+}
+
+
+static int
+OSC_argtype_blob_size (const void * value)
+{
+  return OSC_argtype_blob_data_size (*((uint32_t *) value));
 }
 
 
 static void
 OSC_argtype_blob_put (const void * value, void * dest)
 {
-  strncpy (dest, value, OSC_argtype_blob_size (value));
-  *((unsigned long *) dest) = htonl (*((unsigned long *) value));
+  uint32_t size = *((uint32_t *) value);
+  int padded = OSC_argtype_blob_size (value);
+
+  memset ((char *) dest + padded - OSC_PADDING, 0, OSC_PADDING);
+  memcpy ((char *) dest + sizeof (size), (char *) value + sizeof (size), size);
+  *((uint32_t *) dest) = htonl (size);
 }
 
 static struct OSC_argtype_s OSC_argtype_blob = {
-  'b', OSC_argtype_blob_size, OSC_argtype_blob_put
+  'b', OSC_argtype_blob_size, OSC_argtype_blob_raw_size,
+  OSC_argtype_blob_put
 };
 
 
@@ -230,24 +261,402 @@ OSC_message_packet (OSC_message_t m)
 }
 
 
+// OSC templates.
+
+int
+OSC_template_init (OSC_template_t t, const char * name, const char * typetag)
+{
+  int name_boundary = OSC_STRING_BOUNDARY (name);
+  int typetag_boundary = OSC_STRING_BOUNDARY (typetag);
+  int number_of_arguments = strlen (typetag) - 1;
+  const char * c;
+
+  t->size = 0;
+  if (typetag[0] != ',')
+    {
+      REPORT (fprintf (stderr, "Type tag does not start with a comma.\n"));
+      return -1;
+    }
+
+  for (c = typetag + 1; *c != '\0'; c++)
+    if (*c != 'i' && *c != 'f')
+      {
+        REPORT (fprintf (stderr, "Unhandled OSC template argument type: %c.\n",
+                         *c));
+        return -1;
+      }
+
+  if (name_boundary + typetag_boundary + 4 * number_of_arguments
+      > OSC_TEMPLATE_MAX_SIZE)
+    {
+      REPORT (fprintf (stderr, "OSC template too large: %s.\n", name));
+      return -1;
+    }
+
+  memset (t->buffer, 0, sizeof (t->buffer));
+  strcpy (t->buffer, name);
+  strcpy (t->buffer + name_boundary, typetag);
+  t->arguments = name_boundary + typetag_boundary;
+  t->size = t->arguments + 4 * number_of_arguments;
+  return 0;
+}
+
+
+// OSC time tags.
+
+/* Seconds from 1900 (NTP) to 1970 (Unix). */
+#define OSC_NTP_UNIX_OFFSET 2208988800ULL
+#define OSC_NS_PER_SECOND 1000000000ULL
+
+
+uint64_t
+OSC_time_tag_from_ns (uint64_t ns)
+{
+  uint64_t seconds = ns / OSC_NS_PER_SECOND;
+  uint64_t fraction = ((ns % OSC_NS_PER_SECOND) << 32) / OSC_NS_PER_SECOND;
+
+  return ((seconds + OSC_NTP_UNIX_OFFSET) << 32) | fraction;
+}
+
+
+uint64_t
+OSC_time_tag_to_ns (uint64_t time_tag)
+{
+  uint64_t seconds = (time_tag >> 32) - OSC_NTP_UNIX_OFFSET;
+  uint64_t fraction = time_tag & 0xffffffffULL;
+
+  return seconds * OSC_NS_PER_SECOND + ((fraction * OSC_NS_PER_SECOND) >> 32);
+}
+
+
+uint64_t
+OSC_time_tag_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  return OSC_time_tag_from_ns (ts.tv_sec * OSC_NS_PER_SECOND + ts.tv_nsec);
+}
+
+
 // OSC spaces and methods.
 
+/* Bundles kept until their time. */
+#define OSC_MAX_SCHEDULED 1024
+/* Address patterns whose methods are kept, a power of 2 */
+#define OSC_PATTERN_CACHE_SIZE 16
+
+/* Methods matching an address pattern received */
+struct OSC_pattern_s {
+  char * pattern; /* NULL if none */
+  uint32_t hash;
+  int * methods;
+  int nmethods;
+};
+
+struct OSC_scheduled_s {
+  uint64_t time_tag;
+  char * buffer;
+  int size;
+};
+
 struct OSC_space_s {
   OSC_method_t * methods;
   int allocated;
   int nmethods;
+  /* Hash table of the names of the methods: first method of every
+     bucket, and next method of the same bucket for every method (-1 at
+     the end). */
+  int * buckets;
+  int nbuckets; /* Power of 2, at least nmethods */
+  int * next;
+  /* By hash of the pattern, emptied when a method is registered */
+  struct OSC_pattern_s patterns[OSC_PATTERN_CACHE_SIZE];
+  /* By increasing time tag */
+  struct OSC_scheduled_s scheduled[OSC_MAX_SCHEDULED];
+  int nscheduled;
 };
 
 
 struct OSC_method_s {
   char * name;
+  uint32_t hash; /* Of the name */
   char * typetag;
   OSC_method_callback_t callback;
   void * callback_data;
 };
 
 
+/* Hash of an address (FNV-1a). */
+static uint32_t
+hash_name (const char * name)
+{
+  uint32_t hash = 2166136261U;
+
+  for (; *name != '\0'; name++)
+    hash = (hash ^ (unsigned char) *name) * 16777619U;
+  return hash;
+}
+
+
+/* Rebuilds the buckets of the hash table of the methods, for
+   nbuckets. */
+static void
+hash_methods (OSC_space_t space)
+{
+  int i;
+
+  space->buckets = (int *)
+    realloc (space->buckets, space->nbuckets * sizeof (*space->buckets));
+  assert (space->buckets);
+  for (i = 0; i < space->nbuckets; i++)
+    space->buckets[i] = -1;
+
+  for (i = 0; i < space->nmethods; i++)
+    {
+      int b = space->methods[i]->hash & (space->nbuckets - 1);
+
+      space->next[i] = space->buckets[b];
+      space->buckets[b] = i;
+    }
+}
+
+
+// OSC address patterns.
+
+/* An address pattern is compiled once per message into tokens, then
+   matched against the names of the methods. */
+#define OSC_MAX_PATTERN_TOKENS 64
+
+enum OSC_token_type_e {
+  OSC_TOKEN_LITERAL, /* Characters to find as they are */
+  OSC_TOKEN_ANY_CHAR, /* ? */
+  OSC_TOKEN_ANY_STRING, /* * */
+  OSC_TOKEN_SET, /* [abc], [a-z], [!abc] */
+  OSC_TOKEN_ALTERNATIVES /* {foo,bar} */
+};
+
+struct OSC_token_s {
+  enum OSC_token_type_e type;
+  const char * text; /* Literal, set without [!], alternatives */
+  int length;
+  int negated; /* Set */
+};
+
+
+/* Whether an address has pattern characters. */
+static inline int
+is_pattern (const char * address)
+{
+  return strpbrk (address, "*?[]{}") != NULL;
+}
+
+
+/* Returns the number of tokens, -1 if the pattern is not valid or
+   too long. */
+static int
+compile_pattern (const char * pattern, struct OSC_token_s * tokens)
+{
+  int n = 0;
+  const char * p = pattern;
+
+  while (*p != '\0')
+    {
+      struct OSC_token_s * t = &tokens[n];
+      const char * end;
+
+      if (n == OSC_MAX_PATTERN_TOKENS)
+        return -1;
+
+      switch (*p)
+        {
+        case '?':
+          t->type = OSC_TOKEN_ANY_CHAR;
+          p++;
+          break;
+
+        case '*':
+          /* "**" is "*" */
+          if (n > 0 && tokens[n - 1].type == OSC_TOKEN_ANY_STRING)
+            {
+              p++;
+              continue;
+            }
+          t->type = OSC_TOKEN_ANY_STRING;
+          p++;
+          break;
+
+        case '[':
+          t->type = OSC_TOKEN_SET;
+          t->negated = p[1] == '!';
+          t->text = p + 1 + t->negated;
+          if ((end = strchr (t->text, ']')) == NULL)
+            return -1;
+          t->length = end - t->text;
+          p = end + 1;
+          break;
+
+        case '{':
+          t->type = OSC_TOKEN_ALTERNATIVES;
+          t->text = p + 1;
+          if ((end = strchr (t->text, '}')) == NULL)
+            return -1;
+          t->length = end - t->text;
+          p = end + 1;
+          break;
+
+        case ']':
+        case '}':
+          return -1;
+
+        default:
+          t->type = OSC_TOKEN_LITERAL;
+          t->text = p;
+          t->length = strcspn (p, "*?[]{}");
+          p += t->length;
+          break;
+        }
+
+      n++;
+    }
+
+  return n;
+}
+
+
+/* Whether c is in the set of t. */
+static int
+set_contains (const struct OSC_token_s * t, char c)
+{
+  int i;
+
+  for (i = 0; i < t->length; i++)
+    {
+      if (i + 2 < t->length && t->text[i + 1] == '-')
+        {
+          if (c >= t->text[i] && c <= t->text[i + 2])
+            return !t->negated;
+          i += 2;
+        }
+      else if (c == t->text[i])
+        return !t->negated;
+    }
+
+  return t->negated;
+}
+
+
+/* Whether the name matches the tokens.  The wildcards don't match
+   '/'. */
+static int
+match_pattern (const struct OSC_token_s * t, int n, const char * name)
+{
+  for (; n > 0; t++, n--)
+    switch (t->type)
+      {
+      case OSC_TOKEN_LITERAL:
+        if (strncmp (name, t->text, t->length) != 0)
+          return 0;
+        name += t->length;
+        break;
+
+      case OSC_TOKEN_ANY_CHAR:
+        if (*name == '\0' || *name == '/')
+          return 0;
+        name++;
+        break;
+
+      case OSC_TOKEN_SET:
+        if (*name == '\0' || *name == '/' || !set_contains (t, *name))
+          return 0;
+        name++;
+        break;
+
+      case OSC_TOKEN_ANY_STRING:
+        for (;; name++)
+          {
+            if (match_pattern (t + 1, n - 1, name))
+              return 1;
+            if (*name == '\0' || *name == '/')
+              return 0;
+          }
+
+      case OSC_TOKEN_ALTERNATIVES:
+        {
+          const char * a = t->text;
+          const char * end = t->text + t->length;
+
+          while (a <= end)
+            {
+              const char * comma = memchr (a, ',', end - a);
+              int length = (comma ? comma : end) - a;
+
+              if (strncmp (name, a, length) == 0 &&
+                  match_pattern (t + 1, n - 1, name + length))
+                return 1;
+              a += length + 1;
+            }
+          return 0;
+        }
+      }
+
+  return *name == '\0';
+}
+
+
+static void
+clear_patterns (OSC_space_t space)
+{
+  int i;
+
+  for (i = 0; i < OSC_PATTERN_CACHE_SIZE; i++)
+    {
+      free (space->patterns[i].pattern);
+      free (space->patterns[i].methods);
+      space->patterns[i].pattern = NULL;
+      space->patterns[i].methods = NULL;
+    }
+}
+
+
+/* Methods matching an address pattern, from the cache or compiled and
+   kept.  NULL if the pattern is not valid. */
+static struct OSC_pattern_s *
+find_pattern (OSC_space_t space, const char * pattern)
+{
+  uint32_t hash = hash_name (pattern);
+  struct OSC_pattern_s * p =
+    &space->patterns[hash & (OSC_PATTERN_CACHE_SIZE - 1)];
+  struct OSC_token_s tokens[OSC_MAX_PATTERN_TOKENS];
+  int ntokens;
+  int i;
+
+  if (p->pattern != NULL && p->hash == hash && strcmp (p->pattern, pattern) == 0)
+    return p;
+
+  if ((ntokens = compile_pattern (pattern, tokens)) == -1)
+    return NULL;
+
+  free (p->pattern);
+  free (p->methods);
+  p->pattern = strdup (pattern);
+  assert (p->pattern);
+  p->hash = hash;
+  p->methods = (int *) malloc ((space->nmethods + 1) * sizeof (*p->methods));
+  assert (p->methods);
+  p->nmethods = 0;
+
+  for (i = 0; i < space->nmethods; i++)
+    if (match_pattern (tokens, ntokens, space->methods[i]->name))
+      p->methods[p->nmethods++] = i;
+
+  return p;
+}
+
+
 static int parse_bundle (OSC_space_t space, const char * buffer, int maxsize);
+static int schedule_bundle (OSC_space_t space, uint64_t time_tag,
+                            const char * buffer, int maxsize);
 static int parse_leaf (OSC_space_t space, const char * buffer, int maxsize);
 static int parse_args (OSC_space_t space, const char * buffer, int maxsize);
 
@@ -259,16 +668,37 @@ parse_bundle (OSC_space_t space, const char * buffer, int maxsize)
 
   assert (strcmp (buffer, "#bundle") == 0);
 
-  /* FIXME: interpret time tag. */
+  if (maxsize < 8 + 8)
+    {
+      REPORT (fprintf (stderr, "Incomplete OSC bundle.\n"));
+      return -1;
+    }
+
+  /* Keep the bundles of the future until their time. */
+  {
+    uint64_t time_tag =
+      ((uint64_t) ntohl (*((uint32_t *) (buffer + 8))) << 32) |
+      ntohl (*((uint32_t *) (buffer + 12)));
+
+    if (time_tag != OSC_TIME_TAG_IMMEDIATELY &&
+        time_tag > OSC_time_tag_now ())
+      return schedule_bundle (space, time_tag, buffer, maxsize);
+  }
+
   /* Skip message name and time tag. */
   pos = 8 + 8;
 
   while (pos + 4 < maxsize)
     {
-      unsigned long esize;
+      uint32_t esize;
 
       /* Get size of bundle element. */
-      esize = ntohl (*((unsigned long *) (buffer + pos)));
+      esize = ntohl (*((uint32_t *) (buffer + pos)));
+      if (esize > (uint32_t) (maxsize - pos - 4))
+        {
+          REPORT (fprintf (stderr, "Incomplete OSC bundle.\n"));
+          return -1;
+        }
 
       /* FIXME: doesn't really consider the simultaneity of messages
          in a bundle. */
@@ -290,6 +720,35 @@ parse_bundle (OSC_space_t space, const char * buffer, int maxsize)
 }
 
 
+static int
+schedule_bundle (OSC_space_t space, uint64_t time_tag,
+                 const char * buffer, int maxsize)
+{
+  int i;
+
+  if (space->nscheduled == OSC_MAX_SCHEDULED)
+    {
+      REPORT (fprintf (stderr, "Too many OSC bundles waiting, one dropped.\n"));
+      return -1;
+    }
+
+  /* After the bundles of the same time, received before. */
+  for (i = space->nscheduled;
+       i > 0 && space->scheduled[i - 1].time_tag > time_tag;
+       i--)
+    space->scheduled[i] = space->scheduled[i - 1];
+
+  space->scheduled[i].time_tag = time_tag;
+  space->scheduled[i].buffer = (char *) malloc (maxsize);
+  assert (space->scheduled[i].buffer);
+  memcpy (space->scheduled[i].buffer, buffer, maxsize);
+  space->scheduled[i].size = maxsize;
+  space->nscheduled++;
+
+  return 0;
+}
+
+
 static inline int
 parse_args (OSC_space_t space, const char * buffer, int maxsize)
 {
@@ -316,7 +775,7 @@ parse_args (OSC_space_t space, const char * buffer, int maxsize)
 
       /* FIXME: partially received strings may lead to parsing beyond
          (buffer + maxsize). */
-      pos += type->size (buffer + pos);
+      pos += type->raw_size (buffer + pos);
       i++;
     }
 
@@ -370,26 +829,57 @@ parse_leaf (OSC_space_t space, const char * buffer, int maxsize)
                   maxsize - name_boundary) == -1)
     return -1;
 
-  for (i = 0; i < space->nmethods; i++)
+  if (!is_pattern (buffer))
     {
-      /* FIXME: could be more efficient, for example with a hash
-         table. */
-      /* FIXME: manage regular expressions. */
-      /* Find method with appropriate type tag. */
-      if (strcmp (buffer, space->methods[i]->name) != 0)
-        continue;
+      /* Find method with appropriate name and type tag. */
+      uint32_t hash = hash_name (buffer);
 
-      if (strcmp (buffer + name_boundary, space->methods[i]->typetag) != 0)
-        continue;
+      for (i = space->buckets[hash & (space->nbuckets - 1)];
+           i != -1;
+           i = space->next[i])
+        {
+          OSC_method_t m = space->methods[i];
+
+          if (m->hash != hash || strcmp (buffer, m->name) != 0)
+            continue;
+
+          if (strcmp (buffer + name_boundary, m->typetag) != 0)
+            continue;
 
-      /* Everything seems ok.  Invoke the method. */
-      return space->methods[i]->callback
-        (buffer + name_boundary + typetag_boundary,
-         space->methods[i]->callback_data);
+          /* Everything seems ok.  Invoke the method. */
+          return m->callback (buffer + name_boundary + typetag_boundary,
+                              m->callback_data);
+        }
+
+      /* No method found for this message. */
+      return 0;
     }
 
-  /* No method found for this message. */
-  return 0;
+  /* Every method matching the pattern, with appropriate type tag. */
+  {
+    struct OSC_pattern_s * p = find_pattern (space, buffer);
+    int result = 0;
+
+    if (p == NULL)
+      {
+        REPORT (fprintf (stderr, "Bad OSC address pattern: %s.\n", buffer));
+        return -1;
+      }
+
+    for (i = 0; i < p->nmethods; i++)
+      {
+        OSC_method_t m = space->methods[p->methods[i]];
+
+        if (strcmp (buffer + name_boundary, m->typetag) != 0)
+          continue;
+
+        if (m->callback (buffer + name_boundary + typetag_boundary,
+                         m->callback_data) == -1)
+          result = -1;
+      }
+
+    return result;
+  }
 }
 
 
@@ -405,6 +895,13 @@ OSC_space_make (void)
     malloc (space->allocated * sizeof (*space->methods));
   assert (space->methods);
   space->nmethods = 0;
+  space->next = (int *) malloc (space->allocated * sizeof (*space->next));
+  assert (space->next);
+  space->buckets = NULL;
+  space->nbuckets = space->allocated;
+  hash_methods (space);
+  memset (space->patterns, 0, sizeof (space->patterns));
+  space->nscheduled = 0;
 
   return space;
 }
@@ -420,7 +917,13 @@ OSC_space_free (OSC_space_t space)
   for (i = 0; i < space->nmethods; i++)
     OSC_method_free (space->methods[i]);
 
+  for (i = 0; i < space->nscheduled; i++)
+    free (space->scheduled[i].buffer);
+
+  clear_patterns (space);
   free (space->methods);
+  free (space->buckets);
+  free (space->next);
   free (space);
 }
 
@@ -433,10 +936,10 @@ OSC_space_register_method (OSC_space_t space, OSC_method_t m)
   assert (space);
   assert (m);
 
-  for (i = 0; i < space->nmethods; i++)
+  for (i = space->buckets[m->hash & (space->nbuckets - 1)];
+       i != -1;
+       i = space->next[i])
     {
-      /* FIXME: could be more efficient, for example with a hash
-         table. */
       if (strcmp (m->name, space->methods[i]->name) != 0)
         continue;
 
@@ -454,9 +957,27 @@ OSC_space_register_method (OSC_space_t space, OSC_method_t m)
       space->methods = (OSC_method_t *)
         realloc (space->methods, space->allocated * sizeof (*space->methods));
       assert (space->methods);
+      space->next = (int *)
+        realloc (space->next, space->allocated * sizeof (*space->next));
+      assert (space->next);
     }
 
-  space->methods[space->nmethods++] = m;
+  i = space->nmethods++;
+  space->methods[i] = m;
+  clear_patterns (space);
+
+  if (space->nmethods > space->nbuckets)
+    {
+      space->nbuckets *= 2;
+      hash_methods (space);
+    }
+  else
+    {
+      int b = m->hash & (space->nbuckets - 1);
+
+      space->next[i] = space->buckets[b];
+      space->buckets[b] = i;
+    }
 }
 
 
@@ -488,6 +1009,37 @@ OSC_space_parse (OSC_space_t space, const char * buffer, int maxsize)
 }
 
 
+int
+OSC_space_dispatch (OSC_space_t space)
+{
+  uint64_t now = OSC_time_tag_now ();
+  int n = 0;
+
+  while (space->nscheduled > 0 && space->scheduled[0].time_tag <= now)
+    {
+      struct OSC_scheduled_s s = space->scheduled[0];
+
+      space->nscheduled--;
+      memmove (space->scheduled, space->scheduled + 1,
+               space->nscheduled * sizeof (*space->scheduled));
+
+      /* Its nested bundles of the future are kept in turn. */
+      OSC_space_parse (space, s.buffer, s.size);
+      free (s.buffer);
+      n++;
+    }
+
+  return n;
+}
+
+
+uint64_t
+OSC_space_next_time_tag (OSC_space_t space)
+{
+  return space->nscheduled > 0 ? space->scheduled[0].time_tag : 0;
+}
+
+
 OSC_method_t
 OSC_method_make (char * name,
                  char * typetag,
@@ -504,6 +1056,7 @@ OSC_method_make (char * name,
   m->name = (char *) malloc ((strlen (name) + 1) * sizeof (char));
   assert (m->name);
   strcpy (m->name, name);
+  m->hash = hash_name (name);
 
   m->typetag = (char *) malloc ((strlen (typetag) + 1) * sizeof (char));
   assert (m->typetag);
@@ -23,6 +23,9 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <string.h>
 
 /* Should be called before the other functions. */
 void OSC_init (void);
@@ -69,6 +72,58 @@ extern void OSC_message_free (OSC_message_t m);
 //extern const OSC_message_packet_t OSC_message_packet (OSC_message_t m);
 extern OSC_message_packet_t OSC_message_packet (OSC_message_t m);
 
+/* Concrete data type for OSC messages written once and sent many
+   times with other arguments, without allocation: the name and the
+   type tag are written by OSC_template_init, and the arguments, which
+   must all be 4 bytes long (integers and floats), are then changed in
+   place.  The buffer holds the whole message and is ready to be
+   sent. */
+#define OSC_TEMPLATE_MAX_SIZE 256
+
+struct OSC_template_s {
+  char buffer[OSC_TEMPLATE_MAX_SIZE] __attribute__ ((aligned (4)));
+  int size; /* 0 until initialized */
+  int arguments; /* Offset of the first argument */
+};
+
+typedef struct OSC_template_s * OSC_template_t;
+
+/* Writes the name and the type tag of the message, with arguments set
+   to 0.  Returns -1 if an argument type is not 4 bytes long or the
+   message does not fit. */
+extern int OSC_template_init (OSC_template_t t,
+                              const char * name,
+                              const char * typetag);
+
+/* Change the argument of given index (from 0) of a template, in host
+   order.  The index must be in the type tag. */
+static inline void
+OSC_template_set_int (OSC_template_t t, int index, int32_t value)
+{
+  uint32_t raw = htonl ((uint32_t) value);
+  memcpy (t->buffer + t->arguments + 4 * index, &raw, sizeof (raw));
+}
+
+static inline void
+OSC_template_set_float (OSC_template_t t, int index, float value)
+{
+  uint32_t raw;
+  memcpy (&raw, &value, sizeof (raw));
+  raw = htonl (raw);
+  memcpy (t->buffer + t->arguments + 4 * index, &raw, sizeof (raw));
+}
+
+/* OSC time tags are NTP times: the seconds since 1900 in the high 32
+   bits, and their fraction in the low 32 bits.  1 means
+   "immediately". */
+#define OSC_TIME_TAG_IMMEDIATELY ((uint64_t) 1)
+
+/* Time tag of a time given in nanoseconds since 1970, and back. */
+extern uint64_t OSC_time_tag_from_ns (uint64_t ns);
+extern uint64_t OSC_time_tag_to_ns (uint64_t time_tag);
+/* Time tag of the current time. */
+extern uint64_t OSC_time_tag_now (void);
+
 /* Returns 1 if the given OSC argument type is managed in the current
    implementation, 0 otherwise. */
 extern int OSC_type_is_managed (char type);
@@ -87,12 +142,22 @@ extern void OSC_space_register_method (OSC_space_t space, OSC_method_t m);
 /* Parses an OSC message contained in 'buffer'.  The parsing will not
    go further than 'maxsize' bytes after 'buffer'.  If the name of a
    registered method of the address space is found in the message, the
-   method is invoked with appropriate arguments.  Returns 0 on
-   success, -1 otherwise. */
+   method is invoked with appropriate arguments.  The name can be an
+   OSC address pattern ('?', '*', '[a-z]', '[!abc]', '{foo,bar}'), in
+   which case every matching method with the type tag of the message
+   is invoked.  Returns 0 on success, -1 otherwise.  A bundle whose time tag is in the future is
+   copied and kept until OSC_space_dispatch is called at its time. */
 extern int OSC_space_parse (OSC_space_t space,
                             const char * buffer,
                             int maxsize);
 
+/* Parses the bundles kept whose time has come, in the order of their
+   time tags.  Returns their number. */
+extern int OSC_space_dispatch (OSC_space_t space);
+
+/* Time tag of the next bundle kept, 0 if there is none. */
+extern uint64_t OSC_space_next_time_tag (OSC_space_t space);
+
 typedef int (* OSC_method_callback_t) (const char * args, void * data);
 
 /* Allocates and returns an OSC method.  The method is made of a name
@@ -0,0 +1,545 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Smoothing.h"
+#include "Standardization.h"
+#include "motion_engine.h"
+
+// Arrays are aligned and padded for the vector units
+#define ALIGNMENT 64
+#define LANES (ALIGNMENT / sizeof (float))
+
+class motion_filter;
+
+struct motion_engine_s {
+  int sensors;
+  int stride;
+  int centimeters;
+
+  struct motion_filter_params_s params;
+  motion_filter* filter;
+
+  // The three axes of all the sensors, packed as x[stride],
+  // y[stride], z[stride] for the filter
+  float* position;
+  float* velocity;
+  float* accel;
+
+  float* storage;
+  size_t storage_size;
+};
+
+static int padded (int sensors) {
+  return (sensors + LANES - 1) / LANES * LANES;
+}
+
+static float* aligned_floats (size_t count) {
+  void* p = NULL;
+  if (posix_memalign (&p, ALIGNMENT, count * sizeof (float)) != 0)
+    return NULL;
+  memset (p, 0, count * sizeof (float));
+  return (float*) p;
+}
+
+//_____________________________BLOCKS_____________________________//
+
+motion_block_t motion_block_new (int frames, int sensors) {
+  motion_block_t block = (motion_block_t) calloc (1, sizeof (*block));
+  block->frames = frames;
+  block->sensors = sensors;
+  block->stride = padded (sensors);
+
+  size_t size = (size_t) frames * block->stride;
+  float* p = aligned_floats (14 * size);
+  block->time = (uint64_t*) calloc (frames, sizeof (uint64_t));
+  if (p == NULL || block->time == NULL) {
+    free (p);
+    free (block->time);
+    free (block);
+    return NULL;
+  }
+
+  float** arrays[] = {
+    &block->x, &block->y, &block->z,
+    &block->za, &block->ya, &block->xa,
+    &block->dx, &block->dy, &block->dz,
+    &block->ax, &block->ay, &block->az,
+    &block->speed, &block->accel
+  };
+  for (size_t i = 0; i < sizeof (arrays) / sizeof (arrays[0]); i++)
+    *arrays[i] = p + i * size;
+
+  return block;
+}
+
+void motion_block_free (motion_block_t block) {
+  if (block == NULL) return;
+  free (block->x);
+  free (block->time);
+  free (block);
+}
+
+void motion_block_set_record (motion_block_t block, int frame, int sensor,
+                              const struct bird_record_s* record) {
+  int i = frame * block->stride + sensor;
+  block->x[i] = record->x;
+  block->y[i] = record->y;
+  block->z[i] = record->z;
+  block->za[i] = record->za;
+  block->ya[i] = record->ya;
+  block->xa[i] = record->xa;
+}
+
+void motion_block_get_record (motion_block_t block, int frame, int sensor,
+                              bird_record_t record) {
+  int i = frame * block->stride + sensor;
+  record->x = block->x[i];
+  record->y = block->y[i];
+  record->z = block->z[i];
+  record->za = block->za[i];
+  record->ya = block->ya[i];
+  record->xa = block->xa[i];
+}
+
+//_____________________________KERNELS_____________________________//
+
+// Same as bird_data_normalize
+static void normalize_position (float* __restrict__ v, float max, int n) {
+  for (int s = 0; s < n; s++) {
+    float c = v[s] > max ? max : v[s];
+    c = c < -max ? -max : c;
+    v[s] = c / max;
+  }
+}
+
+// Same as bird_angle_normalize, in double precision like it
+static void normalize_angles (float* __restrict__ za,
+                              float* __restrict__ ya,
+                              float* __restrict__ xa, int n) {
+  for (int s = 0; s < n; s++) {
+    double a = za[s];
+    za[s] = (180 - fabs (a)) * (-fabs (a) / a) / 180;
+    ya[s] /= 90;
+    xa[s] /= 180;
+  }
+}
+
+// out = current - previous, and previous = current
+static void difference (float* __restrict__ out,
+                        const float* __restrict__ current,
+                        float* __restrict__ previous, int n) {
+  for (int s = 0; s < n; s++) {
+    out[s] = current[s] - previous[s];
+    previous[s] = current[s];
+  }
+}
+
+static void scale (float* __restrict__ v, float factor, int n) {
+  for (int s = 0; s < n; s++)
+    v[s] *= factor;
+}
+
+static void norm (float* __restrict__ out,
+                  const float* __restrict__ x,
+                  const float* __restrict__ y,
+                  const float* __restrict__ z, int n) {
+  for (int s = 0; s < n; s++)
+    out[s] = sqrtf ((x[s] * x[s]) + (y[s] * y[s]) + (z[s] * z[s]));
+}
+
+//_____________________________FILTERS_____________________________//
+
+// A filter gets the positions of all the channels (the three axes of
+// every sensor) once per sample and gives their velocity, multiplied
+// by speed_factor, and their acceleration, both per sample.  Every
+// call takes a constant time.
+class motion_filter {
+public:
+  motion_filter (int channels) : channels (channels) {}
+  virtual ~motion_filter () {}
+  virtual void reset () = 0;
+  virtual void process (const struct motion_filter_params_s* params,
+                        float speed_factor,
+                        const float* __restrict__ position,
+                        float* __restrict__ velocity,
+                        float* __restrict__ accel) = 0;
+protected:
+  int channels;
+};
+
+// The 11-tap weighted moving average (see Smoothing.c) of the
+// differences of the position, then of the velocity.
+class smoothing_motion_filter : public motion_filter {
+public:
+  smoothing_motion_filter (int channels) : motion_filter (channels) {
+    speed_filter = smoothing_filter_new
+      (SPEED_SMOOTHING_ALPHA, SMOOTHING_WINDOW, channels);
+    accel_filter = smoothing_filter_new
+      (ACCEL_SMOOTHING_ALPHA, SMOOTHING_WINDOW, channels);
+    prev_position = aligned_floats (2 * channels);
+    prev_velocity = prev_position + channels;
+  }
+
+  ~smoothing_motion_filter () {
+    smoothing_filter_free (speed_filter);
+    smoothing_filter_free (accel_filter);
+    free (prev_position);
+  }
+
+  void reset () {
+    smoothing_filter_reset (speed_filter);
+    smoothing_filter_reset (accel_filter);
+    memset (prev_position, 0, 2 * channels * sizeof (float));
+  }
+
+  void process (const struct motion_filter_params_s* params,
+                float speed_factor,
+                const float* __restrict__ position,
+                float* __restrict__ velocity,
+                float* __restrict__ accel) {
+    difference (velocity, position, prev_position, channels);
+    smoothing_filter_process (speed_filter, velocity);
+    if (speed_factor != 1.f)
+      scale (velocity, speed_factor, channels);
+
+    difference (accel, velocity, prev_velocity, channels);
+    smoothing_filter_process (accel_filter, accel);
+  }
+
+private:
+  smoothing_filter_t speed_filter;
+  smoothing_filter_t accel_filter;
+  float* prev_position;
+  float* prev_velocity;
+};
+
+// One Euro filter (Casiez, Roussel and Vogel, CHI 2012): a low-pass
+// filter whose cutoff rises with the speed, so that slow moves are
+// smoothed and strokes are followed without lag.  The acceleration is
+// the difference of the velocity, low-passed at the derivative cutoff.
+class one_euro_motion_filter : public motion_filter {
+public:
+  one_euro_motion_filter (int channels) : motion_filter (channels) {
+    storage = aligned_floats (4 * channels);
+    filtered = storage;
+    derivative = storage + channels;
+    prev_velocity = storage + 2 * channels;
+    filtered_accel = storage + 3 * channels;
+    reset ();
+  }
+
+  ~one_euro_motion_filter () {
+    free (storage);
+  }
+
+  void reset () {
+    memset (storage, 0, 4 * channels * sizeof (float));
+    first = 1;
+  }
+
+  void process (const struct motion_filter_params_s* params,
+                float speed_factor,
+                const float* __restrict__ position,
+                float* __restrict__ velocity,
+                float* __restrict__ accel) {
+    if (first) {
+      memcpy (filtered, position, channels * sizeof (float));
+      first = 0;
+    }
+
+    float rate = params->rate;
+    float min_cutoff = params->min_cutoff;
+    float beta = params->beta;
+    float derivative_alpha = alpha (params->derivative_cutoff, rate);
+
+    for (int c = 0; c < channels; c++) {
+      float d = (position[c] - filtered[c]) * rate;
+      derivative[c] += derivative_alpha * (d - derivative[c]);
+
+      float cutoff = min_cutoff + beta * fabsf (derivative[c]);
+      float a = alpha (cutoff, rate);
+      float x = filtered[c] + a * (position[c] - filtered[c]);
+
+      velocity[c] = (x - filtered[c]) * speed_factor;
+      filtered[c] = x;
+
+      float da = velocity[c] - prev_velocity[c];
+      filtered_accel[c] += derivative_alpha * (da - filtered_accel[c]);
+      accel[c] = filtered_accel[c];
+      prev_velocity[c] = velocity[c];
+    }
+  }
+
+private:
+  // Smoothing factor of an exponential filter with this cutoff
+  static inline float alpha (float cutoff, float rate) {
+    float tau = 1.f / (2.f * (float) M_PI * cutoff);
+    return 1.f / (1.f + tau * rate);
+  }
+
+  float* storage;
+  float* filtered;
+  float* derivative;
+  float* prev_velocity;
+  float* filtered_accel;
+  int first;
+};
+
+// Kalman filter of a constant acceleration model, one per channel,
+// estimating the position, the velocity and the acceleration together
+// from the positions.  The time step is one sample, the process noise
+// is a white jerk.
+class kalman_motion_filter : public motion_filter {
+public:
+  kalman_motion_filter (int channels) : motion_filter (channels) {
+    storage = aligned_floats (9 * channels);
+    float* p = storage;
+    pos = p; p += channels;
+    vel = p; p += channels;
+    acc = p; p += channels;
+    p00 = p; p += channels;
+    p01 = p; p += channels;
+    p02 = p; p += channels;
+    p11 = p; p += channels;
+    p12 = p; p += channels;
+    p22 = p;
+    reset ();
+  }
+
+  ~kalman_motion_filter () {
+    free (storage);
+  }
+
+  void reset () {
+    memset (storage, 0, 9 * channels * sizeof (float));
+    first = 1;
+  }
+
+  void process (const struct motion_filter_params_s* params,
+                float speed_factor,
+                const float* __restrict__ position,
+                float* __restrict__ velocity,
+                float* __restrict__ accel) {
+    float q = params->process_noise;
+    float r = params->measurement_noise;
+
+    if (first) {
+      for (int c = 0; c < channels; c++) {
+        pos[c] = position[c];
+        p00[c] = r;
+        p11[c] = p22[c] = q;
+      }
+      first = 0;
+    }
+
+    for (int c = 0; c < channels; c++) {
+      // Prediction: x = F x, P = F P F' + Q with
+      // F = [1 1 1/2; 0 1 1; 0 0 1]
+      float x0 = pos[c] + vel[c] + 0.5f * acc[c];
+      float x1 = vel[c] + acc[c];
+      float x2 = acc[c];
+
+      float r00 = p00[c] + p01[c] + 0.5f * p02[c];
+      float r01 = p01[c] + p11[c] + 0.5f * p12[c];
+      float r02 = p02[c] + p12[c] + 0.5f * p22[c];
+      float r11 = p11[c] + p12[c];
+      float r12 = p12[c] + p22[c];
+
+      float m00 = r00 + r01 + 0.5f * r02 + q / 20.f;
+      float m01 = r01 + r02 + q / 8.f;
+      float m02 = r02 + q / 6.f;
+      float m11 = r11 + r12 + q / 3.f;
+      float m12 = r12 + q / 2.f;
+      float m22 = p22[c] + q;
+
+      // Update with the measured position
+      float s = m00 + r;
+      float k0 = m00 / s, k1 = m01 / s, k2 = m02 / s;
+      float y = position[c] - x0;
+
+      pos[c] = x0 + k0 * y;
+      vel[c] = x1 + k1 * y;
+      acc[c] = x2 + k2 * y;
+
+      p00[c] = m00 - k0 * m00;
+      p01[c] = m01 - k0 * m01;
+      p02[c] = m02 - k0 * m02;
+      p11[c] = m11 - k1 * m01;
+      p12[c] = m12 - k1 * m02;
+      p22[c] = m22 - k2 * m02;
+
+      velocity[c] = vel[c] * speed_factor;
+      accel[c] = acc[c] * speed_factor;
+    }
+  }
+
+private:
+  float* storage;
+  float* pos, *vel, *acc;
+  float* p00, *p01, *p02, *p11, *p12, *p22;
+  int first;
+};
+
+static const char* filter_names[MOTION_NUMBER_OF_FILTERS] = {
+  "smoothing", "one-euro", "kalman"
+};
+
+void motion_filter_params_init (motion_filter_params_t params) {
+  params->filter = MOTION_FILTER_SMOOTHING;
+  params->rate = 0.f;
+  params->min_cutoff = 1.f;
+  params->beta = 5.f;
+  params->derivative_cutoff = 30.f;
+  params->process_noise = 1e-6f;
+  params->measurement_noise = 1e-7f;
+}
+
+const char* motion_filter_to_string (int filter) {
+  if (filter < 0 || filter >= MOTION_NUMBER_OF_FILTERS) return NULL;
+  return filter_names[filter];
+}
+
+int motion_filter_from_string (const char* string) {
+  for (int filter = 0; filter < MOTION_NUMBER_OF_FILTERS; filter++)
+    if (strcmp (string, filter_names[filter]) == 0)
+      return filter;
+  return -1;
+}
+
+static motion_filter* motion_filter_new (int filter, int channels) {
+  switch (filter) {
+  case MOTION_FILTER_ONE_EURO: return new one_euro_motion_filter (channels);
+  case MOTION_FILTER_KALMAN: return new kalman_motion_filter (channels);
+  }
+  return new smoothing_motion_filter (channels);
+}
+
+//_____________________________ENGINE_____________________________//
+
+motion_engine_t motion_engine_new (int sensors) {
+  if (sensors < 1 || sensors > MAX_NUMBER_OF_BIRDS) return NULL;
+
+  motion_engine_t engine = (motion_engine_t) calloc (1, sizeof (*engine));
+  engine->sensors = sensors;
+  engine->stride = padded (sensors);
+
+  // Position, velocity and acceleration of the three axes
+  engine->storage_size = 9 * engine->stride;
+  engine->storage = aligned_floats (engine->storage_size);
+  if (engine->storage == NULL) {
+    free (engine);
+    return NULL;
+  }
+  engine->position = engine->storage;
+  engine->velocity = engine->storage + 3 * engine->stride;
+  engine->accel = engine->storage + 6 * engine->stride;
+
+  motion_filter_params_init (&engine->params);
+  engine->filter = motion_filter_new (engine->params.filter, 3 * engine->stride);
+
+  return engine;
+}
+
+void motion_engine_free (motion_engine_t engine) {
+  if (engine == NULL) return;
+  delete engine->filter;
+  free (engine->storage);
+  free (engine);
+}
+
+void motion_engine_reset (motion_engine_t engine, int centimeters) {
+  engine->centimeters = centimeters;
+  engine->filter->reset ();
+}
+
+void motion_engine_set_filter (motion_engine_t engine,
+                               const struct motion_filter_params_s* params) {
+  if (params->filter != engine->params.filter &&
+      params->filter >= 0 && params->filter < MOTION_NUMBER_OF_FILTERS) {
+    // The new filter starts from the next position
+    delete engine->filter;
+    engine->filter = motion_filter_new (params->filter, 3 * engine->stride);
+  }
+
+  int filter = engine->params.filter;
+  engine->params = *params;
+  if (params->filter < 0 || params->filter >= MOTION_NUMBER_OF_FILTERS)
+    engine->params.filter = filter;
+  if (engine->params.rate <= 0.f)
+    engine->params.rate = 240.f;
+}
+
+const struct motion_filter_params_s*
+motion_engine_get_filter (motion_engine_t engine) {
+  return &engine->params;
+}
+
+void motion_engine_process (motion_engine_t engine, motion_block_t block) {
+  int n = block->sensors < engine->sensors ? block->sensors : engine->sensors;
+  int stride = engine->stride;
+  int centimeters = engine->centimeters;
+  float* position = engine->position;
+  float* velocity = engine->velocity;
+  float* accel = engine->accel;
+
+  for (int frame = 0; frame < block->frames; frame++) {
+    size_t offset = (size_t) frame * block->stride;
+    float* x = block->x + offset, *y = block->y + offset, *z = block->z + offset;
+    float* dx = block->dx + offset, *dy = block->dy + offset, *dz = block->dz + offset;
+    float* ax = block->ax + offset, *ay = block->ay + offset, *az = block->az + offset;
+
+    // Position and angles
+    if (centimeters) {
+      normalize_position (x, MAX_X_DIST, n);
+      normalize_position (y, MAX_Y_DIST, n);
+      normalize_position (z, MAX_Z_DIST, n);
+      normalize_angles (block->za + offset, block->ya + offset,
+                        block->xa + offset, n);
+    }
+
+    // Speed and acceleration of the three axes at once
+    memcpy (position, x, n * sizeof (float));
+    memcpy (position + stride, y, n * sizeof (float));
+    memcpy (position + 2 * stride, z, n * sizeof (float));
+
+    engine->filter->process (&engine->params,
+                             centimeters ? SPEED_FACTOR : 1.f,
+                             position, velocity, accel);
+
+    memcpy (dx, velocity, n * sizeof (float));
+    memcpy (dy, velocity + stride, n * sizeof (float));
+    memcpy (dz, velocity + 2 * stride, n * sizeof (float));
+    memcpy (ax, accel, n * sizeof (float));
+    memcpy (ay, accel + stride, n * sizeof (float));
+    memcpy (az, accel + 2 * stride, n * sizeof (float));
+
+    if (centimeters) {
+      scale (ax, ACCEL_FACTOR, n);
+      scale (ay, ACCEL_FACTOR, n);
+      scale (az, ACCEL_FACTOR, n);
+    }
+
+    // Vector norms
+    norm (block->speed + offset, dx, dy, dz, n);
+    norm (block->accel + offset, ax, ay, az, n);
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef __motion_engine_h__
+#define __motion_engine_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Motion features of the sensors: normalized position and angles,
+// smoothed velocity and acceleration, and their norms.  Frames are
+// processed by blocks, every value being stored as a structure of
+// arrays so that the kernels run over all the sensors at once.  Used
+// by fob_pipeline (GUI and fobd) and by the tools working on
+// recordings.
+
+#include <stdint.h>
+
+#include "bird_record.h"
+
+// Value of sensor s at frame f: array[f * stride + s]
+typedef struct motion_block_s* motion_block_t;
+struct motion_block_s {
+  int frames;
+  int sensors;
+  int stride;
+  // Input: the records as read from the tracker.  Output: normalized.
+  float* x, *y, *z;
+  float* za, *ya, *xa;
+  // Input: time of every frame, in nanoseconds (see
+  // tracker_get_record_time)
+  uint64_t* time;
+  // Output
+  float* dx, *dy, *dz;
+  float* ax, *ay, *az;
+  float* speed, *accel;
+};
+
+// Block of up to 'frames' frames of 'sensors' sensors
+extern motion_block_t motion_block_new (int frames, int sensors);
+extern void motion_block_free (motion_block_t block);
+extern void motion_block_set_record (motion_block_t block, int frame, int sensor,
+                                     const struct bird_record_s* record);
+extern void motion_block_get_record (motion_block_t block, int frame, int sensor,
+                                     bird_record_t record);
+
+// Filters giving the velocity and the acceleration from the positions
+enum motion_filter_e {
+  // Weighted moving average of the differences (see Smoothing.c)
+  MOTION_FILTER_SMOOTHING = 0,
+  // Low-pass filter following the speed, less lag on the strokes
+  MOTION_FILTER_ONE_EURO,
+  // Constant acceleration Kalman filter of every axis
+  MOTION_FILTER_KALMAN,
+  MOTION_NUMBER_OF_FILTERS
+};
+
+typedef struct motion_filter_params_s* motion_filter_params_t;
+struct motion_filter_params_s {
+  int filter;
+  float rate; // Samples per second, 0 for 240
+  // One Euro: cutoff = min_cutoff + beta * |speed| (Hz, speed in
+  // normalized units per second), derivative_cutoff for the
+  // acceleration.
+  float min_cutoff;
+  float beta;
+  float derivative_cutoff;
+  // Kalman: variance of the jerk and of the measured positions
+  // (normalized units, per sample)
+  float process_noise;
+  float measurement_noise;
+};
+
+extern void motion_filter_params_init (motion_filter_params_t params);
+// "smoothing", "one-euro", "kalman"
+extern const char* motion_filter_to_string (int filter);
+extern int motion_filter_from_string (const char* string);
+
+typedef struct motion_engine_s* motion_engine_t;
+
+extern motion_engine_t motion_engine_new (int sensors);
+extern void motion_engine_free (motion_engine_t engine);
+
+// Forgets the previous frames.  With 'centimeters', positions are
+// normalized as in Standardization.c.
+extern void motion_engine_reset (motion_engine_t engine, int centimeters);
+
+// Changes the parameters of the filter.  Changing the filter starts
+// the new one from the next frame.
+extern void motion_engine_set_filter (motion_engine_t engine,
+                                      const struct motion_filter_params_s* params);
+extern const struct motion_filter_params_s*
+motion_engine_get_filter (motion_engine_t engine);
+
+// Processes the frames of the block in order, for its first
+// block->sensors sensors (at most the number given to
+// motion_engine_new).
+extern void motion_engine_process (motion_engine_t engine, motion_block_t block);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
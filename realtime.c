@@ -0,0 +1,246 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <sys/syscall.h>
+#endif
+
+#include "realtime.h"
+
+#ifdef __linux__
+// Not every C library declares sched_setattr
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+struct realtime_sched_attr_s {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+static int realtime_set_deadline (const struct realtime_params_s* params) {
+#ifdef SYS_sched_setattr
+  struct realtime_sched_attr_s attr;
+  memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.sched_policy = SCHED_DEADLINE;
+  attr.sched_runtime = params->runtime;
+  attr.sched_deadline = params->deadline ? params->deadline : params->period;
+  attr.sched_period = params->period;
+
+  // 0 is the calling thread
+  if (syscall (SYS_sched_setattr, 0, &attr, 0) == -1) {
+    fprintf (stderr, "Can't set SCHED_DEADLINE: %s\n", strerror (errno));
+    return -1;
+  }
+  return 0;
+#else
+  fprintf (stderr, "SCHED_DEADLINE is not supported by this system\n");
+  return -1;
+#endif
+}
+#endif
+
+void realtime_params_init (realtime_params_t params) {
+  memset (params, 0, sizeof (*params));
+  params->policy = REALTIME_SCHED_OTHER;
+  params->cpu = -1;
+}
+
+int realtime_policy_from_string (const char* string) {
+  if (strcmp (string, "other") == 0) return REALTIME_SCHED_OTHER;
+  if (strcmp (string, "fifo") == 0) return REALTIME_SCHED_FIFO;
+  if (strcmp (string, "rr") == 0) return REALTIME_SCHED_RR;
+  if (strcmp (string, "deadline") == 0) return REALTIME_SCHED_DEADLINE;
+  return -1;
+}
+
+const char* realtime_policy_to_string (int policy) {
+  switch (policy) {
+  case REALTIME_SCHED_OTHER: return "other";
+  case REALTIME_SCHED_FIFO: return "fifo";
+  case REALTIME_SCHED_RR: return "rr";
+  case REALTIME_SCHED_DEADLINE: return "deadline";
+  }
+  return "unknown";
+}
+
+int realtime_set_thread (const struct realtime_params_s* params) {
+  int result = 0;
+
+  // The kernel refuses SCHED_DEADLINE to a thread whose affinity is
+  // narrower than its root domain: its CPU is to be isolated with an
+  // exclusive cpuset instead.
+  if (params->policy == REALTIME_SCHED_DEADLINE && params->cpu >= 0) {
+    fprintf (stderr, "SCHED_DEADLINE can't be combined with pinning to CPU %d\n",
+             params->cpu);
+    return -1;
+  }
+
+  if (params->cpu >= 0) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (params->cpu, &set);
+    int err = pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+    if (err) {
+      fprintf (stderr, "Can't pin thread to CPU %d: %s\n",
+               params->cpu, strerror (err));
+      result = -1;
+    }
+#else
+    fprintf (stderr, "CPU pinning is not supported by this system\n");
+    result = -1;
+#endif
+  }
+
+  switch (params->policy) {
+  case REALTIME_SCHED_OTHER:
+    break;
+
+  case REALTIME_SCHED_FIFO:
+  case REALTIME_SCHED_RR: {
+    int policy = params->policy == REALTIME_SCHED_FIFO ? SCHED_FIFO : SCHED_RR;
+    struct sched_param p;
+    memset (&p, 0, sizeof (p));
+    p.sched_priority = params->priority;
+    int err = pthread_setschedparam (pthread_self (), policy, &p);
+    if (err) {
+      fprintf (stderr, "Can't set %s priority %d: %s\n",
+               realtime_policy_to_string (params->policy),
+               params->priority, strerror (err));
+      result = -1;
+    }
+    break;
+  }
+
+  case REALTIME_SCHED_DEADLINE:
+#ifdef __linux__
+    if (realtime_set_deadline (params) == -1)
+      result = -1;
+#else
+    fprintf (stderr, "SCHED_DEADLINE is not supported by this system\n");
+    result = -1;
+#endif
+    break;
+
+  default:
+    fprintf (stderr, "Unknown scheduling policy %d\n", params->policy);
+    result = -1;
+  }
+
+  return result;
+}
+
+int realtime_lock_memory () {
+#ifdef __linux__
+  // Freed memory stays in the process, and no allocation gets its own
+  // mapping, so that malloc never faults after startup.
+  mallopt (M_TRIM_THRESHOLD, -1);
+  mallopt (M_MMAP_MAX, 0);
+#endif
+
+  if (mlockall (MCL_CURRENT | MCL_FUTURE) == -1) {
+    fprintf (stderr, "Can't lock memory: %s\n", strerror (errno));
+    return -1;
+  }
+
+  return 0;
+}
+
+void realtime_prefault_stack (size_t size) {
+  unsigned char* stack = alloca (size);
+  long page = sysconf (_SC_PAGESIZE);
+  if (page <= 0) page = 4096;
+
+  for (size_t i = 0; i < size; i += page)
+    ((volatile unsigned char*) stack)[i] = 0;
+}
+
+uint64_t realtime_now () {
+  struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+#else
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  ts.tv_sec = tv.tv_sec;
+  ts.tv_nsec = tv.tv_usec * 1000;
+#endif
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void realtime_stats_init (realtime_stats_t stats, const char* name) {
+  memset (stats, 0, sizeof (*stats));
+  stats->name = name;
+  stats->min = UINT64_MAX;
+}
+
+void realtime_stats_add (realtime_stats_t stats, uint64_t ns) {
+  stats->count++;
+  stats->sum += ns;
+  if (ns < stats->min) stats->min = ns;
+  if (ns > stats->max) stats->max = ns;
+
+  uint64_t us = ns / 1000;
+  int bucket = 0;
+  while (us > 1 && bucket < REALTIME_STATS_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  stats->histogram[bucket]++;
+}
+
+void realtime_stats_print (FILE* file, realtime_stats_t stats) {
+  if (stats->count == 0) {
+    fprintf (file, "%s: no samples\n", stats->name);
+    return;
+  }
+
+  fprintf (file, "%s: %lu samples, min %.1f us, mean %.1f us, max %.1f us\n",
+           stats->name, stats->count,
+           stats->min / 1e3,
+           (double) stats->sum / stats->count / 1e3,
+           stats->max / 1e3);
+
+  for (int i = 0; i < REALTIME_STATS_BUCKETS; i++) {
+    if (stats->histogram[i] == 0) continue;
+    fprintf (file, "  < %8lu us: %lu\n", 2UL << i, stats->histogram[i]);
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef __realtime_h__
+#define __realtime_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Scheduling of the time critical threads: realtime policies, CPU
+// pinning, locked memory, and statistics on the latencies observed.
+
+#include <stdio.h>
+#include <stdint.h>
+
+enum realtime_policy_e {
+  REALTIME_SCHED_OTHER = 0,
+  REALTIME_SCHED_FIFO,
+  REALTIME_SCHED_RR,
+  // Linux only: the thread gets 'runtime' nanoseconds of CPU every
+  // 'period', to be used before 'deadline'.  It can't be pinned (see
+  // realtime_set_thread).
+  REALTIME_SCHED_DEADLINE
+};
+
+typedef struct realtime_params_s* realtime_params_t;
+struct realtime_params_s {
+  int policy;
+  int priority; // For FIFO and RR, 1 to 99
+  int cpu; // CPU the thread is pinned to, -1 for any
+  uint64_t runtime; // For DEADLINE, in nanoseconds
+  uint64_t deadline;
+  uint64_t period;
+};
+
+// Normal scheduling on any CPU
+extern void realtime_params_init (realtime_params_t params);
+// "other", "fifo", "rr" or "deadline", -1 if unknown
+extern int realtime_policy_from_string (const char* string);
+extern const char* realtime_policy_to_string (int policy);
+
+// Applies the parameters to the calling thread.  Returns 0 on
+// success, -1 otherwise (the reason is reported on stderr).  DEADLINE
+// with a CPU is refused: the kernel only admits DEADLINE threads that
+// may run on every CPU of their root domain.
+extern int realtime_set_thread (const struct realtime_params_s* params);
+
+// Locks the current and future pages of the process in memory and
+// keeps malloc from giving memory back to the system.  Returns 0 on
+// success, -1 otherwise.
+extern int realtime_lock_memory (void);
+
+// Touches 'size' bytes of stack so that the pages are mapped before
+// the realtime loop starts.
+extern void realtime_prefault_stack (size_t size);
+
+// Monotonic clock, in nanoseconds
+extern uint64_t realtime_now (void);
+
+// Latency statistics.  Bucket i of the histogram counts the values
+// in [2^i, 2^(i+1)[ microseconds (bucket 0 also counts values below
+// one microsecond).
+#define REALTIME_STATS_BUCKETS 24
+
+typedef struct realtime_stats_s* realtime_stats_t;
+struct realtime_stats_s {
+  const char* name;
+  unsigned long count;
+  uint64_t min;
+  uint64_t max;
+  uint64_t sum;
+  unsigned long histogram[REALTIME_STATS_BUCKETS];
+};
+
+extern void realtime_stats_init (realtime_stats_t stats, const char* name);
+extern void realtime_stats_add (realtime_stats_t stats, uint64_t ns);
+extern void realtime_stats_print (FILE* file, realtime_stats_t stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,297 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "recording.h"
+#include "realtime.h"
+
+#define HEADER_MAGIC "FoBrec01"
+#define FOOTER_MAGIC "FoBidx01"
+#define MAGIC_SIZE 8
+#define BACKEND_SIZE 32
+#define HEADER_SIZE (MAGIC_SIZE + BACKEND_SIZE + 4 + 4 + 8)
+#define CHUNK_HEADER_SIZE (8 + 4)
+#define INDEX_ENTRY_SIZE (8 + 8)
+#define FOOTER_SIZE (MAGIC_SIZE + 8 + 8 + 8)
+
+struct recording_index_s {
+  uint64_t time;
+  uint64_t offset;
+};
+
+struct recording_writer_s {
+  FILE* file;
+  uint64_t start;
+  uint64_t offset;
+  uint64_t chunks;
+  uint64_t next_index_time;
+  struct recording_index_s* index;
+  size_t index_entries;
+  size_t index_allocated;
+  int error;
+};
+
+struct recording_reader_s {
+  int fd;
+  const unsigned char* map;
+  size_t size;
+  size_t end; // End of the chunks
+  char backend[BACKEND_SIZE + 1];
+  int number_of_birds;
+  const unsigned char* index;
+  uint64_t index_entries;
+  uint64_t duration;
+  size_t pos;
+};
+
+static void put_u32 (unsigned char* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = v >> (8 * i);
+}
+
+static void put_u64 (unsigned char* p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = v >> (8 * i);
+}
+
+static uint32_t get_u32 (const unsigned char* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static uint64_t get_u64 (const unsigned char* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+//_____________WRITER________________________________________//
+
+static void recording_writer_write (recording_writer_t writer,
+                                    const void* buf,
+                                    size_t len) {
+  if (fwrite (buf, 1, len, writer->file) != len)
+    writer->error = 1;
+  writer->offset += len;
+}
+
+recording_writer_t recording_writer_open (const char* filename,
+                                          const char* backend,
+                                          int number_of_birds) {
+  FILE* file = fopen (filename, "wb");
+  if (file == NULL) {
+    perror (filename);
+    return NULL;
+  }
+
+  recording_writer_t writer = calloc (1, sizeof (*writer));
+  writer->file = file;
+  writer->start = realtime_now ();
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+
+  unsigned char header[HEADER_SIZE];
+  memset (header, 0, sizeof (header));
+  memcpy (header, HEADER_MAGIC, MAGIC_SIZE);
+  strncpy ((char*) header + MAGIC_SIZE, backend, BACKEND_SIZE - 1);
+  put_u32 (header + MAGIC_SIZE + BACKEND_SIZE, number_of_birds);
+  put_u64 (header + MAGIC_SIZE + BACKEND_SIZE + 8,
+           (uint64_t) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL);
+  recording_writer_write (writer, header, sizeof (header));
+
+  return writer;
+}
+
+void recording_writer_add (recording_writer_t writer,
+                           const void* buf,
+                           size_t len) {
+  uint64_t time = realtime_now () - writer->start;
+
+  if (time >= writer->next_index_time) {
+    if (writer->index_entries >= writer->index_allocated) {
+      writer->index_allocated = writer->index_allocated ?
+        2 * writer->index_allocated : 256;
+      writer->index = realloc
+        (writer->index, writer->index_allocated * sizeof (*writer->index));
+    }
+    writer->index[writer->index_entries].time = time;
+    writer->index[writer->index_entries].offset = writer->offset;
+    writer->index_entries++;
+    writer->next_index_time = time + RECORDING_INDEX_PERIOD;
+  }
+
+  unsigned char chunk[CHUNK_HEADER_SIZE];
+  put_u64 (chunk, time);
+  put_u32 (chunk + 8, len);
+  recording_writer_write (writer, chunk, sizeof (chunk));
+  recording_writer_write (writer, buf, len);
+  writer->chunks++;
+}
+
+void recording_writer_tap (void* data, const void* buf, size_t len) {
+  recording_writer_add ((recording_writer_t) data, buf, len);
+}
+
+int recording_writer_close (recording_writer_t writer) {
+  uint64_t index_offset = writer->offset;
+
+  for (size_t i = 0; i < writer->index_entries; i++) {
+    unsigned char entry[INDEX_ENTRY_SIZE];
+    put_u64 (entry, writer->index[i].time);
+    put_u64 (entry + 8, writer->index[i].offset);
+    recording_writer_write (writer, entry, sizeof (entry));
+  }
+
+  unsigned char footer[FOOTER_SIZE];
+  memcpy (footer, FOOTER_MAGIC, MAGIC_SIZE);
+  put_u64 (footer + MAGIC_SIZE, index_offset);
+  put_u64 (footer + MAGIC_SIZE + 8, writer->index_entries);
+  put_u64 (footer + MAGIC_SIZE + 16, writer->chunks);
+  recording_writer_write (writer, footer, sizeof (footer));
+
+  if (fclose (writer->file) != 0) writer->error = 1;
+
+  int result = writer->error ? -1 : 0;
+  free (writer->index);
+  free (writer);
+  return result;
+}
+
+//_____________READER________________________________________//
+
+recording_reader_t recording_reader_open (const char* filename) {
+  int fd = open (filename, O_RDONLY);
+  if (fd == -1) return NULL;
+
+  struct stat st;
+  if (fstat (fd, &st) == -1 || st.st_size < HEADER_SIZE) {
+    close (fd);
+    return NULL;
+  }
+
+  const unsigned char* map =
+    mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED || memcmp (map, HEADER_MAGIC, MAGIC_SIZE) != 0) {
+    if (map != MAP_FAILED) munmap ((void*) map, st.st_size);
+    close (fd);
+    return NULL;
+  }
+
+  recording_reader_t reader = calloc (1, sizeof (*reader));
+  reader->fd = fd;
+  reader->map = map;
+  reader->size = st.st_size;
+  reader->end = st.st_size;
+  memcpy (reader->backend, map + MAGIC_SIZE, BACKEND_SIZE);
+  reader->number_of_birds = get_u32 (map + MAGIC_SIZE + BACKEND_SIZE);
+
+  // Index, if the recording was closed properly
+  const unsigned char* footer = map + st.st_size - FOOTER_SIZE;
+  if (st.st_size >= HEADER_SIZE + FOOTER_SIZE &&
+      memcmp (footer, FOOTER_MAGIC, MAGIC_SIZE) == 0) {
+    uint64_t index_offset = get_u64 (footer + MAGIC_SIZE);
+    uint64_t entries = get_u64 (footer + MAGIC_SIZE + 8);
+    if (index_offset >= HEADER_SIZE &&
+        index_offset + entries * INDEX_ENTRY_SIZE + FOOTER_SIZE == reader->size) {
+      reader->end = index_offset;
+      reader->index = map + index_offset;
+      reader->index_entries = entries;
+    }
+  }
+
+  // Duration: time of the last chunk, from the last index entry on
+  size_t pos = reader->index_entries ?
+    get_u64 (reader->index + (reader->index_entries - 1) * INDEX_ENTRY_SIZE + 8) :
+    HEADER_SIZE;
+  reader->pos = pos;
+  uint64_t time;
+  const unsigned char* data;
+  size_t len;
+  while (recording_reader_next (reader, &time, &data, &len))
+    reader->duration = time;
+
+  reader->pos = HEADER_SIZE;
+  return reader;
+}
+
+void recording_reader_close (recording_reader_t reader) {
+  munmap ((void*) reader->map, reader->size);
+  close (reader->fd);
+  free (reader);
+}
+
+const char* recording_reader_get_backend (recording_reader_t reader) {
+  return reader->backend;
+}
+
+int recording_reader_get_number_of_birds (recording_reader_t reader) {
+  return reader->number_of_birds;
+}
+
+uint64_t recording_reader_get_duration (recording_reader_t reader) {
+  return reader->duration;
+}
+
+void recording_reader_seek (recording_reader_t reader, uint64_t time) {
+  reader->pos = HEADER_SIZE;
+
+  // Last index entry before 'time'
+  uint64_t lo = 0, hi = reader->index_entries;
+  while (lo < hi) {
+    uint64_t mid = (lo + hi) / 2;
+    if (get_u64 (reader->index + mid * INDEX_ENTRY_SIZE) <= time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo > 0)
+    reader->pos = get_u64 (reader->index + (lo - 1) * INDEX_ENTRY_SIZE + 8);
+
+  // Then chunk by chunk
+  while (reader->pos + CHUNK_HEADER_SIZE <= reader->end &&
+         get_u64 (reader->map + reader->pos) < time)
+    reader->pos += CHUNK_HEADER_SIZE + get_u32 (reader->map + reader->pos + 8);
+}
+
+int recording_reader_next (recording_reader_t reader,
+                           uint64_t* time,
+                           const unsigned char** data,
+                           size_t* len) {
+  if (reader->pos + CHUNK_HEADER_SIZE > reader->end)
+    return 0;
+
+  const unsigned char* chunk = reader->map + reader->pos;
+  size_t length = get_u32 (chunk + 8);
+  // A truncated last chunk ends the recording
+  if (reader->pos + CHUNK_HEADER_SIZE + length > reader->end)
+    return 0;
+
+  *time = get_u64 (chunk);
+  *data = chunk + CHUNK_HEADER_SIZE;
+  *len = length;
+  reader->pos += CHUNK_HEADER_SIZE + length;
+  return 1;
+}
@@ -0,0 +1,82 @@
+#ifndef __recording_h__
+#define __recording_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Recordings of the raw bytes read from a tracker, with the time they
+// arrived, so that a show can be replayed through the same parsers.
+//
+// File layout (integers are little endian):
+//   header: "FoBrec01", backend name (32 bytes), number of birds (u32),
+//           reserved (u32), wall clock time of the start (u64, ns)
+//   chunks: time since the start (u64, ns), length (u32), bytes
+//   index:  (time, file offset) of a chunk every RECORDING_INDEX_PERIOD
+//   footer: "FoBidx01", index offset (u64), index entries (u64),
+//           chunks (u64)
+// A recording without footer (interrupted) can still be read, without
+// index.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECORDING_INDEX_PERIOD 100000000ULL // 100 ms
+
+typedef struct recording_writer_s* recording_writer_t;
+
+// Returns NULL if the file can't be created
+extern recording_writer_t recording_writer_open (const char* filename,
+                                                 const char* backend,
+                                                 int number_of_birds);
+// Appends bytes read now from the tracker
+extern void recording_writer_add (recording_writer_t writer,
+                                  const void* buf,
+                                  size_t len);
+// Writes the index and closes the file.  Returns 0 on success, -1 on
+// write errors.
+extern int recording_writer_close (recording_writer_t writer);
+
+// Same signature as the taps of the backends, 'data' is the writer
+extern void recording_writer_tap (void* data, const void* buf, size_t len);
+
+typedef struct recording_reader_s* recording_reader_t;
+
+// Returns NULL if the file is not a recording
+extern recording_reader_t recording_reader_open (const char* filename);
+extern void recording_reader_close (recording_reader_t reader);
+
+extern const char* recording_reader_get_backend (recording_reader_t reader);
+extern int recording_reader_get_number_of_birds (recording_reader_t reader);
+// Time of the last chunk, in nanoseconds
+extern uint64_t recording_reader_get_duration (recording_reader_t reader);
+
+// Goes to the first chunk at or after 'time'
+extern void recording_reader_seek (recording_reader_t reader, uint64_t time);
+// Next chunk: returns 1 and sets time, data and len, or returns 0 at
+// the end of the recording.
+extern int recording_reader_next (recording_reader_t reader,
+                                  uint64_t* time,
+                                  const unsigned char** data,
+                                  size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
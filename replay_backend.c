@@ -0,0 +1,438 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Replay of a recording (see recording.h) through the parser of the
+// tracker it was made with.  The file argument is the recording
+// followed by options, for instance "show.fobrec speed=2 loop=yes":
+//
+//   speed  1 for real time (default), another factor to go faster or
+//          slower, "max" for as fast as the parser reads
+//   loop   start again at the end of the recording
+//   start  seconds skipped at the beginning
+//
+// A thread writes the recorded bytes to a socket pair at the recorded
+// times; the parser reads the other end as it would read the device.
+// At full speed there is no thread: every chunk is written once the
+// parser has read the previous one, and the records get the recorded
+// time of the chunk they were read in.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+
+#include "flock/flock.h"
+#include "flock/flock_hl.h"
+#include "liberty_hl.h"
+#include "recording.h"
+#include "realtime.h"
+#include "tracker_backend.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+enum replay_backend_error_e {
+  REPLAY_BACKEND_ERROR_OPTIONS = 1,
+  REPLAY_BACKEND_ERROR_OPEN_RECORDING = 2,
+  REPLAY_BACKEND_ERROR_UNKNOWN_TRACKER = 3,
+  REPLAY_BACKEND_ERROR_OPEN = 4,
+  REPLAY_BACKEND_ERROR_END = 5
+};
+
+struct replay_backend_s {
+  // Options
+  char filename[1024];
+  double speed; // 0 for as fast as possible
+  int loop;
+  double start;
+
+  recording_reader_t reader;
+  liberty_t liberty;
+  flock_t flock;
+  int number_of_birds;
+
+  int fd; // Read by the parser
+  int sockfd; // Written by the thread
+  pthread_t thread;
+  int threaded; // The thread is started
+  uint64_t origin; // Time the replay started
+  volatile int running;
+  volatile int finished;
+
+  // At full speed, recorded times of the chunk read last and of the
+  // one waiting in the socket, plus the length of the previous loops
+  uint64_t time;
+  uint64_t pending_time;
+  uint64_t loop_offset;
+
+  unsigned long records;
+  unsigned long errors;
+};
+
+static int replay_parse_options (struct replay_backend_s* b, const char* options) {
+  b->filename[0] = '\0';
+  b->speed = 1.;
+  b->loop = 0;
+  b->start = 0.;
+
+  char buf[2048];
+  strncpy (buf, options, sizeof (buf) - 1);
+  buf[sizeof (buf) - 1] = '\0';
+
+  for (char* token = strtok (buf, " \t"); token; token = strtok (NULL, " \t")) {
+    char* value = strchr (token, '=');
+    if (value == NULL) {
+      strncpy (b->filename, token, sizeof (b->filename) - 1);
+      continue;
+    }
+    *value++ = '\0';
+
+    if (strcmp (token, "speed") == 0)
+      b->speed = strcmp (value, "max") == 0 ? 0. : atof (value);
+    else if (strcmp (token, "loop") == 0)
+      b->loop = strcmp (value, "yes") == 0 || strcmp (value, "1") == 0;
+    else if (strcmp (token, "start") == 0)
+      b->start = atof (value);
+    else
+      return -1;
+  }
+
+  if (b->filename[0] == '\0' || b->speed < 0. || b->start < 0.) return -1;
+  return 0;
+}
+
+static void sleep_until (uint64_t deadline) {
+  uint64_t now = realtime_now ();
+  if (deadline <= now) return;
+
+  uint64_t ns = deadline - now;
+  struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+  while (nanosleep (&ts, &ts) == -1 && errno == EINTR)
+    ;
+}
+
+static int write_all (int fd, const unsigned char* p, size_t size) {
+  while (size > 0) {
+    // The reader may shut the socket down while we write
+    ssize_t len = send (fd, p, size, MSG_NOSIGNAL);
+    if (len == -1 && errno == EINTR) continue;
+    if (len <= 0) return -1;
+    p += len;
+    size -= len;
+  }
+  return 0;
+}
+
+static void* replay_thread (void* data) {
+  struct replay_backend_s* b = data;
+  uint64_t start = (uint64_t) (b->start * 1e9);
+
+  do {
+    recording_reader_seek (b->reader, start);
+    uint64_t origin = realtime_now ();
+
+    uint64_t time;
+    const unsigned char* chunk;
+    size_t len;
+
+    while (b->running &&
+           recording_reader_next (b->reader, &time, &chunk, &len)) {
+      if (b->speed > 0.)
+        sleep_until (origin + (uint64_t) ((time - start) / b->speed));
+      if (write_all (b->sockfd, chunk, len) == -1) {
+        b->running = 0;
+        break;
+      }
+    }
+  } while (b->running && b->loop);
+
+  // The parser sees the end of the stream once the data is read
+  b->finished = 1;
+  shutdown (b->sockfd, SHUT_WR);
+  return NULL;
+}
+
+// At full speed, writes the next chunk.  Returns 0 at the end of the
+// recording.
+static int replay_feed (struct replay_backend_s* b) {
+  uint64_t time;
+  const unsigned char* chunk;
+  size_t len;
+
+  if (!recording_reader_next (b->reader, &time, &chunk, &len)) {
+    if (!b->loop) return 0;
+    // Again, from the time the previous loop ended
+    uint64_t start = (uint64_t) (b->start * 1e9);
+    b->loop_offset = b->pending_time - start;
+    recording_reader_seek (b->reader, start);
+    if (!recording_reader_next (b->reader, &time, &chunk, &len)) return 0;
+  }
+
+  b->pending_time = b->loop_offset + time;
+  return write_all (b->sockfd, chunk, len) == 0;
+}
+
+// Tap of the parser at full speed: the bytes it read are of the
+// waiting chunk, and the next one is written once it is emptied.
+static void replay_tap (void* data, const void* buf, size_t len) {
+  struct replay_backend_s* b = data;
+  b->time = b->pending_time;
+
+  int waiting = 0;
+  if (b->finished ||
+      ioctl (b->fd, FIONREAD, &waiting) == -1 || waiting > 0)
+    return;
+  if (!replay_feed (b)) {
+    // The parser sees the end of the stream
+    b->finished = 1;
+    shutdown (b->sockfd, SHUT_WR);
+  }
+}
+
+static void* replay_backend_make () {
+  struct replay_backend_s* b = calloc (1, sizeof (struct replay_backend_s));
+  b->fd = -1;
+  b->sockfd = -1;
+  return b;
+}
+
+static void replay_backend_close (void* handle) {
+  struct replay_backend_s* b = handle;
+
+  if (b->threaded) {
+    b->running = 0;
+    // Unblocks the thread if it is writing
+    if (b->fd != -1) shutdown (b->fd, SHUT_RDWR);
+    pthread_join (b->thread, NULL);
+    b->threaded = 0;
+  }
+  b->finished = 0;
+
+  // The parsers close b->fd
+  if (b->liberty) {
+    liberty_free (b->liberty);
+    b->liberty = NULL;
+    b->fd = -1;
+  }
+  if (b->flock) {
+    flock_close (b->flock);
+    b->flock = NULL;
+    b->fd = -1;
+  }
+
+  if (b->fd != -1) close (b->fd);
+  if (b->sockfd != -1) close (b->sockfd);
+  b->fd = -1;
+  b->sockfd = -1;
+
+  if (b->reader) {
+    recording_reader_close (b->reader);
+    b->reader = NULL;
+  }
+}
+
+static void replay_backend_free (void* handle) {
+  replay_backend_close (handle);
+  free (handle);
+}
+
+static int replay_backend_open (void* handle, const char* file) {
+  struct replay_backend_s* b = handle;
+
+  if (replay_parse_options (b, file) == -1)
+    return REPLAY_BACKEND_ERROR_OPTIONS;
+
+  b->reader = recording_reader_open (b->filename);
+  if (b->reader == NULL)
+    return REPLAY_BACKEND_ERROR_OPEN_RECORDING;
+
+  const char* tracker = recording_reader_get_backend (b->reader);
+  if (strcmp (tracker, "liberty") != 0 && strcmp (tracker, "flock") != 0)
+    return REPLAY_BACKEND_ERROR_UNKNOWN_TRACKER;
+
+  b->number_of_birds = recording_reader_get_number_of_birds (b->reader);
+  b->records = 0;
+  b->errors = 0;
+
+  int fds[2] = { -1, -1 };
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds)) {
+    perror ("socketpair");
+    return REPLAY_BACKEND_ERROR_OPEN;
+  }
+
+  b->fd = fds[0];
+  b->sockfd = fds[1];
+
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt (b->sockfd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof (one));
+#endif
+
+  if (strcmp (tracker, "liberty") == 0) {
+    b->liberty = liberty_new ();
+    liberty_open_fd (b->liberty, b->fd);
+  }
+  else {
+    b->flock = flock_hl_open_stream_fd
+      (b->fd, b->number_of_birds, flock_bird_record_mode_position_angles);
+    if (b->flock == NULL)
+      return REPLAY_BACKEND_ERROR_OPEN;
+  }
+
+  if (b->speed <= 0.) {
+    b->time = b->pending_time = b->loop_offset = 0;
+    if (b->liberty)
+      liberty_set_tap (b->liberty, replay_tap, b);
+    else
+      flock_set_tap (b->flock, replay_tap, b);
+    recording_reader_seek (b->reader, (uint64_t) (b->start * 1e9));
+    if (!replay_feed (b)) {
+      b->finished = 1;
+      shutdown (b->sockfd, SHUT_WR);
+    }
+    return TRACKER_ERROR_NO_ERROR;
+  }
+
+  b->running = 1;
+  b->origin = realtime_now ();
+  if (pthread_create (&b->thread, NULL, replay_thread, b)) {
+    b->running = 0;
+    return REPLAY_BACKEND_ERROR_OPEN;
+  }
+  b->threaded = 1;
+
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static int replay_backend_get_file_descriptor (void* handle) {
+  struct replay_backend_s* b = handle;
+  return b->fd;
+}
+
+static int replay_backend_get_number_of_birds (void* handle) {
+  struct replay_backend_s* b = handle;
+  return b->number_of_birds;
+}
+
+static int replay_backend_get_flags (void* handle) {
+  struct replay_backend_s* b = handle;
+  return b->liberty ? TRACKER_FLAG_CENTIMETERS : 0;
+}
+
+static int replay_backend_read_next_record (void* handle) {
+  struct replay_backend_s* b = handle;
+
+  if (b->liberty) {
+    // As for the Liberty, a record that can't be synchronized is not
+    // an error, unless the recording is over.
+    if (liberty_read_next_record (b->liberty))
+      return TRACKER_ERROR_NO_ERROR;
+    return b->finished ? REPLAY_BACKEND_ERROR_END : TRACKER_ERROR_NO_ERROR;
+  }
+
+  if (flock_next_record (b->flock, 1) != 1) {
+    if (b->finished) return REPLAY_BACKEND_ERROR_END;
+    b->errors++;
+    return TRACKER_ERROR_READ;
+  }
+
+  b->records++;
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static void replay_backend_fill_bird_record (void* handle, int bird, bird_record_t record) {
+  struct replay_backend_s* b = handle;
+
+  if (b->liberty) {
+    liberty_fill_bird_record (b->liberty, bird, record);
+    return;
+  }
+
+  flock_bird_record_t rec = flock_get_record (b->flock, bird);
+  record->x = rec->values.pa.x;
+  record->y = rec->values.pa.y;
+  record->z = rec->values.pa.z;
+  record->za = rec->values.pa.za;
+  record->ya = rec->values.pa.ya;
+  record->xa = rec->values.pa.xa;
+}
+
+static void replay_backend_get_stats (void* handle, tracker_stats_t stats) {
+  struct replay_backend_s* b = handle;
+
+  if (b->liberty) {
+    struct liberty_stats_s s;
+    liberty_get_stats (b->liberty, &s);
+    stats->records = s.records;
+    stats->errors = s.errorIndicators;
+    stats->resyncs = s.stationNumberErrors + s.sizeErrors;
+    return;
+  }
+
+  stats->records = b->records;
+  stats->errors = b->errors;
+}
+
+static const char* replay_backend_error_to_string (int error) {
+  switch (error) {
+  case REPLAY_BACKEND_ERROR_OPTIONS:
+    return "Error: bad replay options";
+  case REPLAY_BACKEND_ERROR_OPEN_RECORDING:
+    return "Error: can't open recording";
+  case REPLAY_BACKEND_ERROR_UNKNOWN_TRACKER:
+    return "Error: recording of an unknown tracker";
+  case REPLAY_BACKEND_ERROR_OPEN:
+    return "Error: can't start replay";
+  case REPLAY_BACKEND_ERROR_END:
+    return "End of recording";
+  }
+
+  return "Error: unknown replay error";
+}
+
+// Time in the recording, as the bytes are written when their time
+// comes, or at full speed the recorded time of the chunk read last
+static uint64_t replay_backend_get_record_time (void* handle) {
+  struct replay_backend_s* b = handle;
+  if (b->speed <= 0.) return 1 + b->time;
+  return 1 + (uint64_t) ((realtime_now () - b->origin) * b->speed);
+}
+
+struct tracker_backend_s replay_backend = {
+  "replay",
+  "Replay",
+  0,
+  replay_backend_make,
+  replay_backend_free,
+  replay_backend_open,
+  replay_backend_close,
+  replay_backend_get_file_descriptor,
+  replay_backend_get_number_of_birds,
+  replay_backend_read_next_record,
+  replay_backend_fill_bird_record,
+  replay_backend_get_stats,
+  replay_backend_error_to_string,
+  NULL,
+  replay_backend_get_flags,
+  replay_backend_get_record_time
+};
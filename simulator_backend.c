@@ -0,0 +1,505 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Simulated tracker: sticks hovering over a drum kit and striking at
+// random, for tests without hardware.  The file argument holds the
+// options, for instance "stations=16 rate=1000 seed=3 noise=0.05":
+//
+//   stations  number of sensors, 1 to MAX_NUMBER_OF_BIRDS (default 2)
+//   rate      frames per second, 0 for as fast as possible (default 240)
+//   seed      the same seed gives the same frames (default 1)
+//   noise     standard deviation of the position noise, in cm (0.02)
+//   strokes   mean number of strokes per second and stick (2)
+//
+// A thread generates the frames at the given rate and writes them to
+// a socket pair, whose other end is the file descriptor of the
+// tracker, as for the Liberty on USB.  When the reader is late and the
+// socket is full, the frames the simulator could not write in time are
+// lost and counted in the "dropped" statistics, as they would be with
+// a real device.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "tracker_backend.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+#define DEFAULT_STATIONS 2
+#define DEFAULT_RATE 240
+#define DEFAULT_NOISE 0.02
+#define DEFAULT_STROKES 2.
+
+// Positions are generated in [0, 1] then sent in centimeters, as the
+// Liberty does (see Standardization.c).
+#define CENTIMETERS 150.
+// Height of the drum heads, and of the sticks between strokes
+#define SURFACE_Z 0.06
+#define REST_Z -0.05
+#define LIFT 0.12
+// Durations in seconds
+#define STROKE_DURATION 0.12
+#define MOVE_DURATION 0.25
+
+// Bytes of the socket, a few frames at the highest rates
+#define SOCKET_BUFFER_SIZE (64 * 1024)
+
+enum simulator_backend_error_e {
+  SIMULATOR_BACKEND_ERROR_OPTIONS = 1,
+  SIMULATOR_BACKEND_ERROR_OPEN = 2
+};
+
+// Frame written on the socket
+struct simulator_frame_s {
+  uint64_t sequence;
+  uint32_t stations;
+  uint32_t pad;
+  struct bird_record_s records[MAX_NUMBER_OF_BIRDS];
+};
+
+typedef struct simulator_rng_s* simulator_rng_t;
+struct simulator_rng_s {
+  uint64_t state;
+};
+
+struct simulator_stick_s {
+  struct simulator_rng_s rng;
+  // Hand position, moving from (x0, y0) to (x1, y1)
+  double x0, y0, x1, y1;
+  double move_start;
+  double stroke_start; // Negative when not striking
+  double next_stroke;
+};
+
+struct simulator_backend_s {
+  // Options
+  int stations;
+  double rate;
+  uint64_t seed;
+  double noise;
+  double strokes;
+
+  struct simulator_stick_s sticks[MAX_NUMBER_OF_BIRDS];
+  struct simulator_rng_s noise_rng;
+
+  int fd; // Read by the tracker user
+  int sockfd; // Written by the thread
+  pthread_t thread;
+  volatile int running;
+
+  struct simulator_frame_s frame; // Last frame read
+  uint64_t expected;
+  unsigned long records;
+  unsigned long errors;
+  unsigned long dropped;
+};
+
+//_____________RANDOM_NUMBERS________________________________//
+
+static uint64_t splitmix64 (uint64_t* x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static void simulator_rng_seed (simulator_rng_t rng, uint64_t seed, uint64_t stream) {
+  uint64_t x = seed * 0x2545F4914F6CDD1DULL + stream;
+  rng->state = splitmix64 (&x);
+  if (rng->state == 0) rng->state = 1;
+}
+
+// Uniform in [0, 1[ (xorshift64*)
+static double simulator_rng_uniform (simulator_rng_t rng) {
+  rng->state ^= rng->state >> 12;
+  rng->state ^= rng->state << 25;
+  rng->state ^= rng->state >> 27;
+  uint64_t r = rng->state * 0x2545F4914F6CDD1DULL;
+  return (r >> 11) * (1. / 9007199254740992.);
+}
+
+static double simulator_rng_range (simulator_rng_t rng, double a, double b) {
+  return a + (b - a) * simulator_rng_uniform (rng);
+}
+
+// Standard normal distribution (Box-Muller)
+static double simulator_rng_gaussian (simulator_rng_t rng) {
+  double u = simulator_rng_uniform (rng);
+  double v = simulator_rng_uniform (rng);
+  if (u < 1e-300) u = 1e-300;
+  return sqrt (-2. * log (u)) * cos (2. * M_PI * v);
+}
+
+//_____________TRAJECTORIES__________________________________//
+
+static double smoothstep (double u) {
+  if (u <= 0.) return 0.;
+  if (u >= 1.) return 1.;
+  return u * u * (3. - 2. * u);
+}
+
+static double simulator_next_interval (struct simulator_backend_s* b,
+                                       struct simulator_stick_s* stick) {
+  // Around the mean, never shorter than a stroke
+  double mean = 1. / b->strokes;
+  double interval = simulator_rng_range (&stick->rng, 0.5 * mean, 1.5 * mean);
+  return interval < STROKE_DURATION ? STROKE_DURATION : interval;
+}
+
+static void simulator_reset_sticks (struct simulator_backend_s* b) {
+  for (int i = 0; i < b->stations; i++) {
+    struct simulator_stick_s* stick = &b->sticks[i];
+    simulator_rng_seed (&stick->rng, b->seed, i + 1);
+    stick->x0 = stick->x1 = simulator_rng_range (&stick->rng, 0.1, 0.9);
+    stick->y0 = stick->y1 = simulator_rng_range (&stick->rng, 0.1, 0.9);
+    stick->move_start = 0.;
+    stick->stroke_start = -1.;
+    stick->next_stroke = simulator_next_interval (b, stick);
+  }
+  simulator_rng_seed (&b->noise_rng, b->seed, 0);
+}
+
+// Height of the stick during a stroke: lift, accelerate down to the
+// drum head, bounce back to the rest height.
+static double simulator_stroke_z (double u) {
+  const double top = REST_Z - LIFT;
+
+  if (u < 0.35) {
+    double s = sin (M_PI * u / 0.7);
+    return REST_Z - LIFT * s * s;
+  }
+  if (u < 0.7) {
+    double s = (u - 0.35) / 0.35;
+    return top + (SURFACE_Z - top) * s * s;
+  }
+  double s = (u - 0.7) / 0.3;
+  return SURFACE_Z + (REST_Z - SURFACE_Z) * sin (0.5 * M_PI * s);
+}
+
+static void simulator_stick_record (struct simulator_backend_s* b,
+                                    struct simulator_stick_s* stick,
+                                    double t,
+                                    bird_record_t record) {
+  // Start a stroke, and move the hand elsewhere after it
+  if (stick->stroke_start < 0. && t >= stick->next_stroke) {
+    stick->stroke_start = t;
+  }
+  else if (stick->stroke_start >= 0. &&
+           t >= stick->stroke_start + STROKE_DURATION) {
+    stick->stroke_start = -1.;
+    stick->next_stroke = t + simulator_next_interval (b, stick);
+    if (simulator_rng_uniform (&stick->rng) < 0.5) {
+      stick->x0 = stick->x1;
+      stick->y0 = stick->y1;
+      stick->x1 = simulator_rng_range (&stick->rng, 0.1, 0.9);
+      stick->y1 = simulator_rng_range (&stick->rng, 0.1, 0.9);
+      stick->move_start = t;
+    }
+  }
+
+  double m = smoothstep ((t - stick->move_start) / MOVE_DURATION);
+  double x = stick->x0 + (stick->x1 - stick->x0) * m;
+  double y = stick->y0 + (stick->y1 - stick->y0) * m;
+  double z = stick->stroke_start < 0. ? REST_Z :
+    simulator_stroke_z ((t - stick->stroke_start) / STROKE_DURATION);
+
+  double noise = b->noise;
+  record->x = x * CENTIMETERS + noise * simulator_rng_gaussian (&b->noise_rng);
+  record->y = y * CENTIMETERS + noise * simulator_rng_gaussian (&b->noise_rng);
+  record->z = z * CENTIMETERS + noise * simulator_rng_gaussian (&b->noise_rng);
+
+  // The stick points forward and tilts with its height.  The azimuth
+  // never crosses 0, where bird_angle_normalize is undefined.
+  record->za = 170. - 10. * x;
+  record->ya = 20. + 200. * (REST_Z - z);
+  record->xa = 5. * y;
+}
+
+static void simulator_fill_frame (struct simulator_backend_s* b,
+                                  struct simulator_frame_s* frame,
+                                  uint64_t sequence) {
+  double t = b->rate > 0. ? sequence / b->rate : sequence / (double) DEFAULT_RATE;
+
+  frame->sequence = sequence;
+  frame->stations = b->stations;
+  for (int i = 0; i < b->stations; i++)
+    simulator_stick_record (b, &b->sticks[i], t, &frame->records[i]);
+}
+
+static size_t simulator_frame_size (struct simulator_backend_s* b) {
+  return offsetof (struct simulator_frame_s, records) +
+    b->stations * sizeof (struct bird_record_s);
+}
+
+//_____________GENERATOR_THREAD______________________________//
+
+static uint64_t now_ns () {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_until (uint64_t deadline) {
+  uint64_t now = now_ns ();
+  if (deadline <= now) return;
+
+  uint64_t ns = deadline - now;
+  struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+  while (nanosleep (&ts, &ts) == -1 && errno == EINTR)
+    ;
+}
+
+static int write_frame (int fd, const void* buf, size_t size) {
+  const char* p = buf;
+  while (size > 0) {
+    // The reader may shut the socket down while we write
+    ssize_t len = send (fd, p, size, MSG_NOSIGNAL);
+    if (len == -1 && errno == EINTR) continue;
+    if (len <= 0) return -1;
+    p += len;
+    size -= len;
+  }
+  return 0;
+}
+
+static void* simulator_thread (void* data) {
+  struct simulator_backend_s* b = data;
+  struct simulator_frame_s frame;
+  size_t size = simulator_frame_size (b);
+  uint64_t period = b->rate > 0. ? (uint64_t) (1e9 / b->rate) : 0;
+  uint64_t start = now_ns ();
+  uint64_t sequence = 0;
+
+  while (b->running) {
+    if (period) {
+      uint64_t deadline = start + sequence * period;
+      sleep_until (deadline);
+
+      // The frames whose time went by while the socket was full are
+      // lost, the trajectories still go through them.
+      uint64_t late = (now_ns () - deadline) / period;
+      for (; late > 0; late--) {
+        simulator_fill_frame (b, &frame, sequence++);
+      }
+    }
+
+    simulator_fill_frame (b, &frame, sequence++);
+    if (write_frame (b->sockfd, &frame, size) == -1)
+      break;
+  }
+
+  return NULL;
+}
+
+//_____________BACKEND_______________________________________//
+
+static int simulator_parse_options (struct simulator_backend_s* b, const char* options) {
+  b->stations = DEFAULT_STATIONS;
+  b->rate = DEFAULT_RATE;
+  b->seed = 1;
+  b->noise = DEFAULT_NOISE;
+  b->strokes = DEFAULT_STROKES;
+
+  char buf[1024];
+  strncpy (buf, options, sizeof (buf) - 1);
+  buf[sizeof (buf) - 1] = '\0';
+
+  for (char* token = strtok (buf, " ,;\t"); token; token = strtok (NULL, " ,;\t")) {
+    char* value = strchr (token, '=');
+    if (value == NULL) return -1;
+    *value++ = '\0';
+
+    if (strcmp (token, "stations") == 0)
+      b->stations = atoi (value);
+    else if (strcmp (token, "rate") == 0)
+      b->rate = atof (value);
+    else if (strcmp (token, "seed") == 0)
+      b->seed = strtoull (value, NULL, 10);
+    else if (strcmp (token, "noise") == 0)
+      b->noise = atof (value);
+    else if (strcmp (token, "strokes") == 0)
+      b->strokes = atof (value);
+    else
+      return -1;
+  }
+
+  if (b->stations < 1 || b->stations > MAX_NUMBER_OF_BIRDS) return -1;
+  if (b->rate < 0. || b->noise < 0. || b->strokes <= 0.) return -1;
+  return 0;
+}
+
+static void* simulator_backend_make () {
+  struct simulator_backend_s* b = calloc (1, sizeof (struct simulator_backend_s));
+  b->fd = -1;
+  b->sockfd = -1;
+  return b;
+}
+
+static void simulator_backend_close (void* handle) {
+  struct simulator_backend_s* b = handle;
+
+  if (b->running) {
+    b->running = 0;
+    // Unblocks the thread if it is writing
+    shutdown (b->fd, SHUT_RDWR);
+    pthread_join (b->thread, NULL);
+  }
+
+  if (b->fd != -1) close (b->fd);
+  if (b->sockfd != -1) close (b->sockfd);
+  b->fd = -1;
+  b->sockfd = -1;
+}
+
+static void simulator_backend_free (void* handle) {
+  simulator_backend_close (handle);
+  free (handle);
+}
+
+static int simulator_backend_open (void* handle, const char* file) {
+  struct simulator_backend_s* b = handle;
+
+  if (simulator_parse_options (b, file) == -1)
+    return SIMULATOR_BACKEND_ERROR_OPTIONS;
+
+  simulator_reset_sticks (b);
+  b->expected = 0;
+  b->records = 0;
+  b->errors = 0;
+  b->dropped = 0;
+
+  int fds[2] = { -1, -1 };
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds)) {
+    perror ("socketpair");
+    return SIMULATOR_BACKEND_ERROR_OPEN;
+  }
+
+  b->fd = fds[0];
+  b->sockfd = fds[1];
+
+  int size = SOCKET_BUFFER_SIZE;
+  setsockopt (b->sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof (size));
+  setsockopt (b->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size));
+
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt (b->sockfd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof (one));
+#endif
+
+  b->running = 1;
+  if (pthread_create (&b->thread, NULL, simulator_thread, b)) {
+    b->running = 0;
+    simulator_backend_close (b);
+    return SIMULATOR_BACKEND_ERROR_OPEN;
+  }
+
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static int simulator_backend_get_file_descriptor (void* handle) {
+  struct simulator_backend_s* b = handle;
+  return b->fd;
+}
+
+static int simulator_backend_get_number_of_birds (void* handle) {
+  struct simulator_backend_s* b = handle;
+  return b->stations;
+}
+
+static int simulator_backend_read_next_record (void* handle) {
+  struct simulator_backend_s* b = handle;
+  size_t size = simulator_frame_size (b);
+  char* p = (char*) &b->frame;
+
+  while (size > 0) {
+    ssize_t len = read (b->fd, p, size);
+    if (len == -1 && errno == EINTR) continue;
+    if (len <= 0) {
+      b->errors++;
+      return TRACKER_ERROR_READ;
+    }
+    p += len;
+    size -= len;
+  }
+
+  if (b->frame.sequence != b->expected)
+    b->dropped += b->frame.sequence - b->expected;
+  b->expected = b->frame.sequence + 1;
+  b->records++;
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+static void simulator_backend_fill_bird_record (void* handle, int bird, bird_record_t record) {
+  struct simulator_backend_s* b = handle;
+  *record = b->frame.records[bird - 1];
+}
+
+static void simulator_backend_get_stats (void* handle, tracker_stats_t stats) {
+  struct simulator_backend_s* b = handle;
+  stats->records = b->records;
+  stats->errors = b->errors;
+  stats->dropped = b->dropped;
+}
+
+static const char* simulator_backend_error_to_string (int error) {
+  switch (error) {
+  case SIMULATOR_BACKEND_ERROR_OPTIONS:
+    return "Error: bad simulator options";
+  case SIMULATOR_BACKEND_ERROR_OPEN:
+    return "Error: can't start simulator";
+  }
+
+  return "Error: unknown simulator error";
+}
+
+// Time of the frame on the clock of the simulated device
+static uint64_t simulator_backend_get_record_time (void* handle) {
+  struct simulator_backend_s* b = handle;
+  double rate = b->rate > 0. ? b->rate : DEFAULT_RATE;
+  return (uint64_t) ((b->frame.sequence + 1) * 1e9 / rate);
+}
+
+struct tracker_backend_s simulator_backend = {
+  "simulator",
+  "Simulator",
+  TRACKER_FLAG_CENTIMETERS,
+  simulator_backend_make,
+  simulator_backend_free,
+  simulator_backend_open,
+  simulator_backend_close,
+  simulator_backend_get_file_descriptor,
+  simulator_backend_get_number_of_birds,
+  simulator_backend_read_next_record,
+  simulator_backend_fill_bird_record,
+  simulator_backend_get_stats,
+  simulator_backend_error_to_string,
+  NULL,
+  NULL,
+  simulator_backend_get_record_time
+};
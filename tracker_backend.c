@@ -0,0 +1,230 @@
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracker_backend.h"
+#include "recording.h"
+#include "realtime.h"
+
+#define MAX_BACKENDS 16
+
+// Backends compiled in FoB.
+extern struct tracker_backend_s liberty_backend;
+extern struct tracker_backend_s flock_backend;
+extern struct tracker_backend_s simulator_backend;
+extern struct tracker_backend_s replay_backend;
+
+static tracker_backend_t backends[MAX_BACKENDS];
+static int number_of_backends = 0;
+static int builtins_registered = 0;
+
+struct tracker_s {
+  tracker_backend_t backend;
+  void* handle;
+  int open;
+  int error;
+  uint64_t record_time;
+  recording_writer_t recording;
+};
+
+static void tracker_backend_register_builtins () {
+  if (builtins_registered) return;
+  builtins_registered = 1;
+
+  tracker_backend_register (&liberty_backend);
+  tracker_backend_register (&flock_backend);
+  tracker_backend_register (&simulator_backend);
+  tracker_backend_register (&replay_backend);
+}
+
+void tracker_backend_register (tracker_backend_t backend) {
+  tracker_backend_register_builtins ();
+
+  for (int i = 0; i < number_of_backends; i++) {
+    if (strcmp (backends[i]->name, backend->name) == 0) {
+      backends[i] = backend;
+      return;
+    }
+  }
+
+  if (number_of_backends >= MAX_BACKENDS) {
+    fprintf (stderr, "Too many tracker backends, %s ignored\n", backend->name);
+    return;
+  }
+
+  backends[number_of_backends++] = backend;
+}
+
+int tracker_backend_count () {
+  tracker_backend_register_builtins ();
+  return number_of_backends;
+}
+
+tracker_backend_t tracker_backend_get (int index) {
+  tracker_backend_register_builtins ();
+  if (index < 0 || index >= number_of_backends) return NULL;
+  return backends[index];
+}
+
+tracker_backend_t tracker_backend_find (const char* name) {
+  tracker_backend_register_builtins ();
+  if (name == NULL) return NULL;
+
+  for (int i = 0; i < number_of_backends; i++) {
+    if (strcmp (backends[i]->name, name) == 0 ||
+        strcmp (backends[i]->label, name) == 0)
+      return backends[i];
+  }
+
+  return NULL;
+}
+
+tracker_t tracker_new (const char* name) {
+  tracker_backend_t backend = tracker_backend_find (name);
+  if (backend == NULL) return NULL;
+
+  void* handle = backend->make ();
+  if (handle == NULL) return NULL;
+
+  tracker_t tracker = calloc (1, sizeof (*tracker));
+  tracker->backend = backend;
+  tracker->handle = handle;
+  return tracker;
+}
+
+void tracker_free (tracker_t tracker) {
+  if (tracker == NULL) return;
+  tracker_close (tracker);
+  tracker->backend->free (tracker->handle);
+  free (tracker);
+}
+
+tracker_backend_t tracker_get_backend (tracker_t tracker) {
+  return tracker->backend;
+}
+
+int tracker_get_flags (tracker_t tracker) {
+  if (tracker->open && tracker->backend->get_flags)
+    return tracker->backend->get_flags (tracker->handle);
+  return tracker->backend->flags;
+}
+
+int tracker_open (tracker_t tracker, const char* file) {
+  tracker_close (tracker);
+  tracker->error = tracker->backend->open (tracker->handle, file ? file : "");
+  if (tracker->error) {
+    tracker->backend->close (tracker->handle);
+    return tracker->error;
+  }
+
+  tracker->open = 1;
+  tracker->record_time = 0;
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+void tracker_close (tracker_t tracker) {
+  tracker_stop_recording (tracker);
+  if (tracker->open) tracker->backend->close (tracker->handle);
+  tracker->open = 0;
+  tracker->error = TRACKER_ERROR_NO_ERROR;
+}
+
+int tracker_is_open (tracker_t tracker) {
+  return tracker->open;
+}
+
+int tracker_get_file_descriptor (tracker_t tracker) {
+  if (!tracker->open) return -1;
+  return tracker->backend->get_file_descriptor (tracker->handle);
+}
+
+int tracker_get_number_of_birds (tracker_t tracker) {
+  return tracker->backend->get_number_of_birds (tracker->handle);
+}
+
+int tracker_read_next_record (tracker_t tracker) {
+  if (!tracker->open)
+    return tracker->error = TRACKER_ERROR_NOT_OPEN;
+
+  tracker->error = tracker->backend->read_next_record (tracker->handle);
+  if (tracker->error == TRACKER_ERROR_NO_ERROR)
+    tracker->record_time = tracker->backend->get_record_time ?
+      tracker->backend->get_record_time (tracker->handle) : realtime_now ();
+  return tracker->error;
+}
+
+void tracker_fill_bird_record (tracker_t tracker, int bird, bird_record_t record) {
+  tracker->backend->fill_bird_record (tracker->handle, bird, record);
+}
+
+uint64_t tracker_get_record_time (tracker_t tracker) {
+  return tracker->record_time;
+}
+
+void tracker_get_stats (tracker_t tracker, tracker_stats_t stats) {
+  memset (stats, 0, sizeof (*stats));
+  if (tracker->open) tracker->backend->get_stats (tracker->handle, stats);
+}
+
+int tracker_start_recording (tracker_t tracker, const char* filename) {
+  tracker_stop_recording (tracker);
+
+  if (!tracker->open)
+    return tracker->error = TRACKER_ERROR_NOT_OPEN;
+  if (tracker->backend->set_tap == NULL)
+    return tracker->error = TRACKER_ERROR_RECORDING;
+
+  tracker->recording = recording_writer_open
+    (filename, tracker->backend->name, tracker_get_number_of_birds (tracker));
+  if (tracker->recording == NULL)
+    return tracker->error = TRACKER_ERROR_RECORDING;
+
+  tracker->backend->set_tap
+    (tracker->handle, recording_writer_tap, tracker->recording);
+  return TRACKER_ERROR_NO_ERROR;
+}
+
+void tracker_stop_recording (tracker_t tracker) {
+  if (tracker->recording == NULL) return;
+
+  tracker->backend->set_tap (tracker->handle, NULL, NULL);
+  if (recording_writer_close (tracker->recording) == -1)
+    fprintf (stderr, "Error while writing the recording\n");
+  tracker->recording = NULL;
+}
+
+int tracker_get_error (tracker_t tracker) {
+  return tracker->error;
+}
+
+const char* tracker_get_error_string (tracker_t tracker) {
+  switch (tracker->error) {
+  case TRACKER_ERROR_NO_ERROR:
+    return NULL;
+  case TRACKER_ERROR_NOT_OPEN:
+    return "Error: tracker is not open";
+  case TRACKER_ERROR_READ:
+    return "Error: can't get record";
+  case TRACKER_ERROR_RECORDING:
+    return "Error: can't record";
+  }
+
+  return tracker->backend->error_to_string (tracker->error);
+}
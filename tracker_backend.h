@@ -0,0 +1,133 @@
+#ifndef __tracker_backend_h__
+#define __tracker_backend_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FoB - GUI for 3D Trackers
+   Copyright (C) 2007, 2008, 2009 SCRIME, universite' Bordeaux 1
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA */
+
+// Plain C interface to the trackers.  A backend is a table of
+// functions registered under a short name ("liberty", "flock", ...)
+// and a label (the string shown in the GUI device combo box).  The
+// GUI, the daemon and the tools only see tracker_t handles.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bird_record.h"
+
+// Properties of the data delivered by a backend.
+enum tracker_flag_e {
+  // Positions are in centimeters and must go through the
+  // Standardization functions.
+  TRACKER_FLAG_CENTIMETERS = 1 << 0,
+  // The device is found by the backend itself, the file argument of
+  // tracker_open is ignored.
+  TRACKER_FLAG_NO_FILE = 1 << 1
+};
+
+enum tracker_error_e {
+  TRACKER_ERROR_NO_ERROR = 0,
+  TRACKER_ERROR_NOT_OPEN = -1,
+  TRACKER_ERROR_READ = -2,
+  TRACKER_ERROR_RECORDING = -3
+};
+
+// Function called with the raw bytes read from the device
+typedef void (*tracker_tap_t) (void* data, const void* buf, size_t len);
+
+typedef struct tracker_stats_s* tracker_stats_t;
+struct tracker_stats_s {
+  unsigned long records; // Complete records read
+  unsigned long errors;  // Failed reads
+  unsigned long resyncs; // Times the parser looked for a record boundary
+  unsigned long dropped; // Records known to be lost
+};
+
+typedef struct tracker_backend_s* tracker_backend_t;
+struct tracker_backend_s {
+  const char* name;
+  const char* label;
+  int flags;
+
+  void* (*make) (void);
+  void (*free) (void* handle);
+  // Returns TRACKER_ERROR_NO_ERROR or a backend specific error code.
+  int (*open) (void* handle, const char* file);
+  void (*close) (void* handle);
+  int (*get_file_descriptor) (void* handle);
+  int (*get_number_of_birds) (void* handle);
+  // Returns TRACKER_ERROR_NO_ERROR or a backend specific error code.
+  int (*read_next_record) (void* handle);
+  // Birds are numbered from 1.
+  void (*fill_bird_record) (void* handle, int bird, bird_record_t record);
+  void (*get_stats) (void* handle, tracker_stats_t stats);
+  const char* (*error_to_string) (int error);
+
+  // Optional (NULL when not supported)
+  void (*set_tap) (void* handle, tracker_tap_t tap, void* data);
+  // Optional, flags once open when they depend on the device
+  int (*get_flags) (void* handle);
+  // Optional, time of the last record in nanoseconds on the clock of
+  // the device (or of the recording), 0 if unknown.  The time the
+  // record was read is used when NULL.
+  uint64_t (*get_record_time) (void* handle);
+};
+
+// Backends compiled in FoB register themselves the first time the
+// registry is used.  Other backends may be added at any time.
+extern void tracker_backend_register (tracker_backend_t backend);
+extern int tracker_backend_count (void);
+extern tracker_backend_t tracker_backend_get (int index);
+// Finds a backend by name or by label.
+extern tracker_backend_t tracker_backend_find (const char* name);
+
+typedef struct tracker_s* tracker_t;
+
+// Returns NULL if no backend has this name or label.
+extern tracker_t tracker_new (const char* name);
+extern void tracker_free (tracker_t tracker);
+extern tracker_backend_t tracker_get_backend (tracker_t tracker);
+extern int tracker_get_flags (tracker_t tracker);
+
+extern int tracker_open (tracker_t tracker, const char* file);
+extern void tracker_close (tracker_t tracker);
+extern int tracker_is_open (tracker_t tracker);
+extern int tracker_get_file_descriptor (tracker_t tracker);
+extern int tracker_get_number_of_birds (tracker_t tracker);
+extern int tracker_read_next_record (tracker_t tracker);
+extern void tracker_fill_bird_record (tracker_t tracker, int bird, bird_record_t record);
+extern void tracker_get_stats (tracker_t tracker, tracker_stats_t stats);
+// Time of the last record read, in nanoseconds, 0 if unknown.  Only
+// the differences between the times of the records are meaningful.
+extern uint64_t tracker_get_record_time (tracker_t tracker);
+
+// Records the raw bytes read from the open tracker (see recording.h)
+// until tracker_stop_recording or tracker_close.
+extern int tracker_start_recording (tracker_t tracker, const char* filename);
+extern void tracker_stop_recording (tracker_t tracker);
+
+// Last error of tracker_open or tracker_read_next_record, and its
+// description (NULL when there is no error).
+extern int tracker_get_error (tracker_t tracker);
+extern const char* tracker_get_error_string (tracker_t tracker);
+
+#ifdef __cplusplus
+}
+#endif
+#endif